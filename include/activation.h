@@ -0,0 +1,125 @@
+/**
+ * @file activation.h
+ * @brief Interface for activation functions working on whole arrays.
+ *
+ * Every built-in activation comes as a scalar function, usable anywhere a
+ * double (*)(double) callback is expected, and as an array kernel that is
+ * vectorized with AVX2 when the CPU has it (see SimdOps.level).
+ *
+ * MatrixOps.applyToAllUnary, LayerOps.feedForward and ExpressionOps.unary
+ * look the callback they are given up with kernelOf: the scalar functions
+ * below, and callbacks registered with addKernel, run through their array
+ * kernel, anything else is called once per element as before.
+ *
+ * The vectorized kernels agree with the scalar functions, which use libm,
+ * within a few units in the last place. gelu can differ by a few tens for
+ * large inputs, where the rounding of its cubic argument gets amplified by
+ * the exponential.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * @brief Slope of leakyRelu for negative inputs.
+ */
+#ifndef ACTIVATION_LEAKY_SLOPE
+#define ACTIVATION_LEAKY_SLOPE 0.01
+#endif
+
+/**
+ * @brief Number of callbacks addKernel can register.
+ */
+#ifndef ACTIVATION_MAX_KERNELS
+#define ACTIVATION_MAX_KERNELS 16
+#endif
+
+/**
+ * @brief Array kernel, computes out[i] = f(in[i]). in and out may be equal.
+ */
+typedef void (*ActivationKernel)(const double* in, double* out, size_t n);
+
+/*
+ *	Interface for activation functions.
+ */
+extern const struct ActivationInterface{
+
+    /**
+     * @brief Scalar activation functions.
+     */
+    struct {
+        double (*sigmoid)(double x);
+        double (*tanh)(double x);
+        double (*relu)(double x);
+        double (*leakyRelu)(double x);
+
+        /**
+         * @brief GELU with the tanh approximation,
+         * 0.5 * x * (1 + tanh(sqrt(2 / pi) * (x + 0.044715 * x^3))),
+         * computed as x * sigmoid(2 * sqrt(2 / pi) * (x + 0.044715 * x^3)).
+         */
+        double (*gelu)(double x);
+        double (*softplus)(double x);
+        double (*exp)(double x);
+    } f;
+
+    /**
+     * @brief Derivatives of the scalar functions, taking the same input x.
+     * @note Meant as the activationDerivative of LayerOps.create.
+     */
+    struct {
+        double (*sigmoid)(double x);
+        double (*tanh)(double x);
+        double (*relu)(double x);
+        double (*leakyRelu)(double x);
+        double (*gelu)(double x);
+        double (*softplus)(double x);
+        double (*exp)(double x);
+    } derivative;
+
+    /**
+     * @brief Array kernels of the scalar functions.
+     */
+    struct {
+        void (*sigmoid)(const double* in, double* out, size_t n);
+        void (*tanh)(const double* in, double* out, size_t n);
+        void (*relu)(const double* in, double* out, size_t n);
+        void (*leakyRelu)(const double* in, double* out, size_t n);
+        void (*gelu)(const double* in, double* out, size_t n);
+        void (*softplus)(const double* in, double* out, size_t n);
+        void (*exp)(const double* in, double* out, size_t n);
+    } array;
+
+    /**
+     * @brief Gets the array kernel of a scalar function.
+     * @param func The scalar function.
+     * @return Its kernel, or NULL if it has none.
+     */
+    ActivationKernel (*kernelOf)(double (*func)(double));
+
+    /**
+     * @brief Registers an array kernel for a user callback.
+     * @param func The scalar function.
+     * @param kernel Its array version, NULL to remove a registration.
+     * @return 0 on success, -1 if the table is full or func is built in.
+     * @note Not thread safe, meant to be called once at startup.
+     */
+    int (*addKernel)(double (*func)(double), ActivationKernel kernel);
+
+    /**
+     * @brief Computes out[i] = func(in[i]) with the kernel of func if any.
+     * @param func The scalar function.
+     * @param in Input array.
+     * @param out Output array, may be in.
+     * @param n Number of elements.
+     */
+    void (*apply)(double (*func)(double), const double* in, double* out,
+        size_t n);
+
+    /**
+     * @brief Single precision apply. Kernels run on blocks widened to double.
+     */
+    void (*applyF)(double (*func)(double), const float* in, float* out,
+        size_t n);
+} ActivationOps;
@@ -0,0 +1,114 @@
+/**
+ * @file arena.h
+ * @brief Interface for arena allocation of short-lived objects.
+ *
+ * An arena hands out memory by bumping an offset in large blocks and frees
+ * everything at once by moving the offset back. Blocks are kept after a
+ * reset, so a loop that allocates the same temporaries every iteration
+ * stops calling malloc after its first iteration.
+ *
+ * While an arena is in use by a thread (see use), MatrixOps.create and the
+ * operations built on it draw their matrices from it. Such matrices can be
+ * destroyed as usual, which frees nothing, or simply dropped at the reset.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * @brief Default size in bytes of the blocks an arena allocates.
+ */
+#ifndef ARENA_BLOCK_SIZE
+#define ARENA_BLOCK_SIZE (256u << 10)
+#endif
+
+/**
+ * @brief Alignment in bytes of every arena allocation, one cache line.
+ */
+#define ARENA_ALIGNMENT 64
+
+/**
+ * @brief Opaque pointer to an arena structure.
+ */
+typedef struct ArenaStruct* Arena;
+
+/**
+ * @brief A position in an arena, to reset it to later.
+ */
+typedef struct ArenaMark {
+    void* block;
+    size_t used;
+} ArenaMark;
+
+/*
+ *	Interface for arenas.
+ */
+extern const struct ArenaInterface{
+
+    /**
+     * @brief Creates an empty arena.
+     * @param blockSize Size in bytes of the blocks to allocate, 0 for
+     * ARENA_BLOCK_SIZE. Larger requests get a block of their own size.
+     * @return A new arena, or NULL if creation fails.
+     * @note No memory is allocated until the first alloc.
+     */
+    Arena (*create)(size_t blockSize);
+
+    /**
+     * @brief Destroys an arena and frees all of its blocks.
+     * @param arenaAddr Address of the arena to destroy.
+     * @note The arena must not be in use by any thread.
+     */
+    void (*destroy)(Arena* arenaAddr);
+
+    /**
+     * @brief Allocates memory from an arena.
+     * @param arena The arena.
+     * @param size Size in bytes.
+     * @return Memory aligned to ARENA_ALIGNMENT, or NULL on failure.
+     */
+    void* (*alloc)(Arena arena, size_t size);
+
+    /**
+     * @brief Gets the current position of an arena.
+     * @param arena The arena.
+     * @return The position, to pass to reset.
+     */
+    ArenaMark (*mark)(Arena arena);
+
+    /**
+     * @brief Frees everything allocated since a mark, in constant time.
+     * @param arena The arena.
+     * @param mark A position taken with mark on the same arena.
+     * @note Memory allocated after the mark must not be used anymore,
+     * matrices in it must not even be destroyed.
+     */
+    void (*reset)(Arena arena, ArenaMark mark);
+
+    /**
+     * @brief Frees everything allocated from an arena, in constant time.
+     * @param arena The arena.
+     */
+    void (*clear)(Arena arena);
+
+    /**
+     * @brief Gets the number of bytes in use in an arena.
+     * @param arena The arena.
+     * @return The bytes allocated since the last clear, padding included.
+     */
+    size_t (*used)(Arena arena);
+
+    /**
+     * @brief Makes the calling thread create its matrices in an arena.
+     * @param arena The arena to use, or NULL to go back to the heap.
+     * @return The arena used before, to restore when the scope ends.
+     */
+    Arena (*use)(Arena arena);
+
+    /**
+     * @brief Gets the arena the calling thread creates its matrices in.
+     * @return The arena, or NULL when matrices go to the heap.
+     */
+    Arena (*current)(void);
+} ArenaOps;
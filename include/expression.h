@@ -0,0 +1,131 @@
+/**
+ * @file expression.h
+ * @brief Interface for lazily evaluated element-wise matrix expressions.
+ *
+ * An expression records a chain of element-wise operations on a source
+ * matrix and runs all of them in one pass when it is evaluated. The data is
+ * walked in blocks small enough to stay in L1, every recorded operation is
+ * applied to a block before the next one is loaded, so the source is read
+ * once and the result written once whatever the length of the chain.
+ *
+ * normalize divides by the sum of the values computed so far, which needs
+ * that sum before it can go on: each normalize adds one pass.
+ *
+ * A softmax is then
+ *     expr = ExpressionOps.create(x);
+ *     ExpressionOps.unary(expr, ActivationOps.f.exp);
+ *     ExpressionOps.normalize(expr);
+ *     ExpressionOps.evaluate(expr, x);
+ * two passes and no temporary, instead of three passes and a copy.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include "matrix.h"
+
+/**
+ * @brief Elements per block of an evaluation pass.
+ */
+#ifndef EXPRESSION_BLOCK
+#define EXPRESSION_BLOCK 512
+#endif
+
+/**
+ * @brief Opaque pointer to an expression structure.
+ */
+typedef struct ExpressionStruct* Expression;
+
+/*
+ *	Interface for expressions.
+ */
+extern const struct ExpressionInterface{
+
+    /**
+     * @brief Creates an empty expression on a source matrix.
+     * @param source The matrix the expression reads, must outlive it.
+     * @return A new expression, or NULL if creation fails.
+     * @note Evaluating an empty expression copies the source.
+     */
+    Expression (*create)(const Matrix source);
+
+    /**
+     * @brief Destroys an expression. The matrices it refers to are kept.
+     * @param exprAddr Address of the expression to destroy.
+     */
+    void (*destroy)(Expression* exprAddr);
+
+    /**
+     * @brief Changes the source of an expression, keeping its operations.
+     * @param expr The expression.
+     * @param source The new source, can have another shape.
+     * @return 0 on success, -1 on failure.
+     * @note Lets a pipeline be recorded once and evaluated on many inputs.
+     */
+    int (*setSource)(Expression expr, const Matrix source);
+
+    /**
+     * @brief Records func(x) on every element.
+     * @param expr The expression.
+     * @param func The unary function.
+     * @return 0 on success, -1 on failure.
+     * @note Runs through the array kernel of func if it has one, see
+     * ActivationOps.kernelOf.
+     */
+    int (*unary)(Expression expr, double (*func)(double));
+
+    /**
+     * @brief Records func(x, value) on every element.
+     * @param expr The expression.
+     * @param func The binary function, MatrixOps.fBinary for instance.
+     * @param value The value broadcast to every element.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*binary)(Expression expr, double (*func)(double, double),
+        double value);
+
+    /**
+     * @brief Records func(x, y) with y the matching element of a matrix.
+     * @param expr The expression.
+     * @param matrix The second operand, with the shape of the source.
+     * @param func The binary function.
+     * @return 0 on success, -1 on failure.
+     * @note The matrix is read when the expression is evaluated.
+     */
+    int (*elementWise)(Expression expr, const Matrix matrix,
+        double (*func)(double, double));
+
+    /**
+     * @brief Records x * scalar on every element, vectorized.
+     * @param expr The expression.
+     * @param scalar The scalar.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*scale)(Expression expr, double scalar);
+
+    /**
+     * @brief Records a division of every element by the sum of all elements.
+     * @param expr The expression.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*normalize)(Expression expr);
+
+    /**
+     * @brief Evaluates an expression into a matrix.
+     * @param expr The expression.
+     * @param dst The matrix to store the result in, with the shape of the source.
+     * @return 0 on success, -1 on failure.
+     * @note dst may be the source. It can't be an elementWise operand.
+     */
+    int (*evaluate)(Expression expr, Matrix dst);
+
+    /**
+     * @brief Sums the result of an expression without storing it.
+     * @param expr The expression.
+     * @param result Pointer to store the sum.
+     * @return 0 on success, -1 on failure.
+     * @note Each normalize recomputes the operations before it instead of
+     * storing them, so this never allocates.
+     */
+    int (*sum)(Expression expr, double* result);
+} ExpressionOps;
@@ -0,0 +1,326 @@
+/**
+ * @file gemm.h
+ * @brief Interface for general matrix multiplication kernels.
+ *
+ * This file provides the packed, cache-blocked GEMM engine used behind
+ * MatrixOps.multiply. All operands are row-major arrays addressed through
+ * a leading dimension (the distance in elements between two rows).
+ *
+ * The blocking follows the usual three level scheme:
+ *  - a KC x NC panel of B is packed once and stays in L3,
+ *  - an MC x KC block of A is packed and stays in L2,
+ *  - an MR x NR register tile of C is computed by a micro-kernel while a
+ *    KC x NR sliver of packed B stays in L1.
+ *
+ * The blocking parameters can be overridden at compile time (-DGEMM_KC=...).
+ * The double and float kernels share one templated driver (gemm_driver.inc).
+ *
+ * Products of at least GEMM_PARALLEL_THRESHOLD multiply-adds are split into
+ * blocks of C run on the thread pool (see thread_pool.h). Blocks start on
+ * register tile boundaries, so the result is bitwise the same whatever the
+ * number of threads.
+ *
+ * Products of at most GEMM_SMALL_MAX rows whose column count, or shared
+ * dimension for a matrix-vector product, is one of GEMM_SMALL_SIZES run a
+ * kernel compiled for that size. Its loops are unrolled, and it skips the
+ * packing and the thread pool, which would cost more than the product.
+ *
+ * Products whose three dimensions all reach the Strassen threshold (see
+ * GEMM_STRASSEN_THRESHOLD) and that don't read C (beta is 0) use the
+ * Strassen-Winograd recursion: 7 half size products and 15 additions per
+ * level instead of 8 products. The leaves are the blocked kernel above.
+ *
+ * dgemm, dgemv, dger and their single precision versions can instead hand
+ * the whole call to a system CBLAS (OpenBLAS, BLIS), selected with
+ * setBackend or the GEMM_BACKEND_ENV environment variable. The makefile
+ * builds it in with -DGEMM_CBLAS when it finds one. MatrixOps and the layers
+ * call GemmOps, so switching the backend switches them too. The CBLAS
+ * backend runs on its own threads and doesn't give the bitwise
+ * reproducibility across thread counts of the native kernels.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * @brief Rows of the register tile computed by the micro-kernel.
+ */
+#ifndef GEMM_MR
+#define GEMM_MR 6
+#endif
+
+/**
+ * @brief Columns of the register tile computed by the micro-kernel.
+ * @note Must be a multiple of 4 for the vectorized micro-kernel.
+ */
+#ifndef GEMM_NR
+#define GEMM_NR 8
+#endif
+
+/**
+ * @brief Columns of the single precision register tile.
+ * @note 16 floats take the same two vector registers as GEMM_NR doubles.
+ */
+#ifndef GEMM_SNR
+#define GEMM_SNR 16
+#endif
+
+/**
+ * @brief Rows of the packed A block kept in L2. Must be a multiple of GEMM_MR.
+ */
+#ifndef GEMM_MC
+#define GEMM_MC 96
+#endif
+
+/**
+ * @brief Depth of the packed A and B blocks (shared dimension).
+ */
+#ifndef GEMM_KC
+#define GEMM_KC 256
+#endif
+
+/**
+ * @brief Columns of the packed B panel kept in L3. Must be a multiple of GEMM_NR.
+ */
+#ifndef GEMM_NC
+#define GEMM_NC 4096
+#endif
+
+/**
+ * @brief Multiply-adds (m * n * k) from which a product runs in parallel.
+ * @note Below it waking the workers costs more than it saves.
+ */
+#ifndef GEMM_PARALLEL_THRESHOLD
+#define GEMM_PARALLEL_THRESHOLD (1u << 21)
+#endif
+
+/**
+ * @brief Sizes given kernels of their own, as an X macro.
+ *
+ * A matrix-vector product with one of these shared dimensions, or a matrix
+ * product with one of these column counts, uses the kernel of the size when
+ * it has at most GEMM_SMALL_MAX rows and, for a matrix product, a shared
+ * dimension of at most GEMM_SMALL_MAX. Set the sizes of the layers of a
+ * network, e.g. -D'GEMM_SMALL_SIZES(X)=X(3) X(12)'.
+ */
+#ifndef GEMM_SMALL_SIZES
+#define GEMM_SMALL_SIZES(X) X(4) X(8) X(16) X(32) X(64)
+#endif
+
+/**
+ * @brief Largest size of GEMM_SMALL_SIZES, and the most rows of a product
+ * using those kernels.
+ * @note The kernels keep a row of the result in arrays of this size, so a
+ * larger size in GEMM_SMALL_SIZES fails to compile.
+ */
+#ifndef GEMM_SMALL_MAX
+#define GEMM_SMALL_MAX 64
+#endif
+
+/**
+ * @brief Elements of A (m * n) from which a matrix-vector product or a
+ * rank-1 update runs in parallel.
+ */
+#ifndef GEMV_PARALLEL_THRESHOLD
+#define GEMV_PARALLEL_THRESHOLD (1u << 18)
+#endif
+
+/**
+ * @brief Default size from which square-ish products use Strassen-Winograd,
+ * 0 to never use it. Can be changed at run time with setStrassenThreshold.
+ *
+ * Each level of the recursion halves m, n and k and stops once one of them
+ * is below the threshold, so the leaves are products of at least half the
+ * threshold. A level saves one product in eight but adds 15 passes of
+ * additions over the quarters of A, B and C, so it only pays off when the
+ * blocked kernel is well above its cache blocking sizes.
+ *
+ * The error is bounded normwise, not element by element like the blocked
+ * kernel. For n x n matrices with n = 2^r * n0, where n0 is the leaf size,
+ * Higham (Accuracy and Stability of Numerical Algorithms, 23.2.2) gives
+ *     max|C - C_exact| <= ((n / n0)^log2(18) * (n0^2 + 6 * n0) - 6 * n)
+ *                         * EPSILON * max|A| * max|B|
+ * to first order. Against the classical bound n^2 * EPSILON * max|A| * max|B|
+ * this is a factor of 4.5^r * (1 + 6 / n0) - 6 / n: 4.5 + 24 / n0 for one
+ * level and 20.25 + 120 / n0 for two, so about 4.5 and 20 with the leaves
+ * of the default threshold. Small elements of C next to large ones can lose
+ * all accuracy, products that need element-wise accuracy should set the
+ * threshold to 0.
+ */
+#ifndef GEMM_STRASSEN_THRESHOLD
+#define GEMM_STRASSEN_THRESHOLD 1024
+#endif
+
+/**
+ * @brief Environment variable selecting the backend at startup, "native"
+ * or "cblas".
+ */
+#ifndef GEMM_BACKEND_ENV
+#define GEMM_BACKEND_ENV "NN_GEMM_BACKEND"
+#endif
+
+/**
+ * @brief Implementation behind the GemmOps products.
+ */
+typedef enum GemmBackend {
+    GEMM_BACKEND_NATIVE = 0,    // The kernels of this file, the default
+    GEMM_BACKEND_CBLAS          // A system CBLAS, when built with GEMM_CBLAS
+} GemmBackend;
+
+/*
+ *	Interface for GEMM kernels.
+ */
+extern const struct GemmInterface{
+
+    /**
+     * @brief Computes C = alpha * op(A) * op(B) + beta * C with the blocked kernel.
+     *
+     * op(X) is X, or its transpose when the matching flag is set. Transposed
+     * operands are read in their stored layout while packing, no transposed
+     * copy is made.
+     * @param transA Nonzero to use the transpose of A.
+     * @param transB Nonzero to use the transpose of B.
+     * @param m Number of rows of op(A) and C.
+     * @param n Number of columns of op(B) and C.
+     * @param k Number of columns of op(A) and rows of op(B).
+     * @param alpha Scalar applied to the product.
+     * @param a Pointer to A, stored m x k, or k x m when transposed.
+     * @param lda Leading dimension of A as stored.
+     * @param b Pointer to B, stored k x n, or n x k when transposed.
+     * @param ldb Leading dimension of B as stored.
+     * @param beta Scalar applied to C. When 0, C is not read.
+     * @param c Pointer to C (m x n).
+     * @param ldc Leading dimension of C.
+     * @return 0 on success, -1 on failure.
+     * @note The summation order differs from the naive kernel, so results
+     * match it up to rounding: |C - C_naive| <= 2 * k * DBL_EPSILON * (|A| * |B|)
+     * element-wise.
+     * @note Packing buffers are kept per thread and reused, so only calls that
+     * need a larger buffer than before allocate.
+     * @note When m or n is 1 the product is computed by dgemv.
+     * @note When beta is 0 and m, n and k reach the Strassen threshold, the
+     * product uses the Strassen-Winograd recursion, whose weaker error bound
+     * is given with GEMM_STRASSEN_THRESHOLD. Its temporaries take about
+     * (m * max(k, n) + k * n) / 3 elements, allocated for the call.
+     */
+    int (*dgemm)(int transA, int transB, size_t m, size_t n, size_t k,
+        double alpha, const double* a, size_t lda, const double* b, size_t ldb,
+        double beta, double* c, size_t ldc);
+
+    /**
+     * @brief Reference triple loop implementation of dgemm.
+     * @note Kept for testing the blocked kernel. Same parameters as dgemm.
+     */
+    int (*dgemmReference)(int transA, int transB, size_t m, size_t n, size_t k,
+        double alpha, const double* a, size_t lda, const double* b, size_t ldb,
+        double beta, double* c, size_t ldc);
+
+    /**
+     * @brief Single precision dgemm, same parameters.
+     * @note Accumulates in float, so the bound uses FLT_EPSILON instead.
+     */
+    int (*sgemm)(int transA, int transB, size_t m, size_t n, size_t k,
+        double alpha, const float* a, size_t lda, const float* b, size_t ldb,
+        double beta, float* c, size_t ldc);
+
+    /**
+     * @brief Reference triple loop implementation of sgemm.
+     * @note Accumulates in double.
+     */
+    int (*sgemmReference)(int transA, int transB, size_t m, size_t n, size_t k,
+        double alpha, const float* a, size_t lda, const float* b, size_t ldb,
+        double beta, float* c, size_t ldc);
+
+    /**
+     * @brief Computes y = alpha * op(A) * x + beta * y, BLAS style.
+     *
+     * Without transposition every row of A is a dot product with x, done
+     * four rows at a time so they share the loads of x. Transposed, four
+     * rows of A scaled by elements of x are added to y per pass.
+     * @param trans Nonzero to use the transpose of A.
+     * @param m Number of rows of A as stored.
+     * @param n Number of columns of A as stored.
+     * @param alpha Scalar applied to the product.
+     * @param a Pointer to A.
+     * @param lda Leading dimension of A.
+     * @param x Pointer to x, n elements, or m when transposed.
+     * @param incx Distance between two elements of x.
+     * @param beta Scalar applied to y. When 0, y is not read.
+     * @param y Pointer to y, m elements, or n when transposed.
+     * @param incy Distance between two elements of y.
+     * @return 0 on success, -1 on failure.
+     * @note Products with at least GEMV_PARALLEL_THRESHOLD elements in A are
+     * split over the thread pool, with bitwise the same result.
+     */
+    int (*dgemv)(int trans, size_t m, size_t n, double alpha, const double* a,
+        size_t lda, const double* x, size_t incx, double beta, double* y,
+        size_t incy);
+
+    /**
+     * @brief Single precision dgemv, same parameters.
+     */
+    int (*sgemv)(int trans, size_t m, size_t n, double alpha, const float* a,
+        size_t lda, const float* x, size_t incx, double beta, float* y,
+        size_t incy);
+
+    /**
+     * @brief Computes A = alpha * x * y^T + A, the rank-1 update of BLAS GER.
+     *
+     * Four rows of A are updated per pass over y, each row being y scaled by
+     * alpha * x[i] and added in place.
+     * @param m Number of rows of A and elements of x.
+     * @param n Number of columns of A and elements of y.
+     * @param alpha Scalar applied to the outer product.
+     * @param x Pointer to x.
+     * @param incx Distance between two elements of x.
+     * @param y Pointer to y.
+     * @param incy Distance between two elements of y.
+     * @param a Pointer to A (m x n).
+     * @param lda Leading dimension of A.
+     * @return 0 on success, -1 on failure.
+     * @note x and y must not alias A. Updates with at least
+     * GEMV_PARALLEL_THRESHOLD elements are split over the thread pool by
+     * rows, with bitwise the same result.
+     */
+    int (*dger)(size_t m, size_t n, double alpha, const double* x,
+        size_t incx, const double* y, size_t incy, double* a, size_t lda);
+
+    /**
+     * @brief Single precision dger, same parameters.
+     */
+    int (*sger)(size_t m, size_t n, double alpha, const float* x,
+        size_t incx, const float* y, size_t incy, float* a, size_t lda);
+
+    /**
+     * @brief Sets the size from which products use Strassen-Winograd.
+     * @param threshold The threshold, 0 to never use it. Values below 2
+     * act as 2.
+     * @note Applies to both precisions. Must not be called while a product
+     * is running.
+     */
+    void (*setStrassenThreshold)(size_t threshold);
+
+    /**
+     * @brief Selects the implementation of dgemm, dgemv, dger and their
+     * single precision versions.
+     * @param backend The backend.
+     * @return 0 on success, -1 if the backend isn't built in.
+     * @note Must not be called while a product is running. The reference
+     * kernels are always native. Calls with a dimension above INT_MAX stay
+     * native with either backend.
+     */
+    int (*setBackend)(GemmBackend backend);
+
+    /**
+     * @brief Gets the backend in use.
+     */
+    GemmBackend (*getBackend)(void);
+
+    /**
+     * @brief Frees the packing buffers of the calling thread.
+     * @note Threads free theirs when they exit, worker threads of the pool
+     * included. This is for a long-lived thread that is done multiplying.
+     */
+    void (*releaseWorkspace)(void);
+} GemmOps;
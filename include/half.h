@@ -0,0 +1,133 @@
+/**
+ * @file half.h
+ * @brief Interface for matrices stored in 16 bit floating point.
+ *
+ * A half matrix keeps every element in 2 bytes, a quarter of a double,
+ * either as IEEE binary16 (HALF_FP16: 11 bit significand, range up to
+ * 65504) or as bfloat16 (HALF_BF16: 8 bit significand, the range of a
+ * float). Elements are rounded to nearest, ties to even, straight from the
+ * double, and read back exactly.
+ *
+ * Products widen the elements to double in registers and accumulate in
+ * double, as the double kernels do; only the storage is smaller. A
+ * matrix-vector product, bound by the weight reads, reads a quarter of the
+ * bytes. With F16C, fp16 elements are widened with vcvtph2ps; bf16 ones are
+ * the upper half of a float and only need a shift. Products with several
+ * columns widen panels of HALF_PANEL rows and run the double GEMM on them.
+ *
+ * Matrix-vector products with at least HALF_PARALLEL_THRESHOLD elements are
+ * split along rows over the thread pool, each row summed the same way
+ * whatever the split.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "matrix.h"
+
+/**
+ * @brief Elements from which a matrix-vector product runs in parallel.
+ */
+#ifndef HALF_PARALLEL_THRESHOLD
+#define HALF_PARALLEL_THRESHOLD (1u << 18)
+#endif
+
+/**
+ * @brief Rows widened at once for a product with several columns.
+ */
+#ifndef HALF_PANEL
+#define HALF_PANEL 64
+#endif
+
+/**
+ * @brief Opaque pointer to a half matrix structure.
+ */
+typedef struct HalfStruct* Half;
+
+/**
+ * @brief Encoding of the elements, see the file description.
+ */
+typedef enum HalfFormat {
+    HALF_FP16 = 0,
+    HALF_BF16
+} HalfFormat;
+
+/*
+ *	Interface for half matrices.
+ */
+extern const struct HalfInterface{
+
+    /**
+     * @brief Creates a half matrix with all elements 0.
+     * @param row Number of rows.
+     * @param col Number of columns.
+     * @param format Encoding of the elements.
+     * @return A new half matrix, or NULL on failure.
+     */
+    Half (*create)(size_t row, size_t col, HalfFormat format);
+
+    /**
+     * @brief Creates a half matrix from the rounded elements of a matrix.
+     * @param matrix The matrix.
+     * @param format Encoding of the elements.
+     * @return A new half matrix, or NULL on failure.
+     * @note Values beyond the range become infinite.
+     */
+    Half (*fromMatrix)(const Matrix matrix, HalfFormat format);
+
+    /**
+     * @brief Creates a matrix with the elements of a half one.
+     * @param half The half matrix.
+     * @return A new matrix, or NULL on failure.
+     */
+    Matrix (*toMatrix)(const Half half);
+
+    /**
+     * @brief Destroys a half matrix and sets the pointer to NULL.
+     * @param halfAddr Address of the half matrix.
+     */
+    void (*destroy)(Half* halfAddr);
+
+    /**
+     * @brief Gets an element.
+     * @param half The half matrix.
+     * @param row Row of the element.
+     * @param col Column of the element.
+     * @param value Pointer to store the element.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*get)(const Half half, size_t row, size_t col, double* value);
+
+    size_t (*getRow)(const Half half);
+    size_t (*getCol)(const Half half);
+    HalfFormat (*getFormat)(const Half half);
+
+    /**
+     * @brief Rounds a double to a 16 bit encoding.
+     */
+    uint16_t (*encode)(double x, HalfFormat format);
+
+    /**
+     * @brief Widens a 16 bit encoding to a double, exactly.
+     */
+    double (*decode)(uint16_t h, HalfFormat format);
+
+    /**
+     * @brief Multiplies a half matrix by a matrix.
+     * @param half The half matrix, m x k.
+     * @param matrix The matrix, k x n. A column vector gives a GEMV.
+     * @return A new m x n matrix with the product, or NULL on failure.
+     */
+    Matrix (*multiply)(const Half half, const Matrix matrix);
+
+    /**
+     * @brief The operations creating a matrix, writing to an existing one
+     * of the right shape instead.
+     */
+    struct {
+        int (*fromMatrix)(Half dst, const Matrix matrix);
+        int (*toMatrix)(Matrix dst, const Half half);
+        int (*multiply)(Matrix dst, const Half half, const Matrix matrix);
+    } into;
+} HalfOps;
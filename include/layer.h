@@ -1,16 +1,98 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 #include "matrix.h"
+#include "quantized.h"
+#include "half.h"
 
 typedef struct LayerStruct* Layer;
 
+/**
+ * @brief Weight initialization schemes.
+ */
+typedef enum LayerInit {
+    LAYER_INIT_XAVIER = 0,  // Uniform in +-sqrt(6 / (inputSize + outputSize))
+    LAYER_INIT_HE           // Normal with stddev sqrt(2 / inputSize)
+} LayerInit;
+
 extern const struct LayerInterface{
+
+    /**
+     * @brief Creates a layer with initialized weights.
+     * @note The weights use He initialization for relu and leakyRelu of
+     * ActivationOps, Xavier otherwise, drawn under the seed of RandomOps and
+     * its next stream id.
+     */
     Layer (*create)(size_t inputSize, size_t outputSize, 
         double (*activationFunction)(double),
         double (*ActivationDerivative)(double));
+
+    /**
+     * @brief Creates a layer storing its weights in the given precision.
+     * @note Single precision layers are inference only, they work with
+     * feedForwardF and setWeights but can't be trained. MATRIX_INT8,
+     * MATRIX_FP16 and MATRIX_BF16 layers are inference only too, they keep
+     * compressed weights and work with feedForward and setWeights.
+     */
+    Layer (*createWithPrecision)(size_t inputSize, size_t outputSize,
+        double (*activationFunction)(double),
+        double (*ActivationDerivative)(double), MatrixPrecision precision);
     void (*destroy)(Layer* layerAddr);
-    const Matrix (*getWeights)(Layer layer);
+
+    /**
+     * @brief Draws new weights for a layer.
+     * @param layer The layer.
+     * @param init The initialization scheme.
+     * @param seed The seed, see RandomOps.
+     * @param stream Id of the stream.
+     * @return 0 on success, -1 on failure.
+     * @note The same seed and stream give the same weights at either
+     * precision, up to rounding, whatever the number of threads.
+     */
+    int (*initialize)(Layer layer, LayerInit init, uint64_t seed,
+        uint64_t stream);
+
+    /**
+     * @brief Gets the weights of a double precision layer, NULL otherwise.
+     */
+    Matrix (*getWeights)(Layer layer);
+
+    /**
+     * @brief Gets the weights of a single precision layer, NULL otherwise.
+     */
+    MatrixF (*getWeightsF)(Layer layer);
+
+    /**
+     * @brief Gets the weights of a MATRIX_INT8 layer, NULL otherwise.
+     */
+    Quantized (*getWeightsQ)(Layer layer);
+
+    /**
+     * @brief Gets the weights of a MATRIX_FP16 or MATRIX_BF16 layer, NULL
+     * otherwise.
+     */
+    Half (*getWeightsH)(Layer layer);
+
+    /**
+     * @brief Quantizes the weights of a double precision layer, which
+     * becomes a MATRIX_INT8 layer for inference.
+     * @param layer The layer.
+     * @return 0 on success, -1 on failure.
+     * @note The double weights are freed.
+     */
+    int (*quantize)(Layer layer);
+
+    /**
+     * @brief Compresses the weights of a double precision layer for
+     * inference, quantize being the MATRIX_INT8 case.
+     * @param layer The layer.
+     * @param precision MATRIX_INT8, MATRIX_FP16 or MATRIX_BF16.
+     * @return 0 on success, -1 on failure.
+     * @note The double weights are freed.
+     */
+    int (*compress)(Layer layer, MatrixPrecision precision);
+    MatrixPrecision (*getPrecision)(Layer layer);
     double (*(*getActivationFunction)(Layer layer))(double);
     double (*(*getActivationDerivative)(Layer layer))(double);
     size_t (*getInputSize)(Layer layer);
@@ -20,5 +102,6 @@ extern const struct LayerInterface{
     int (*setWeights)(Layer layer, const Matrix weights);
     int (*isValid)(Layer layer);
     int (*feedForward)(Layer layer, const Matrix input, Matrix output);
+    int (*feedForwardF)(Layer layer, const MatrixF input, MatrixF output);
     Matrix (*jacobian)(Layer layer, const Matrix input);
 } LayerOps;
\ No newline at end of file
@@ -0,0 +1,671 @@
+/**
+ * @file matrix_template.h
+ * @brief Matrix interface shared by both element types.
+ *
+ * Included by matrix.h once per element type, after defining:
+ *  MATRIX            handle type, Matrix or MatrixF
+ *  MATRIX_T          element type, double or float
+ *  MATRIX_OTHER      handle type of the other precision
+ *  MATRIX_INTERFACE  tag of the interface structure
+ *  MATRIX_OPS        name of the interface instance
+ * The parameters are undefined at the end of the file.
+ */
+
+/*
+ *	Interface for matrix operations.
+ */
+extern const struct MATRIX_INTERFACE{
+    
+    /**
+     * @brief Creates a new matrix with the specified number of rows and columns.
+     * @param row Number of rows.
+     * @param col Number of columns.
+     * @return A new matrix object, or NULL if creation fails.
+     * @note The data is aligned to MATRIX_ALIGNMENT and rows of at least a cache
+     * line are padded so each starts on one. Widths whose stride would be a
+     * multiple of 4 KiB get one more cache line to avoid cache set aliasing.
+     * @note Data of at most MATRIX_INLINE_SIZE bytes shares one allocation
+     * with the matrix.
+     * @note While the calling thread uses an arena (ArenaOps.use), the matrix is
+     * allocated from it, as are the results of every allocating operation.
+     */
+    MATRIX (*create)(size_t row, size_t col);
+
+    /**
+     * @brief Creates a new matrix with an explicit leading dimension.
+     * @param row Number of rows.
+     * @param col Number of columns.
+     * @param ld Distance in elements between the starts of two rows, at least col.
+     * @return A new matrix object, or NULL if creation fails.
+     * @note The padding between rows is never read or written by the operations.
+     */
+    MATRIX (*createPadded)(size_t row, size_t col, size_t ld);
+
+    /**
+     * @brief Destroys a matrix and frees its memory.
+     * @param matrixAddr Address of the matrix to destroy.
+     * @note Matrices from an arena are only freed by resetting the arena.
+     */
+    void (*destroy)(MATRIX* matrixAddr);
+
+    /**
+     * @brief Creates a view of a block of a matrix without copying its data.
+     *
+     * The view aliases the elements of the matrix, writes through either of them are
+     * visible in both. Every MatrixOps function accepts views in place of matrices.
+     * Destroying a view frees only the view itself.
+     * @param matrix The matrix to view, can be a view itself.
+     * @param rowStart The first row of the block.
+     * @param colStart The first column of the block.
+     * @param row Number of rows of the block.
+     * @param col Number of columns of the block.
+     * @return A new view, or NULL if the block doesn't fit in the matrix.
+     * @note The matrix must outlive the view. A matrix sharing its data with a
+     * copy gets its own first, and isn't shared again while the view lives.
+     * Views from an arena are never destroyed, so they keep it unshared.
+     */
+    MATRIX (*view)(const MATRIX matrix, size_t rowStart, size_t colStart,
+        size_t row, size_t col);
+
+    /**
+     * @brief Moves a view to another block of the same shape in its matrix.
+     *
+     * Useful for walking mini-batches or tiles of a matrix with a single view.
+     * @param view The view to move.
+     * @param rowStart The new first row of the block.
+     * @param colStart The new first column of the block.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*moveView)(MATRIX view, size_t rowStart, size_t colStart);
+
+    /**
+     * @brief Gets the value at the specified row and column.
+     * @param matrix The matrix object.
+     * @param row The row index.
+     * @param col The column index.
+     * @param value Pointer to store the value at the specified position.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*get)(MATRIX matrix, size_t row, size_t col, MATRIX_T* value);
+
+    /**
+     * @brief Sets the value at the specified row and column.
+     * @param matrix The matrix object.
+     * @param row The row index.
+     * @param col The column index.
+     * @param value The value to set.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*set) (MATRIX matrix, size_t row, size_t col, MATRIX_T value);
+
+    /**
+     * @brief Gets the number of rows in the matrix.
+     * @param matrix The matrix object.
+     * @return The number of rows.
+     */
+    size_t (*getRow)(MATRIX matrix);
+
+    /**
+     * @brief Gets the number of columns in the matrix.
+     * @param matrix The matrix object.
+     * @return The number of columns.
+     */
+    size_t (*getCol)(MATRIX matrix);
+
+    /**
+     * @brief Gets the leading dimension of the matrix.
+     * @param matrix The matrix object.
+     * @return The distance in elements between the starts of two rows.
+     */
+    size_t (*getLd)(MATRIX matrix);
+
+    /**
+     * @brief Gets the elements of the matrix, for kernels working on raw arrays.
+     * @param matrix The matrix object.
+     * @return Pointer to the first element, or NULL on failure. Element (i, j)
+     * is at index i * ld + j.
+     * @note The pointer can be written through, so a matrix sharing its data
+     * with a copy gets its own first. It is valid until the matrix is copied.
+     * Readers use getDataConst, which leaves shared data shared.
+     */
+    MATRIX_T* (*getData)(MATRIX matrix);
+
+    /**
+     * @brief Gets the elements of the matrix for reading only.
+     * @param matrix The matrix object.
+     * @return Pointer to the first element, or NULL on failure. Element (i, j)
+     * is at index i * ld + j.
+     * @note The elements may be shared with copies of the matrix. The pointer
+     * is valid until the matrix, or a view of it, is written.
+     */
+    const MATRIX_T* (*getDataConst)(const MATRIX matrix);
+
+    /**
+     * @brief Adds matrix2 to matrix1.
+     * @param matrix1 The matrix to add to.
+     * @param matrix2 The matrix to add.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*add)(MATRIX matrix1, const MATRIX matrix2);
+
+    /**
+     * @brief Subtracts matrix2 from matrix1.
+     * @param matrix1 The matrix to subtract from.
+     * @param matrix2 The matrix to subtract.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*subtract)(MATRIX matrix1, const MATRIX Matrix2);
+
+    /**
+     * @brief Multiplies the matrix by a scalar.
+     * @param matrix The matrix to multiply.
+     * @param scalar The scalar value.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*scalarMultiply)(MATRIX matrix, double scalar);
+
+    /**
+     * @brief Applies a unary function to all elements of the matrix.
+     * @param matrix The matrix to modify.
+     * @param func The unary function to apply.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*applyToAllUnary)(MATRIX matrix, double (*func)(double));
+
+    /**
+     * @brief Applies a binary function to all elements of the matrix with a given value.
+     * @param matrix The matrix to modify.
+     * @param func The binary function to apply.
+     * @param value The value to use with the binary function.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*applyToAllBinary)(MATRIX matrix, double (*func)(double, double), double value);
+
+    /**
+     * @brief Applies a binary function element-wise between two matrices.
+     * @param matrix1 The first matrix.
+     * @param matrix2 The second matrix.
+     * @param func The binary function to apply.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*elementWise)(MATRIX matrix1, const MATRIX matrix2, double (*func)(double, double));
+    
+    /**
+     * @brief Out-of-place operations.
+     */
+    struct {
+        /**
+         * @brief Adds two matrices and returns the result as a new matrix.
+         * @param matrix1 The first matrix.
+         * @param matrix2 The second matrix.
+         * @return A new matrix that is the result of adding matrix1 and matrix2, or NULL on failure.
+         */
+        MATRIX (*add)(const MATRIX matrix1, const MATRIX matrix2);
+        
+        /**
+         * @brief Subtracts the second matrix from the first matrix and returns the result as a new matrix.
+         * @param matrix1 The first matrix.
+         * @param matrix2 The second matrix.
+         * @return A new matrix that is the result of subtracting matrix2 from matrix1, or NULL on failure.
+         */
+        MATRIX (*subtract)(const MATRIX matrix1, const MATRIX matrix2);
+        
+        /**
+         * @brief Multiplies a matrix by a scalar and returns the result as a new matrix.
+         * @param matrix The matrix to multiply.
+         * @param scalar The scalar value.
+         * @return A new matrix that is the result of multiplying the matrix by the scalar, or NULL on failure.
+         */
+        MATRIX (*scalarMultiply)(const MATRIX matrix, double scalar);
+        
+        /**
+         * @brief Applies a unary function to all elements of a matrix and returns the result as a new matrix.
+         * @param matrix The matrix to modify.
+         * @param func The unary function to apply.
+         * @return A new matrix that is the result of applying the unary function to all elements, or NULL on failure.
+         */
+        MATRIX (*applyToAllUnary)(const MATRIX matrix, double (*func)(double));
+        
+        /**
+         * @brief Applies a binary function to all elements of a matrix with a given value and returns the result as a new matrix.
+         * @param matrix The matrix to modify.
+         * @param func The binary function to apply.
+         * @param value The value to use with the binary function.
+         * @return A new matrix that is the result of applying the binary function to all elements with the given value, or NULL on failure.
+         */
+        MATRIX (*applyToAllBinary)(const MATRIX matrix, double (*func)(double, double), double value);
+        
+        /**
+         * @brief Applies a binary function element-wise between two matrices and returns the result as a new matrix.
+         * @param matrix1 The first matrix.
+         * @param matrix2 The second matrix.
+         * @param func The binary function to apply.
+         * @return A new matrix that is the result of applying the binary function element-wise between the two matrices, or NULL on failure.
+         */
+        MATRIX (*elementWise)(const MATRIX matrix1, const MATRIX matrix2, double (*func)(double, double));
+    } outOfPlace;
+
+    /**
+     * @brief Destination-passing operations.
+     *
+     * These write their result into a caller-owned matrix instead of allocating one,
+     * so they can be used in loops without any heap allocation.
+     * The destination must already have the shape of the result.
+     * A destination sharing only some elements with an operand, such as a view
+     * shifted from it, gets the result through a temporary; the products and
+     * the transpose reject it.
+     */
+    struct {
+        /**
+         * @brief Adds two matrices into dst.
+         * @param dst The matrix to store the result in.
+         * @param matrix1 The first matrix.
+         * @param matrix2 The second matrix.
+         * @return 0 on success, -1 on failure.
+         * @note dst may be one of the operands.
+         */
+        int (*add)(MATRIX dst, const MATRIX matrix1, const MATRIX matrix2);
+
+        /**
+         * @brief Subtracts matrix2 from matrix1 into dst.
+         * @param dst The matrix to store the result in.
+         * @param matrix1 The first matrix.
+         * @param matrix2 The second matrix.
+         * @return 0 on success, -1 on failure.
+         * @note dst may be one of the operands.
+         */
+        int (*subtract)(MATRIX dst, const MATRIX matrix1, const MATRIX matrix2);
+
+        /**
+         * @brief Multiplies a matrix by a scalar into dst.
+         * @param dst The matrix to store the result in.
+         * @param matrix The matrix to multiply.
+         * @param scalar The scalar value.
+         * @return 0 on success, -1 on failure.
+         * @note dst may be the same matrix as the input.
+         */
+        int (*scalarMultiply)(MATRIX dst, const MATRIX matrix, double scalar);
+
+        /**
+         * @brief Applies a unary function to all elements of a matrix into dst.
+         * @param dst The matrix to store the result in.
+         * @param matrix The input matrix.
+         * @param func The unary function to apply.
+         * @return 0 on success, -1 on failure.
+         * @note dst may be the same matrix as the input.
+         */
+        int (*applyToAllUnary)(MATRIX dst, const MATRIX matrix, double (*func)(double));
+
+        /**
+         * @brief Applies a binary function to all elements of a matrix with a given value into dst.
+         * @param dst The matrix to store the result in.
+         * @param matrix The input matrix.
+         * @param func The binary function to apply.
+         * @param value The value to use with the binary function.
+         * @return 0 on success, -1 on failure.
+         * @note dst may be the same matrix as the input.
+         */
+        int (*applyToAllBinary)(MATRIX dst, const MATRIX matrix,
+            double (*func)(double, double), double value);
+
+        /**
+         * @brief Applies a binary function element-wise between two matrices into dst.
+         * @param dst The matrix to store the result in.
+         * @param matrix1 The first matrix.
+         * @param matrix2 The second matrix.
+         * @param func The binary function to apply.
+         * @return 0 on success, -1 on failure.
+         * @note dst may be one of the operands.
+         */
+        int (*elementWise)(MATRIX dst, const MATRIX matrix1, const MATRIX matrix2,
+            double (*func)(double, double));
+
+        /**
+         * @brief Multiplies two matrices into dst.
+         * @param dst The matrix to store the result in, matrix1 rows x matrix2 columns.
+         * @param matrix1 The first matrix.
+         * @param matrix2 The second matrix.
+         * @return 0 on success, -1 on failure.
+         * @note dst can't be one of the operands.
+         */
+        int (*multiply)(MATRIX dst, const MATRIX matrix1, const MATRIX matrix2);
+
+        /**
+         * @brief Multiplies two matrices, either of them transposed, into dst.
+         * @param dst The matrix to store the result in.
+         * @param matrix1 The first matrix.
+         * @param transpose1 Nonzero to use the transpose of matrix1.
+         * @param matrix2 The second matrix.
+         * @param transpose2 Nonzero to use the transpose of matrix2.
+         * @return 0 on success, -1 on failure.
+         * @note dst can't be one of the operands.
+         */
+        int (*multiplyTransposed)(MATRIX dst, const MATRIX matrix1, int transpose1,
+            const MATRIX matrix2, int transpose2);
+
+        /**
+         * @brief Transposes a matrix into dst.
+         * @param dst The matrix to store the result in, with the swapped shape.
+         * @param matrix The matrix to transpose.
+         * @return 0 on success, -1 on failure.
+         * @note dst can only be the input matrix when it is square, the
+         * transpose is then done in place.
+         */
+        int (*transpose)(MATRIX dst, const MATRIX matrix);
+
+        /**
+         * @brief Copies a matrix into dst. Same as assignValues.
+         * @param dst The matrix to copy to.
+         * @param matrix The matrix to copy from.
+         * @return 0 on success, -1 on failure.
+         */
+        int (*copy)(MATRIX dst, const MATRIX matrix);
+
+        /**
+         * @brief Converts a matrix of the other precision into dst.
+         * @param dst The matrix to store the result in, with the same shape.
+         * @param matrix The matrix to convert.
+         * @return 0 on success, -1 on failure.
+         */
+        int (*convert)(MATRIX dst, const MATRIX_OTHER matrix);
+    } into;
+
+    /**
+     * @brief Predefined unary functions for matrix operations.
+     */
+    struct {
+        /**
+         * @brief Computes the absolute value of a given number.
+         * @param value The input value.
+         * @return The absolute value of the input.
+         */
+        double (*abs)(double value);
+    } fUnary;
+
+    /**
+     * @brief Predefined binary functions for matrix operations.
+     */
+    struct {
+        /**
+         * @brief Adds two values.
+         * @param matrixValue The value from the matrix.
+         * @param value The value to add to the matrix value.
+         * @return The result of adding matrixValue and value.
+         */
+        double (*add)(double matrixValue, double value);
+    
+        /**
+         * @brief Multiplies two values.
+         * @param matrixValue The value from the matrix.
+         * @param value The value to multiply with the matrix value.
+         * @return The result of multiplying matrixValue and value.
+         */
+        double (*mul)(double matrixValue, double value);
+    } fBinary;
+
+    /**
+     * @brief Multiplies two matrices.
+     * @param matrix1 The first matrix.
+     * @param matrix2 The second matrix.
+     * @return A new matrix that is the result of multiplying matrix1 and matrix2, or NULL on failure.
+     * @note Uses the cache-blocked kernel from gemm.h. The summation order differs from
+     * a plain triple loop, so each element matches it within 2 * k * EPSILON * (|A| * |B|),
+     * where k is the shared dimension and EPSILON is DBL_EPSILON or FLT_EPSILON.
+     * Products with every dimension at the Strassen threshold or above use
+     * Strassen-Winograd, with the weaker normwise bound in gemm.h. Small products of
+     * one of GEMM_SMALL_SIZES run an unrolled kernel for that size.
+     */
+    MATRIX (*multiply)(const MATRIX matrix1, const MATRIX matrix2);
+
+    /**
+     * @brief Multiplies two matrices, either of them transposed.
+     *
+     * Computes op(matrix1) * op(matrix2) where op is the identity or the transpose
+     * depending on the flags. The transposed operands are read in place, so
+     * multiplyTransposed(a, 0, b, 1) costs the same as multiply(a, b) while
+     * multiply(a, transpose(b)) copies b first.
+     * @param matrix1 The first matrix.
+     * @param transpose1 Nonzero to use the transpose of matrix1.
+     * @param matrix2 The second matrix.
+     * @param transpose2 Nonzero to use the transpose of matrix2.
+     * @return A new matrix with the product, or NULL on failure.
+     */
+    MATRIX (*multiplyTransposed)(const MATRIX matrix1, int transpose1,
+        const MATRIX matrix2, int transpose2);
+
+    /**
+     * @brief Adds alpha * u * v^T to a matrix in place, a rank-1 update.
+     *
+     * u and v are vectors, each either a row or a column, so a column of
+     * output errors and a column of layer inputs give the weight gradient
+     * without transposing. Uses the vectorized kernel from gemm.h instead of
+     * an element by element loop.
+     * @param matrix The matrix to update, u's length x v's length.
+     * @param alpha Scalar applied to the outer product.
+     * @param u The vector giving the rows.
+     * @param v The vector giving the columns.
+     * @return 0 on success, -1 on failure.
+     * @note u and v must not alias the matrix.
+     */
+    int (*rankOneUpdate)(MATRIX matrix, double alpha, const MATRIX u,
+        const MATRIX v);
+
+    /**
+     * @brief Operations applying a vector to every row or every column.
+     *
+     * A 1 x col vector applies to every row, a row x 1 vector to every
+     * column, element i to row i.
+     */
+    struct {
+        /**
+         * @brief Adds a vector to every row or column of a matrix.
+         * @param matrix The matrix to add to.
+         * @param vector The vector to add.
+         * @return 0 on success, -1 on failure.
+         * @note vector must not alias the matrix.
+         */
+        int (*add)(MATRIX matrix, const MATRIX vector);
+
+        /**
+         * @brief Multiplies every row or column of a matrix element-wise by a vector.
+         * @param matrix The matrix to scale.
+         * @param vector The vector of factors.
+         * @return 0 on success, -1 on failure.
+         * @note vector must not alias the matrix.
+         */
+        int (*scale)(MATRIX matrix, const MATRIX vector);
+    } broadcast;
+
+    /**
+     * @brief Reductions of every row or every column into a vector.
+     *
+     * A 1 x col destination gets one result per column, a row x 1 one
+     * gets one result per row. The destination must not alias the matrix.
+     */
+    struct {
+        /**
+         * @brief Sums the rows or the columns of a matrix into dst.
+         * @param dst The vector to store the sums in.
+         * @param matrix The matrix to sum.
+         * @return 0 on success, -1 on failure.
+         * @note Each row is summed as the sum operation does. Columns are
+         * summed pairwise over blocks of REDUCE_PAIRWISE_BLOCK rows, in double.
+         */
+        int (*sum)(MATRIX dst, const MATRIX matrix);
+
+        /**
+         * @brief Averages the rows or the columns of a matrix into dst.
+         * @param dst The vector to store the means in.
+         * @param matrix The matrix to average.
+         * @return 0 on success, -1 on failure.
+         */
+        int (*mean)(MATRIX dst, const MATRIX matrix);
+
+        /**
+         * @brief Finds the largest element of each row or column into dst.
+         * @param dst The vector to store the maxima in.
+         * @param matrix The matrix to search.
+         * @return 0 on success, -1 on failure.
+         * @note NaNs are skipped, a result is NaN only if all of its elements are.
+         */
+        int (*max)(MATRIX dst, const MATRIX matrix);
+
+        /**
+         * @brief Finds the index of the largest element of each row or column.
+         * @param indices Array to store the indices in, one per row for
+         * MATRIX_EACH_ROW and one per column for MATRIX_EACH_COL.
+         * @param matrix The matrix to search.
+         * @param axis The axis giving one result each.
+         * @return 0 on success, -1 on failure.
+         * @note Ties give the first index. NaNs are skipped, a row or column
+         * of NaNs gives 0.
+         */
+        int (*argmax)(size_t* indices, const MATRIX matrix, MatrixAxis axis);
+    } reduce;
+
+    /**
+     * @brief Computes the sum of all elements in a matrix.
+     * @param matrix The matrix to sum.
+     * @param result Pointer to store the sum.
+     * @return 0 on success, -1 on failure.
+     * @note Double matrices sum pairwise (REDUCE_PAIRWISE), see reduce.h for
+     * other accuracy modes, dot products, norms and maxima.
+     */
+    int (*sum)(const MATRIX matrix, double* result);
+
+    /**
+     * @brief Fills a matrix with a specified value.
+     * @param matrix The matrix to fill.
+     * @param value The value to fill the matrix with.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*fill)(MATRIX matrix, double value);
+ 
+    /**
+     * @brief Transposes a matrix.
+     * @param matrix The matrix to transpose.
+     * @return A new matrix that is the transposed result of the input matrix, or NULL on failure.
+     */
+    MATRIX (*transpose)(const MATRIX matrix);
+
+    /**
+     * @brief Transposes a square matrix in place.
+     * @param matrix The matrix to transpose.
+     * @return 0 on success, -1 on failure or if the matrix is not square.
+     * @note Uses no extra memory, unlike transpose.
+     */
+    int (*transposeInPlace)(MATRIX matrix);
+
+    /**
+     * @brief Copies a matrix.
+     * @param matrix The matrix to copy.
+     * @return A new matrix that is a copy of the input matrix, or NULL on failure.
+     * @note Outside an arena, data bigger than MATRIX_INLINE_SIZE is shared and
+     * counted, and only copied by the first write to either matrix. A copy can
+     * then be read by another thread while the original is written. Matrices
+     * with live views are copied right away.
+     */
+    MATRIX (*copy)(const MATRIX matrix);
+
+    /**
+     * @brief Converts a matrix of the other precision.
+     * @param matrix The matrix to convert.
+     * @return A new matrix with the values of the input rounded to this precision,
+     * or NULL on failure.
+     */
+    MATRIX (*convert)(const MATRIX_OTHER matrix);
+
+    /**
+     * @brief Copies a submatrix of a matrix.
+     * @note Use view to work on a submatrix without copying it.
+     * @param matrix The matrix to copy from.
+     * @param rowStart The starting row index.
+     * @param rowEnd The ending row index.
+     * @param colStart The starting column index.
+     * @param colEnd The ending column index.
+     * @return A new matrix that is a copy of the submatrix, or NULL on failure.
+     */
+    MATRIX (*copySubMatrix)(const MATRIX matrix, size_t rowStart, size_t rowEnd, 
+        size_t colStart, size_t colEnd);
+
+    /**
+     * @brief Appends a row to a matrix.
+     * @param matrix The matrix to append the row to.
+     * @param row The row to append.
+     * @return A new matrix that is the result of appending the row to the matrix, or NULL on failure.
+     */
+    MATRIX (*appendRow)(const MATRIX matrix, const MATRIX row);
+
+    /**
+     * @brief Appends a column to a matrix.
+     * @param matrix The matrix to append the column to.
+     * @param col The column to append.
+     * @return A new matrix that is the result of appending the column to the matrix, or NULL on failure.
+     */
+    MATRIX (*appendCol)(const MATRIX matrix, const MATRIX col);
+
+    /**
+     * @brief Randomizes the elements of a matrix within a specified range.
+     * @param matrix The matrix to randomize.
+     * @param min The minimum value for the random range.
+     * @param max The maximum value for the random range.
+     * @return 0 on success, -1 on failure.
+     * @note The values come from RandomOps, under the seed set with RandomOps.setSeed and
+     * the next stream id. They don't depend on the number of threads or the padding.
+     */
+    int (*randomize)(MATRIX matrix, double min, double max);
+
+    /**
+     * @brief Copies the new matrix to given address with destroying the old one.
+     * @param oldMatrixAddr Address of the pointer to the old matrix to replace.
+     * @param newMatrix The new matrix.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*replace)(MATRIX* oldMatrixAddr, const MATRIX newMatrix);
+
+    /**
+     * @brief Assigns the values of matrix2 to matrix1.
+     * @param matrix1 The matrix to assign to.
+     * @param matrix2 The matrix to assign from.
+     * @return 0 on success, -1 on failure.
+     * @note The dimensions of matrix1 and matrix2 must match.
+     */
+    int (*assignValues)(MATRIX matrix1, const MATRIX matrix2);
+
+    /**
+     * @brief Checks if a matrix is valid.
+     * @param matrix The matrix to check.
+     * @return 1 if the matrix is valid, 0 if invalid.
+     */
+    int (*isValid)(const MATRIX matrix);
+
+    /**
+     * @brief Checks if two matrices have the same shape.
+     * @param matrix1 The first matrix.
+     * @param matrix2 The second matrix.
+     * @return 1 if the matrices have the same shape, 0 if not.
+     */
+    int (*isSameShape)(const MATRIX matrix1, const MATRIX matrix2);
+
+    /**
+     * @brief Checks if the memory spanned by two valid matrices intersects.
+     * @param matrix1 The first matrix.
+     * @param matrix2 The second matrix.
+     * @return 1 if they may share elements, 0 if not.
+     * @note Data shared with a copy counts, so kernels writing a destination
+     * call getData on it before checking it against their operands.
+     */
+    int (*overlaps)(const MATRIX matrix1, const MATRIX matrix2);
+
+    /**
+     * @brief Prints the elements of a matrix to the standard output.
+     * @param matrix The matrix to print.
+     */
+    void (*print)(const MATRIX matrix);
+} MATRIX_OPS;
+
+#undef MATRIX
+#undef MATRIX_T
+#undef MATRIX_OTHER
+#undef MATRIX_INTERFACE
+#undef MATRIX_OPS
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stddef.h>
+#include "matrix.h"
 
 typedef struct NeuralNetworkStruct* NeuralNetwork;
 
@@ -15,11 +16,29 @@ extern const struct NeuralNetworkInterface{
         double (*activationDerivative)(double),
         double (*errorFunction)(double, double),
         double (*errorDerivative)(double, double));
+
+    /**
+     * @brief Same as create, with the weights stored in the given precision.
+     * @note Single precision networks are inference only, use feedForwardF.
+     * MATRIX_INT8, MATRIX_FP16 and MATRIX_BF16 networks are inference only
+     * too, with compressed weights, use feedForward.
+     */
+    NeuralNetwork (*createWithPrecision)(size_t inputSize, size_t outputSize,
+        NeuralNetworkLayer* hiddenLayers, size_t hiddenLayerCount,
+        double (*activationFunction)(double),
+        double (*activationDerivative)(double),
+        double (*errorFunction)(double, double),
+        double (*errorDerivative)(double, double), MatrixPrecision precision);
     void (*destroy)(NeuralNetwork* nnAddr);
     NeuralNetworkLayer (*layerOf)(size_t inputSize, size_t outputSize,
         double (*activationFunction)(double),
         double (*activationDerivative)(double));
     int (*feedForward)(NeuralNetwork nn, const double* input, double* output);
+
+    /**
+     * @brief feedForward for networks created with MATRIX_FLOAT.
+     */
+    int (*feedForwardF)(NeuralNetwork nn, const float* input, float* output);
     // int (*setActivationFunction)(NeuralNetwork nn, double (*activationFunction)(double));
     // int (*setErrorFunction)(NeuralNetwork nn, double (*errorFunction)(double, double));
     // int (*setLearningRate)(NeuralNetwork nn, double learningRate);
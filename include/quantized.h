@@ -0,0 +1,141 @@
+/**
+ * @file quantized.h
+ * @brief Interface for int8 matrices with a scale and zero point per row.
+ *
+ * Row i of a quantized matrix stands for scale[i] * (q - zeroPoint[i]),
+ * with q in [-127, 127]. The range of every row is stretched to include 0,
+ * which then has an exact representation, and split in 254 steps, so an
+ * element is off by at most half a step. The storage is an eighth of a
+ * double matrix.
+ *
+ * Products run in integers: int8 x int8 products summed in int32, exact
+ * whatever the order, so the results are the same at every SIMD level and
+ * thread count. The dense operand of multiply is quantized per column on
+ * the fly, and the zero points are taken out of the integer sums with the
+ * row sums of both operands.
+ *
+ * The AVX2 kernel multiplies with vpmaddubsw, unsigned by signed bytes into
+ * pairs summed in int16: |a| times b with the sign of a. Leaving -128 out of
+ * the range keeps these pairs below 2 * 127 * 127, so they never saturate.
+ * CPUs with AVX-512 VNNI sum groups of four straight into int32 with
+ * vpdpbusd.
+ *
+ * Products with at least QUANTIZED_PARALLEL_THRESHOLD multiply-adds are
+ * split over the thread pool.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "matrix.h"
+
+/**
+ * @brief Multiply-adds from which a product runs in parallel.
+ */
+#ifndef QUANTIZED_PARALLEL_THRESHOLD
+#define QUANTIZED_PARALLEL_THRESHOLD (1u << 18)
+#endif
+
+/**
+ * @brief Opaque pointer to a quantized matrix structure.
+ */
+typedef struct QuantizedStruct* Quantized;
+
+/*
+ *	Interface for quantized matrices.
+ */
+extern const struct QuantizedInterface{
+
+    /**
+     * @brief Creates a quantized matrix with all elements 0.
+     * @param row Number of rows.
+     * @param col Number of columns.
+     * @return A new quantized matrix, or NULL on failure.
+     */
+    Quantized (*create)(size_t row, size_t col);
+
+    /**
+     * @brief Quantizes a matrix, see the file description.
+     * @param matrix The matrix, with finite elements.
+     * @return A new quantized matrix, or NULL on failure.
+     */
+    Quantized (*quantize)(const Matrix matrix);
+
+    /**
+     * @brief Creates the matrix a quantized one stands for.
+     * @param quantized The quantized matrix.
+     * @return A new matrix, or NULL on failure.
+     */
+    Matrix (*dequantize)(const Quantized quantized);
+
+    /**
+     * @brief Destroys a quantized matrix and sets the pointer to NULL.
+     * @param quantizedAddr Address of the quantized matrix.
+     */
+    void (*destroy)(Quantized* quantizedAddr);
+
+    /**
+     * @brief Gets the value an element stands for.
+     * @param quantized The quantized matrix.
+     * @param row Row of the element.
+     * @param col Column of the element.
+     * @param value Pointer to store the value.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*get)(const Quantized quantized, size_t row, size_t col,
+        double* value);
+
+    size_t (*getRow)(const Quantized quantized);
+    size_t (*getCol)(const Quantized quantized);
+
+    /**
+     * @brief Gets the int8 elements, row i starting at i * getLd.
+     */
+    const int8_t* (*getData)(const Quantized quantized);
+    size_t (*getLd)(const Quantized quantized);
+
+    /**
+     * @brief Gets the scale of a row, 0 on failure.
+     */
+    double (*getScale)(const Quantized quantized, size_t row);
+
+    /**
+     * @brief Gets the zero point of a row, 0 on failure.
+     */
+    int (*getZeroPoint)(const Quantized quantized, size_t row);
+
+    /**
+     * @brief Computes C = A * B^T in integers.
+     * @param m Rows of A and C.
+     * @param n Rows of B, columns of C.
+     * @param k Columns of A and B.
+     * @param a A, m x k with leading dimension lda.
+     * @param b B, n x k with leading dimension ldb.
+     * @param c C, m x n with leading dimension ldc.
+     * @return 0 on success, -1 on failure.
+     * @note Elements of A and B must be in [-127, 127]. Rows of both are
+     * read contiguously, n == 1 is a matrix-vector product.
+     */
+    int (*gemm)(size_t m, size_t n, size_t k, const int8_t* a, size_t lda,
+        const int8_t* b, size_t ldb, int32_t* c, size_t ldc);
+
+    /**
+     * @brief Multiplies a quantized matrix by a dense one.
+     * @param quantized The quantized matrix, m x k.
+     * @param matrix The dense matrix, k x n, quantized per column first.
+     * @return A new m x n matrix with the product, or NULL on failure.
+     */
+    Matrix (*multiply)(const Quantized quantized, const Matrix matrix);
+
+    /**
+     * @brief The operations creating a matrix, writing to an existing one
+     * of the right shape instead.
+     */
+    struct {
+        int (*quantize)(Quantized dst, const Matrix matrix);
+        int (*dequantize)(Matrix dst, const Quantized quantized);
+        int (*multiply)(Matrix dst, const Quantized quantized,
+            const Matrix matrix);
+    } into;
+} QuantizedOps;
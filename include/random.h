@@ -0,0 +1,133 @@
+/**
+ * @file random.h
+ * @brief Interface for counter-based random number generation.
+ *
+ * The generator is Philox4x32-10 (Salmon et al., Parallel Random Numbers:
+ * As Easy as 1, 2, 3, 2011). It has no state: it encrypts a 128 bit counter
+ * with a 64 bit key in 10 rounds of multiplications, and the result is four
+ * 32 bit words that pass BigCrush. Element i of the stream with id stream
+ * under seed is made from the block with counter (i / 2, stream) and key
+ * seed, so any element can be computed without the ones before it.
+ *
+ * That makes every fill reproducible: a seed, a stream id and an offset give
+ * the same values whatever the number of threads, the SIMD level, the block
+ * size, or the padding of a matrix, whose element (i, j) is element
+ * offset + i * col + j of its stream. Different stream ids give independent
+ * sequences under the same seed, 2^64 of them with 2^65 elements each.
+ *
+ * Fills of at least RANDOM_CHUNK elements run on the thread pool.
+ *
+ * Uniform values have 52 random bits and lie in [min, max). Normal values
+ * come from the Box-Muller transform of two uniforms, one block per pair.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "matrix.h"
+
+/**
+ * @brief Elements generated by one task of a parallel fill.
+ */
+#ifndef RANDOM_CHUNK
+#define RANDOM_CHUNK (1u << 16)
+#endif
+
+/**
+ * @brief Seed used until setSeed is called.
+ */
+#ifndef RANDOM_DEFAULT_SEED
+#define RANDOM_DEFAULT_SEED 0x853C49E6748FEA9Bull
+#endif
+
+/*
+ *	Interface for random number generation.
+ */
+extern const struct RandomInterface{
+
+    /**
+     * @brief Computes one Philox4x32-10 block.
+     * @param counter The 128 bit counter, as four words.
+     * @param key The 64 bit key, as two words.
+     * @param out Pointer to store the four random words.
+     */
+    void (*block)(const uint32_t counter[4], const uint32_t key[2],
+        uint32_t out[4]);
+
+    /**
+     * @brief Fills x with uniform values in [min, max).
+     * @param seed The seed.
+     * @param stream Id of the stream.
+     * @param offset Index in the stream of the first element.
+     * @param x The array.
+     * @param n Number of elements.
+     * @param min Lower bound, included.
+     * @param max Upper bound, excluded.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*uniform)(uint64_t seed, uint64_t stream, uint64_t offset,
+        double* x, size_t n, double min, double max);
+
+    /**
+     * @brief Fills x with normal values.
+     * @param seed The seed.
+     * @param stream Id of the stream.
+     * @param offset Index in the stream of the first element.
+     * @param x The array.
+     * @param n Number of elements.
+     * @param mean Mean of the distribution.
+     * @param stddev Standard deviation of the distribution.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*normal)(uint64_t seed, uint64_t stream, uint64_t offset,
+        double* x, size_t n, double mean, double stddev);
+
+    /**
+     * @brief Single precision uniform, the same values rounded to float.
+     */
+    int (*uniformF)(uint64_t seed, uint64_t stream, uint64_t offset,
+        float* x, size_t n, double min, double max);
+
+    /**
+     * @brief Single precision normal, the same values rounded to float.
+     */
+    int (*normalF)(uint64_t seed, uint64_t stream, uint64_t offset,
+        float* x, size_t n, double mean, double stddev);
+
+    /**
+     * @brief The same fills on all elements of a matrix, from offset 0.
+     */
+    struct {
+        int (*uniform)(Matrix matrix, uint64_t seed, uint64_t stream,
+            double min, double max);
+        int (*normal)(Matrix matrix, uint64_t seed, uint64_t stream,
+            double mean, double stddev);
+        int (*uniformF)(MatrixF matrix, uint64_t seed, uint64_t stream,
+            double min, double max);
+        int (*normalF)(MatrixF matrix, uint64_t seed, uint64_t stream,
+            double mean, double stddev);
+    } matrix;
+
+    /**
+     * @brief Sets the seed of the fills that don't take one, and restarts
+     * their stream ids from 0.
+     * @param seed The seed.
+     * @note MatrixOps.randomize and LayerOps.create draw from these, each
+     * call from the next stream id. The same seed then gives the same
+     * sequence of matrices.
+     */
+    void (*setSeed)(uint64_t seed);
+
+    /**
+     * @brief Gets the seed set with setSeed.
+     */
+    uint64_t (*seed)(void);
+
+    /**
+     * @brief Reserves a stream id under the seed set with setSeed.
+     * @return A stream id no other call returned since the last setSeed.
+     * @note Thread safe.
+     */
+    uint64_t (*nextStream)(void);
+} RandomOps;
@@ -0,0 +1,134 @@
+/**
+ * @file reduce.h
+ * @brief Interface for reductions of arrays and matrices to a single value.
+ *
+ * Sums and dot products can trade speed for accuracy through ReduceMode:
+ *  - REDUCE_FAST adds into several vector accumulators, which hides the
+ *    latency of the add chain. Its error grows like n * DBL_EPSILON.
+ *  - REDUCE_PAIRWISE sums blocks of REDUCE_PAIRWISE_BLOCK elements the fast
+ *    way and adds the block sums as a balanced tree, so the error grows like
+ *    log2(n) * DBL_EPSILON for nearly the same speed.
+ *  - REDUCE_KAHAN carries the rounding error of every addition in a second
+ *    accumulator (Neumaier's variant, and the exact products of fma for a
+ *    dot product). The result is as accurate as if computed in twice the
+ *    precision and then rounded, at about twice the cost.
+ *
+ * Arrays longer than REDUCE_CHUNK are cut into chunks of that length, which
+ * are reduced on the thread pool and combined in a fixed order. Since the
+ * chunks don't depend on the number of threads, neither does the result:
+ * the same input gives the same bits on 1 or 32 threads.
+ *
+ * max and argmax ignore NaN elements.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include "matrix.h"
+
+/**
+ * @brief Elements reduced by one task, fixed so results don't depend on
+ * the number of threads.
+ */
+#ifndef REDUCE_CHUNK
+#define REDUCE_CHUNK (1u << 16)
+#endif
+
+/**
+ * @brief Elements summed the fast way at the leaves of a pairwise sum.
+ */
+#ifndef REDUCE_PAIRWISE_BLOCK
+#define REDUCE_PAIRWISE_BLOCK 256
+#endif
+
+/**
+ * @brief Accuracy of a sum or dot product, see the file description.
+ */
+typedef enum ReduceMode {
+    REDUCE_FAST = 0,
+    REDUCE_PAIRWISE,
+    REDUCE_KAHAN
+} ReduceMode;
+
+/*
+ *	Interface for reductions.
+ */
+extern const struct ReduceInterface{
+
+    /**
+     * @brief Computes the sum of x[i].
+     * @param x The array.
+     * @param n Number of elements.
+     * @param mode Accuracy of the summation.
+     * @param result Pointer to store the sum, 0 when n is 0.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*sum)(const double* x, size_t n, ReduceMode mode, double* result);
+
+    /**
+     * @brief Computes the sum of x[i] * y[i].
+     * @param x The first array.
+     * @param y The second array.
+     * @param n Number of elements.
+     * @param mode Accuracy of the summation.
+     * @param result Pointer to store the dot product.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*dot)(const double* x, const double* y, size_t n, ReduceMode mode,
+        double* result);
+
+    /**
+     * @brief Computes the Euclidean norm of x.
+     * @param x The array.
+     * @param n Number of elements.
+     * @param mode Accuracy of the sum of squares.
+     * @param result Pointer to store the norm.
+     * @return 0 on success, -1 on failure.
+     * @note Rescales when the sum of squares overflows or underflows, so any
+     * finite array gets a finite norm.
+     */
+    int (*norm)(const double* x, size_t n, ReduceMode mode, double* result);
+
+    /**
+     * @brief Finds the largest element of x.
+     * @param x The array.
+     * @param n Number of elements, at least 1.
+     * @param result Pointer to store the largest element, NaN if all are.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*max)(const double* x, size_t n, double* result);
+
+    /**
+     * @brief Finds the first index of the largest element of x.
+     * @param x The array.
+     * @param n Number of elements, at least 1.
+     * @param index Pointer to store the index, 0 if all elements are NaN.
+     * @return 0 on success, -1 on failure.
+     */
+    int (*argmax)(const double* x, size_t n, size_t* index);
+
+    /**
+     * @brief The same reductions over all elements of a matrix.
+     * @note Padded matrices are reduced row by row and the row results
+     * combined with compensation.
+     */
+    struct {
+        int (*sum)(const Matrix matrix, ReduceMode mode, double* result);
+        int (*dot)(const Matrix matrix1, const Matrix matrix2, ReduceMode mode,
+            double* result);
+        int (*norm)(const Matrix matrix, ReduceMode mode, double* result);
+        int (*max)(const Matrix matrix, double* result);
+
+        /**
+         * @brief Finds the position of the largest element, first in row
+         * major order.
+         * @param matrix The matrix.
+         * @param row Pointer to store the row index.
+         * @param col Pointer to store the column index.
+         * @return 0 on success, -1 on failure.
+         * @note A column vector of class scores gives the predicted class
+         * in row.
+         */
+        int (*argmax)(const Matrix matrix, size_t* row, size_t* col);
+    } matrix;
+} ReduceOps;
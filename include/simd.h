@@ -0,0 +1,178 @@
+/**
+ * @file simd.h
+ * @brief Interface for vectorized element-wise kernels.
+ *
+ * This file provides the SIMD kernels behind the element-wise matrix
+ * operations. The instruction set is detected once at startup with cpuid
+ * (SSE2, AVX2 + FMA, AVX-512F) and every call goes to the widest supported
+ * implementation. A scalar implementation is always available.
+ *
+ * Every kernel exists for double and, under f32, for float. Both are
+ * generated from the same source, a float vector just holds twice as many
+ * elements.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * @brief Size in bytes from which fill and copy use non-temporal stores.
+ *
+ * Buffers this large would evict the whole cache for data that is not read
+ * back soon, so they are written around it.
+ */
+#ifndef SIMD_STREAM_THRESHOLD
+#define SIMD_STREAM_THRESHOLD (4u << 20)
+#endif
+
+/**
+ * @brief Instruction set levels, ordered from the narrowest to the widest.
+ */
+typedef enum SimdLevel {
+    SIMD_SCALAR = 0,
+    SIMD_SSE2,
+    SIMD_AVX2,      // AVX2 together with FMA
+    SIMD_AVX512     // AVX-512F
+} SimdLevel;
+
+/*
+ *	Interface for SIMD kernels.
+ */
+extern const struct SimdInterface{
+
+    /**
+     * @brief Gets the instruction set level used by the kernels.
+     * @return The active level.
+     */
+    SimdLevel (*level)(void);
+
+    /**
+     * @brief Gets the widest instruction set level supported by the CPU.
+     * @return The detected level.
+     */
+    SimdLevel (*detectedLevel)(void);
+
+    /**
+     * @brief Selects the instruction set level used by the kernels.
+     * @param level The level to use.
+     * @return 0 on success, -1 if the CPU doesn't support the level.
+     * @note Meant for testing and benchmarking the narrower kernels.
+     */
+    int (*setLevel)(SimdLevel level);
+
+    /**
+     * @brief Computes x[i] += y[i].
+     */
+    void (*add)(double* x, const double* y, size_t n);
+
+    /**
+     * @brief Computes x[i] -= y[i].
+     */
+    void (*subtract)(double* x, const double* y, size_t n);
+
+    /**
+     * @brief Computes x[i] *= alpha.
+     */
+    void (*scale)(double* x, double alpha, size_t n);
+
+    /**
+     * @brief Computes z[i] = x[i] + y[i].
+     */
+    void (*addTo)(double* z, const double* x, const double* y, size_t n);
+
+    /**
+     * @brief Computes z[i] = x[i] - y[i].
+     */
+    void (*subtractTo)(double* z, const double* x, const double* y, size_t n);
+
+    /**
+     * @brief Computes z[i] = alpha * x[i].
+     */
+    void (*scaleTo)(double* z, const double* x, double alpha, size_t n);
+
+    /**
+     * @brief Computes x[i] *= y[i].
+     */
+    void (*multiply)(double* x, const double* y, size_t n);
+
+    /**
+     * @brief Computes x[i] += alpha.
+     */
+    void (*shift)(double* x, double alpha, size_t n);
+
+    /**
+     * @brief Computes x[i] = max(x[i], y[i]).
+     * @note A NaN in y leaves x[i] as it is, a NaN in x[i] is kept.
+     */
+    void (*maximum)(double* x, const double* y, size_t n);
+
+    /**
+     * @brief Sets x[i] = value.
+     * @note Uses non-temporal stores from SIMD_STREAM_THRESHOLD bytes.
+     */
+    void (*fill)(double* x, double value, size_t n);
+
+    /**
+     * @brief Copies n values from src to dst. The buffers must not overlap.
+     * @note Uses non-temporal stores from SIMD_STREAM_THRESHOLD bytes.
+     */
+    void (*copy)(double* dst, const double* src, size_t n);
+
+    /**
+     * @brief Computes the sum of x[i].
+     * @note Uses several independent accumulators, so the result may differ
+     * from a serial sum in the last bits.
+     */
+    double (*sum)(const double* x, size_t n);
+
+    /**
+     * @brief Computes the largest x[i].
+     * @note NaNs are skipped, the result is NaN only if every x[i] is, as
+     * with ReduceOps.max.
+     */
+    double (*max)(const double* x, size_t n);
+
+    /**
+     * @brief Writes the transpose of the rows x cols block src into dst.
+     *
+     * Cache-oblivious: the block is halved recursively until it fits in L1 and
+     * the leaves are moved as 4x4 register tiles, so large matrices transpose
+     * at close to copy speed instead of missing the cache on every store.
+     * @param dst Destination, cols x rows with leading dimension ldd.
+     * @param src Source, rows x cols with leading dimension lds.
+     * @note The buffers must not overlap.
+     */
+    void (*transpose)(double* dst, size_t ldd, const double* src, size_t lds,
+        size_t rows, size_t cols);
+
+    /**
+     * @brief Transposes the n x n block x in place.
+     * @param x The block, with leading dimension ld.
+     */
+    void (*transposeSquare)(double* x, size_t ld, size_t n);
+
+    /**
+     * @brief Single precision versions of the kernels above, same behavior.
+     * @note Scalars stay double and are rounded once per call. sum reduces
+     * its vector lanes in double.
+     */
+    struct {
+        void (*add)(float* x, const float* y, size_t n);
+        void (*subtract)(float* x, const float* y, size_t n);
+        void (*scale)(float* x, double alpha, size_t n);
+        void (*addTo)(float* z, const float* x, const float* y, size_t n);
+        void (*subtractTo)(float* z, const float* x, const float* y, size_t n);
+        void (*scaleTo)(float* z, const float* x, double alpha, size_t n);
+        void (*multiply)(float* x, const float* y, size_t n);
+        void (*shift)(float* x, double alpha, size_t n);
+        void (*maximum)(float* x, const float* y, size_t n);
+        void (*fill)(float* x, double value, size_t n);
+        void (*copy)(float* dst, const float* src, size_t n);
+        double (*sum)(const float* x, size_t n);
+        double (*max)(const float* x, size_t n);
+        void (*transpose)(float* dst, size_t ldd, const float* src, size_t lds,
+            size_t rows, size_t cols);
+        void (*transposeSquare)(float* x, size_t ld, size_t n);
+    } f32;
+} SimdOps;
@@ -0,0 +1,151 @@
+/**
+ * @file sparse.h
+ * @brief Interface for sparse matrices in compressed row or column storage.
+ *
+ * A sparse matrix keeps only its nonzero elements, sorted along the major
+ * dimension: rows for SPARSE_CSR, columns for SPARSE_CSC. start[i] is the
+ * position of the first element of row (or column) i and start[i + 1] the
+ * position after its last one, index holds the column (or row) of every
+ * element, in increasing order within a row (or column).
+ *
+ * A pruned weight matrix with 90% zeros takes about a fifth of its dense
+ * memory, and products with it cost a tenth of the dense ones. CSR suits
+ * sparse x dense products, whose rows are independent; CSC suits dense x
+ * sparse ones, where every output element is a dot product with a column.
+ * Both formats work on both sides, convert switches between them.
+ *
+ * Products with at least SPARSE_PARALLEL_THRESHOLD multiply-adds are split
+ * over the thread pool. Every output element is computed in the same order
+ * whatever the split, so results don't depend on the number of threads.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include "matrix.h"
+
+/**
+ * @brief Multiply-adds (nonzeros times dense columns or rows) from which a
+ * product runs in parallel.
+ */
+#ifndef SPARSE_PARALLEL_THRESHOLD
+#define SPARSE_PARALLEL_THRESHOLD (1u << 18)
+#endif
+
+/**
+ * @brief Opaque pointer to a sparse matrix structure.
+ */
+typedef struct SparseStruct* Sparse;
+
+/**
+ * @brief Storage order of a sparse matrix, see the file description.
+ */
+typedef enum SparseFormat {
+    SPARSE_CSR = 0,
+    SPARSE_CSC
+} SparseFormat;
+
+/*
+ *	Interface for sparse matrices.
+ */
+extern const struct SparseInterface{
+
+    /**
+     * @brief Creates a sparse matrix from the large elements of a dense one.
+     * @param matrix The dense matrix.
+     * @param format Storage order of the result.
+     * @param threshold Elements with an absolute value of at most threshold
+     * are dropped, 0 keeps every nonzero.
+     * @return A new sparse matrix, or NULL on failure.
+     */
+    Sparse (*fromDense)(const Matrix matrix, SparseFormat format,
+        double threshold);
+
+    /**
+     * @brief Creates a sparse matrix from (row, col, value) triplets.
+     * @param row Number of rows.
+     * @param col Number of columns.
+     * @param count Number of triplets.
+     * @param rows Row of every triplet.
+     * @param cols Column of every triplet.
+     * @param values Value of every triplet.
+     * @param format Storage order of the result.
+     * @return A new sparse matrix, or NULL on failure.
+     * @note Triplets may come in any order. Those at the same position are
+     * added, in the order given.
+     */
+    Sparse (*fromTriplets)(size_t row, size_t col, size_t count,
+        const size_t* rows, const size_t* cols, const double* values,
+        SparseFormat format);
+
+    /**
+     * @brief Creates the dense matrix a sparse one stands for.
+     * @param sparse The sparse matrix.
+     * @return A new matrix, or NULL on failure.
+     */
+    Matrix (*toDense)(const Sparse sparse);
+
+    /**
+     * @brief Copies a sparse matrix into the other storage order, or the
+     * same one.
+     * @param sparse The sparse matrix.
+     * @param format Storage order of the copy.
+     * @return A new sparse matrix, or NULL on failure.
+     */
+    Sparse (*convert)(const Sparse sparse, SparseFormat format);
+
+    /**
+     * @brief Destroys a sparse matrix and sets the pointer to NULL.
+     * @param sparseAddr Address of the sparse matrix.
+     */
+    void (*destroy)(Sparse* sparseAddr);
+
+    /**
+     * @brief Gets an element, 0 when it is not stored.
+     * @param sparse The sparse matrix.
+     * @param row Row of the element.
+     * @param col Column of the element.
+     * @param value Pointer to store the element.
+     * @return 0 on success, -1 on failure.
+     * @note Binary search within the row (CSR) or column (CSC).
+     */
+    int (*get)(const Sparse sparse, size_t row, size_t col, double* value);
+
+    size_t (*getRow)(const Sparse sparse);
+    size_t (*getCol)(const Sparse sparse);
+
+    /**
+     * @brief Gets the number of stored elements.
+     */
+    size_t (*nonZeros)(const Sparse sparse);
+
+    SparseFormat (*getFormat)(const Sparse sparse);
+
+    /**
+     * @brief Multiplies a sparse matrix by a dense one, sparse x dense.
+     * @param sparse The sparse matrix, m x k.
+     * @param matrix The dense matrix, k x n. A column vector gives SpMV.
+     * @return A new m x n matrix with the product, or NULL on failure.
+     */
+    Matrix (*multiply)(const Sparse sparse, const Matrix matrix);
+
+    /**
+     * @brief Multiplies a dense matrix by a sparse one, dense x sparse.
+     * @param matrix The dense matrix, m x k.
+     * @param sparse The sparse matrix, k x n.
+     * @return A new m x n matrix with the product, or NULL on failure.
+     */
+    Matrix (*multiplyDense)(const Matrix matrix, const Sparse sparse);
+
+    /**
+     * @brief The operations creating a dense matrix, writing to an existing
+     * one of the right shape instead.
+     * @note dst can't alias the dense operand.
+     */
+    struct {
+        int (*toDense)(Matrix dst, const Sparse sparse);
+        int (*multiply)(Matrix dst, const Sparse sparse, const Matrix matrix);
+        int (*multiplyDense)(Matrix dst, const Matrix matrix,
+            const Sparse sparse);
+    } into;
+} SparseOps;
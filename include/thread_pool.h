@@ -0,0 +1,95 @@
+/**
+ * @file thread_pool.h
+ * @brief Interface for the persistent worker threads shared by the kernels.
+ *
+ * The pool runs a batch of independent tasks, indices 0 to count - 1, on its
+ * workers and the calling thread, and returns once all of them are done.
+ * Workers are started on the first batch and then sleep between batches,
+ * so a parallel kernel costs a wake-up, not a thread creation.
+ *
+ * One batch runs at a time. A batch started while another one is running,
+ * from a task or from another thread, runs its tasks on the calling thread
+ * alone, so kernels can call each other without deadlocking.
+ *
+ * The number of threads comes from setThreadCount, otherwise from the
+ * THREAD_POOL_ENV environment variable, otherwise from the number of
+ * online processors.
+ */
+
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * @brief Environment variable holding the default number of threads.
+ */
+#ifndef THREAD_POOL_ENV
+#define THREAD_POOL_ENV "NN_NUM_THREADS"
+#endif
+
+/**
+ * @brief Upper bound on the number of threads, the caller included.
+ */
+#ifndef THREAD_POOL_MAX_THREADS
+#define THREAD_POOL_MAX_THREADS 256
+#endif
+
+/**
+ * @brief A task of a batch.
+ * @param arg The argument given to run.
+ * @param index Index of the task in the batch.
+ * @return 0 on success, -1 on failure.
+ */
+typedef int (*ThreadPoolTask)(void* arg, size_t index);
+
+/*
+ *	Interface for the thread pool.
+ */
+extern const struct ThreadPoolInterface{
+
+    /**
+     * @brief Gets the number of threads batches run on, the caller included.
+     * @return The thread count, at least 1.
+     */
+    size_t (*threadCount)(void);
+
+    /**
+     * @brief Sets the number of threads batches run on, the caller included.
+     * @param count The thread count, 1 for serial execution, 0 to go back to
+     * the default.
+     * @return 0 on success, -1 on failure.
+     * @note Running workers are stopped, the new ones start with the next
+     * batch. Must not be called from a task.
+     */
+    int (*setThreadCount)(size_t count);
+
+    /**
+     * @brief Runs task(arg, index) for every index in [0, count).
+     * @param task The task.
+     * @param arg Argument passed to every task.
+     * @param count Number of tasks.
+     * @return 0 if every task succeeded, -1 otherwise.
+     * @note Tasks may run in any order and concurrently, they must not
+     * depend on each other.
+     */
+    int (*run)(ThreadPoolTask task, void* arg, size_t count);
+
+    /**
+     * @brief Stops and joins the workers. The next batch starts them again.
+     * @note Must not be called from a task.
+     */
+    void (*shutdown)(void);
+
+    /**
+     * @brief Splits [0, length) into parts pieces made of whole units, for
+     * task index of a batch. Only the last unit may be partial.
+     * @param length The length to split.
+     * @param unit The granularity of the pieces, e.g. a tile of rows.
+     * @param parts Number of pieces, at most the number of units.
+     * @param index The piece, in [0, parts).
+     * @param start Pointer to store the first element of the piece.
+     * @param size Pointer to store the length of the piece.
+     */
+    void (*partition)(size_t length, size_t unit, size_t parts, size_t index,
+        size_t* start, size_t* size);
+} ThreadPoolOps;
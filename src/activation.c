@@ -0,0 +1,592 @@
+#include "../include/activation.h"
+#include "../include/simd.h"
+#include "../lib/macro_error.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ACTIVATION_X86 1
+#endif
+
+//* STRUCT DEFINITION *********************************************************
+
+typedef struct ActivationEntry {
+	double (*func)(double);
+	ActivationKernel kernel;
+} ActivationEntry;
+
+// Kernels registered with addKernel
+static ActivationEntry registered[ACTIVATION_MAX_KERNELS];
+static size_t registeredCount = 0;
+
+// Elements widened to double at once by applyF
+#define ACTIVATION_BLOCK 256
+
+// sqrt(2 / pi) and the cubic coefficient of the GELU approximation
+#define GELU_SCALE 0.7978845608028654
+#define GELU_CUBIC 0.044715
+
+//* FUNCTION PROTOTYPES *******************************************************
+
+static double sigmoidFunc(double x);
+static double tanhFunc(double x);
+static double reluFunc(double x);
+static double leakyReluFunc(double x);
+static double geluFunc(double x);
+static double softplusFunc(double x);
+static double expFunc(double x);
+static double sigmoidDeriv(double x);
+static double tanhDeriv(double x);
+static double reluDeriv(double x);
+static double leakyReluDeriv(double x);
+static double geluDeriv(double x);
+static double softplusDeriv(double x);
+static double expDeriv(double x);
+static void sigmoidArray(const double* in, double* out, size_t n);
+static void tanhArray(const double* in, double* out, size_t n);
+static void reluArray(const double* in, double* out, size_t n);
+static void leakyReluArray(const double* in, double* out, size_t n);
+static void geluArray(const double* in, double* out, size_t n);
+static void softplusArray(const double* in, double* out, size_t n);
+static void expArray(const double* in, double* out, size_t n);
+static ActivationKernel kernelOf(double (*func)(double));
+static int addKernel(double (*func)(double), ActivationKernel kernel);
+static void apply(double (*func)(double), const double* in, double* out,
+	size_t n);
+static void applyF(double (*func)(double), const float* in, float* out,
+	size_t n);
+static void scalarLoop(double (*func)(double), const double* in, double* out,
+	size_t n);
+
+//* INTERFACE INITIALIZATION **************************************************
+
+const struct ActivationInterface ActivationOps = {
+	.f = {
+		.sigmoid = sigmoidFunc,
+		.tanh = tanhFunc,
+		.relu = reluFunc,
+		.leakyRelu = leakyReluFunc,
+		.gelu = geluFunc,
+		.softplus = softplusFunc,
+		.exp = expFunc
+	},
+	.derivative = {
+		.sigmoid = sigmoidDeriv,
+		.tanh = tanhDeriv,
+		.relu = reluDeriv,
+		.leakyRelu = leakyReluDeriv,
+		.gelu = geluDeriv,
+		.softplus = softplusDeriv,
+		.exp = expDeriv
+	},
+	.array = {
+		.sigmoid = sigmoidArray,
+		.tanh = tanhArray,
+		.relu = reluArray,
+		.leakyRelu = leakyReluArray,
+		.gelu = geluArray,
+		.softplus = softplusArray,
+		.exp = expArray
+	},
+	.kernelOf = kernelOf,
+	.addKernel = addKernel,
+	.apply = apply,
+	.applyF = applyF
+};
+
+static const ActivationEntry builtins[] = {
+	{sigmoidFunc, sigmoidArray},
+	{tanhFunc, tanhArray},
+	{reluFunc, reluArray},
+	{leakyReluFunc, leakyReluArray},
+	{geluFunc, geluArray},
+	{softplusFunc, softplusArray},
+	{expFunc, expArray}
+};
+
+//* KERNEL INSTANTIATION ******************************************************
+
+#if defined(ACTIVATION_X86)
+
+#define AVX2 __attribute__((target("avx2,fma")))
+
+// exp(x) for 4 doubles: x = n * ln2 + r with |r| <= ln2 / 2, exp(r) by its
+// degree 13 Taylor polynomial (error below 1e-17), and 2^n built in the
+// exponent bits. 2^n is applied in two halves so results that are
+// subnormal or close to overflow still come out right.
+AVX2 static inline __m256d exp4(__m256d x)
+{
+	__m256d t, n, r, p;
+	__m128i ni, high, low;
+
+	t = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(-746.0)),
+		_mm256_set1_pd(710.0));
+	n = _mm256_round_pd(_mm256_mul_pd(t, _mm256_set1_pd(1.4426950408889634)),
+		_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	r = _mm256_fnmadd_pd(n, _mm256_set1_pd(6.93147180369123816490e-01), t);
+	r = _mm256_fnmadd_pd(n, _mm256_set1_pd(1.90821492927058770002e-10), r);
+
+	p = _mm256_set1_pd(1.0 / 6227020800.0);
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 479001600.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 39916800.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 3628800.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 362880.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 40320.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 5040.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 720.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 120.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 24.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 6.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(0.5));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0));
+
+	ni = _mm256_cvtpd_epi32(n);
+	high = _mm_srai_epi32(ni, 1);
+	low = _mm_sub_epi32(ni, high);
+	p = _mm256_mul_pd(p, _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(
+		_mm256_cvtepi32_epi64(high), _mm256_set1_epi64x(1023)), 52)));
+	p = _mm256_mul_pd(p, _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(
+		_mm256_cvtepi32_epi64(low), _mm256_set1_epi64x(1023)), 52)));
+
+	// The clamp turned NaN into a number
+	return _mm256_blendv_pd(p, x, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+}
+
+// exp(x) - 1 for 4 doubles with x <= 0, without the cancellation of
+// exp(x) - 1 near zero: x = n * ln2 + r and
+// exp(x) - 1 = 2^n * (exp(r) - 1) + (2^n - 1), with exp(r) - 1 summed
+// without its constant term. Below -40 the result is -1 to double precision.
+AVX2 static inline __m256d expm1Negative4(__m256d x)
+{
+	__m256d t, n, r, p, scale;
+
+	t = _mm256_max_pd(x, _mm256_set1_pd(-40.0));
+	n = _mm256_round_pd(_mm256_mul_pd(t, _mm256_set1_pd(1.4426950408889634)),
+		_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	r = _mm256_fnmadd_pd(n, _mm256_set1_pd(6.93147180369123816490e-01), t);
+	r = _mm256_fnmadd_pd(n, _mm256_set1_pd(1.90821492927058770002e-10), r);
+
+	p = _mm256_set1_pd(1.0 / 6227020800.0);
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 479001600.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 39916800.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 3628800.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 362880.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 40320.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 5040.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 720.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 120.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 24.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0 / 6.0));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(0.5));
+	p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0));
+	p = _mm256_mul_pd(p, r);
+
+	scale = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(
+		_mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n)),
+		_mm256_set1_epi64x(1023)), 52));
+	p = _mm256_fmadd_pd(scale, p, _mm256_sub_pd(scale, _mm256_set1_pd(1.0)));
+
+	// The clamp turned NaN into a number
+	return _mm256_blendv_pd(p, x, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+}
+
+// log(1 + y) for 4 doubles with 0 <= y <= 1. u = 1 + y is brought to
+// [sqrt(1/2), sqrt(2)] and log(u) = 2 * atanh((u - 1) / (u + 1)) by its
+// series. The rounding of 1 + y is then undone as in log1p implementations
+// by scaling with y / (u - 1).
+AVX2 static inline __m256d log1p4(__m256d y)
+{
+	__m256d u, big, m, k, z, w, s, d, result;
+
+	u = _mm256_add_pd(_mm256_set1_pd(1.0), y);
+	big = _mm256_cmp_pd(u, _mm256_set1_pd(1.4142135623730951), _CMP_GT_OQ);
+	m = _mm256_blendv_pd(u, _mm256_mul_pd(u, _mm256_set1_pd(0.5)), big);
+	k = _mm256_and_pd(big, _mm256_set1_pd(0.6931471805599453));
+
+	z = _mm256_div_pd(_mm256_sub_pd(m, _mm256_set1_pd(1.0)),
+		_mm256_add_pd(m, _mm256_set1_pd(1.0)));
+	w = _mm256_mul_pd(z, z);
+
+	s = _mm256_set1_pd(1.0 / 23.0);
+	s = _mm256_fmadd_pd(s, w, _mm256_set1_pd(1.0 / 21.0));
+	s = _mm256_fmadd_pd(s, w, _mm256_set1_pd(1.0 / 19.0));
+	s = _mm256_fmadd_pd(s, w, _mm256_set1_pd(1.0 / 17.0));
+	s = _mm256_fmadd_pd(s, w, _mm256_set1_pd(1.0 / 15.0));
+	s = _mm256_fmadd_pd(s, w, _mm256_set1_pd(1.0 / 13.0));
+	s = _mm256_fmadd_pd(s, w, _mm256_set1_pd(1.0 / 11.0));
+	s = _mm256_fmadd_pd(s, w, _mm256_set1_pd(1.0 / 9.0));
+	s = _mm256_fmadd_pd(s, w, _mm256_set1_pd(1.0 / 7.0));
+	s = _mm256_fmadd_pd(s, w, _mm256_set1_pd(1.0 / 5.0));
+	s = _mm256_fmadd_pd(s, w, _mm256_set1_pd(1.0 / 3.0));
+	s = _mm256_fmadd_pd(s, w, _mm256_set1_pd(1.0));
+	result = _mm256_fmadd_pd(_mm256_add_pd(z, z), s, k);
+
+	d = _mm256_sub_pd(u, _mm256_set1_pd(1.0));
+	result = _mm256_mul_pd(result, _mm256_div_pd(y, d));
+
+	return _mm256_blendv_pd(result, y,
+		_mm256_cmp_pd(d, _mm256_setzero_pd(), _CMP_EQ_OQ));
+}
+
+AVX2 static inline __m256d sigmoid4(__m256d x)
+{
+	__m256d one = _mm256_set1_pd(1.0);
+
+	return _mm256_div_pd(one, _mm256_add_pd(one,
+		exp4(_mm256_sub_pd(_mm256_setzero_pd(), x))));
+}
+
+// tanh(|x|) = -m / (2 + m) with m = expm1(-2|x|), then the sign of x
+AVX2 static inline __m256d tanh4(__m256d x)
+{
+	__m256d sign, m;
+
+	sign = _mm256_and_pd(x, _mm256_set1_pd(-0.0));
+	m = expm1Negative4(_mm256_mul_pd(_mm256_set1_pd(-2.0),
+		_mm256_andnot_pd(sign, x)));
+
+	return _mm256_or_pd(sign, _mm256_div_pd(_mm256_sub_pd(_mm256_setzero_pd(),
+		m), _mm256_add_pd(_mm256_set1_pd(2.0), m)));
+}
+
+AVX2 static inline __m256d relu4(__m256d x)
+{
+	return _mm256_max_pd(x, _mm256_setzero_pd());
+}
+
+AVX2 static inline __m256d leakyRelu4(__m256d x)
+{
+	return _mm256_blendv_pd(_mm256_mul_pd(x,
+		_mm256_set1_pd(ACTIVATION_LEAKY_SLOPE)), x,
+		_mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_GT_OQ));
+}
+
+AVX2 static inline __m256d gelu4(__m256d x)
+{
+	__m256d z;
+
+	z = _mm256_mul_pd(_mm256_mul_pd(_mm256_set1_pd(-2.0 * GELU_SCALE), x),
+		_mm256_fmadd_pd(_mm256_mul_pd(x, x), _mm256_set1_pd(GELU_CUBIC),
+		_mm256_set1_pd(1.0)));
+
+	return _mm256_div_pd(x, _mm256_add_pd(_mm256_set1_pd(1.0), exp4(z)));
+}
+
+// softplus(x) = max(x, 0) + log(1 + exp(-|x|)), which can't overflow
+AVX2 static inline __m256d softplus4(__m256d x)
+{
+	__m256d negAbs;
+
+	negAbs = _mm256_or_pd(x, _mm256_set1_pd(-0.0));
+
+	return _mm256_add_pd(_mm256_max_pd(x, _mm256_setzero_pd()),
+		log1p4(exp4(negAbs)));
+}
+
+// Runs VECTOR over in, 4 elements at a time, and the last few through a
+// padded buffer so they get the same results as the others
+#define ACTIVATION_AVX2_LOOP(VECTOR) do {								\
+	size_t i, rest;														\
+	double tail[4] = {0};												\
+																		\
+	for (i = 0; i + 4 <= n; i += 4) {									\
+		_mm256_storeu_pd(out + i, VECTOR(_mm256_loadu_pd(in + i)));		\
+	}																	\
+																		\
+	rest = n - i;														\
+	if (rest) {															\
+		memcpy(tail, in + i, rest * sizeof(double));					\
+		_mm256_storeu_pd(tail, VECTOR(_mm256_loadu_pd(tail)));			\
+		memcpy(out + i, tail, rest * sizeof(double));					\
+	}																	\
+} while (0)
+
+AVX2 static void sigmoidAvx2(const double* in, double* out, size_t n)
+{
+	ACTIVATION_AVX2_LOOP(sigmoid4);
+}
+
+AVX2 static void tanhAvx2(const double* in, double* out, size_t n)
+{
+	ACTIVATION_AVX2_LOOP(tanh4);
+}
+
+AVX2 static void reluAvx2(const double* in, double* out, size_t n)
+{
+	ACTIVATION_AVX2_LOOP(relu4);
+}
+
+AVX2 static void leakyReluAvx2(const double* in, double* out, size_t n)
+{
+	ACTIVATION_AVX2_LOOP(leakyRelu4);
+}
+
+AVX2 static void geluAvx2(const double* in, double* out, size_t n)
+{
+	ACTIVATION_AVX2_LOOP(gelu4);
+}
+
+AVX2 static void softplusAvx2(const double* in, double* out, size_t n)
+{
+	ACTIVATION_AVX2_LOOP(softplus4);
+}
+
+AVX2 static void expAvx2(const double* in, double* out, size_t n)
+{
+	ACTIVATION_AVX2_LOOP(exp4);
+}
+
+#undef ACTIVATION_AVX2_LOOP
+#undef AVX2
+
+// Picks the AVX2 kernel when the active level allows it
+#define ACTIVATION_DISPATCH(NAME)										\
+	if (SimdOps.level() >= SIMD_AVX2) {									\
+		NAME##Avx2(in, out, n);											\
+		return;															\
+	}
+
+#else
+
+#define ACTIVATION_DISPATCH(NAME)
+
+#endif
+
+//* FUNCTION DEFINITIONS ******************************************************
+
+static double sigmoidFunc(double x)
+{
+	return 1.0 / (1.0 + exp(-x));
+}
+
+static double tanhFunc(double x)
+{
+	return tanh(x);
+}
+
+static double reluFunc(double x)
+{
+	return (x > 0) ? x : 0;
+}
+
+static double leakyReluFunc(double x)
+{
+	return (x > 0) ? x : ACTIVATION_LEAKY_SLOPE * x;
+}
+
+// 0.5 * x * (1 + tanh(z)) is x * sigmoid(2z), which has no cancellation
+static double geluFunc(double x)
+{
+	return x / (1.0 + exp(-2.0 * GELU_SCALE * x * (1.0 + GELU_CUBIC * x * x)));
+}
+
+static double softplusFunc(double x)
+{
+	return fmax(x, 0) + log1p(exp(-fabs(x)));
+}
+
+static double expFunc(double x)
+{
+	return exp(x);
+}
+
+static double sigmoidDeriv(double x)
+{
+	double s = sigmoidFunc(x);
+	return s * (1.0 - s);
+}
+
+static double tanhDeriv(double x)
+{
+	double t = tanh(x);
+	return 1.0 - t * t;
+}
+
+static double reluDeriv(double x)
+{
+	return (x > 0) ? 1.0 : 0.0;
+}
+
+static double leakyReluDeriv(double x)
+{
+	return (x > 0) ? 1.0 : ACTIVATION_LEAKY_SLOPE;
+}
+
+static double geluDeriv(double x)
+{
+	double t = tanh(GELU_SCALE * (x + GELU_CUBIC * x * x * x));
+
+	return 0.5 * (1.0 + t) + 0.5 * x * (1.0 - t * t) * GELU_SCALE
+		* (1.0 + 3.0 * GELU_CUBIC * x * x);
+}
+
+static double softplusDeriv(double x)
+{
+	return sigmoidFunc(x);
+}
+
+static double expDeriv(double x)
+{
+	return exp(x);
+}
+
+static void sigmoidArray(const double* in, double* out, size_t n)
+{
+	ACTIVATION_DISPATCH(sigmoid)
+	scalarLoop(sigmoidFunc, in, out, n);
+}
+
+static void tanhArray(const double* in, double* out, size_t n)
+{
+	ACTIVATION_DISPATCH(tanh)
+	scalarLoop(tanhFunc, in, out, n);
+}
+
+static void reluArray(const double* in, double* out, size_t n)
+{
+	ACTIVATION_DISPATCH(relu)
+	scalarLoop(reluFunc, in, out, n);
+}
+
+static void leakyReluArray(const double* in, double* out, size_t n)
+{
+	ACTIVATION_DISPATCH(leakyRelu)
+	scalarLoop(leakyReluFunc, in, out, n);
+}
+
+static void geluArray(const double* in, double* out, size_t n)
+{
+	ACTIVATION_DISPATCH(gelu)
+	scalarLoop(geluFunc, in, out, n);
+}
+
+static void softplusArray(const double* in, double* out, size_t n)
+{
+	ACTIVATION_DISPATCH(softplus)
+	scalarLoop(softplusFunc, in, out, n);
+}
+
+static void expArray(const double* in, double* out, size_t n)
+{
+	ACTIVATION_DISPATCH(exp)
+	scalarLoop(expFunc, in, out, n);
+}
+
+static ActivationKernel kernelOf(double (*func)(double))
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+		if (builtins[i].func == func) {
+			return builtins[i].kernel;
+		}
+	}
+
+	for (i = 0; i < registeredCount; i++) {
+		if (registered[i].func == func) {
+			return registered[i].kernel;
+		}
+	}
+
+	return NULL;
+}
+
+static int addKernel(double (*func)(double), ActivationKernel kernel)
+{
+	size_t i;
+
+	if (func == NULL) {
+		PRINT_ERR("NULL pointer exception! (func)");
+		return -1;
+	}
+
+	for (i = 0; i < sizeof(builtins) / sizeof(builtins[0]); i++) {
+		if (builtins[i].func == func) {
+			PRINT_ERR("Built-in activations can't be overridden!");
+			return -1;
+		}
+	}
+
+	for (i = 0; i < registeredCount; i++) {
+		if (registered[i].func == func) {
+			break;
+		}
+	}
+
+	// Removing, the last entry takes the place of the removed one
+	if (kernel == NULL) {
+		if (i < registeredCount) {
+			registered[i] = registered[--registeredCount];
+		}
+		return 0;
+	}
+
+	if (i == ACTIVATION_MAX_KERNELS) {
+		PRINT_ERR("Too many activation kernels!");
+		return -1;
+	}
+
+	registered[i].func = func;
+	registered[i].kernel = kernel;
+	if (i == registeredCount) {
+		registeredCount++;
+	}
+
+	return 0;
+}
+
+static void apply(double (*func)(double), const double* in, double* out,
+	size_t n)
+{
+	ActivationKernel kernel = kernelOf(func);
+
+	if (kernel != NULL) {
+		kernel(in, out, n);
+		return;
+	}
+
+	scalarLoop(func, in, out, n);
+}
+
+static void applyF(double (*func)(double), const float* in, float* out,
+	size_t n)
+{
+	double block[ACTIVATION_BLOCK];
+	ActivationKernel kernel = kernelOf(func);
+	size_t i, j, length;
+
+	if (kernel == NULL) {
+		for (i = 0; i < n; i++) {
+			out[i] = (float)func(in[i]);
+		}
+		return;
+	}
+
+	for (i = 0; i < n; i += ACTIVATION_BLOCK) {
+		length = (n - i < ACTIVATION_BLOCK) ? n - i : ACTIVATION_BLOCK;
+
+		for (j = 0; j < length; j++) {
+			block[j] = in[i + j];
+		}
+		kernel(block, block, length);
+		for (j = 0; j < length; j++) {
+			out[i + j] = (float)block[j];
+		}
+	}
+}
+
+static void scalarLoop(double (*func)(double), const double* in, double* out,
+	size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		out[i] = func(in[i]);
+	}
+}
@@ -0,0 +1,240 @@
+#include "../include/arena.h"
+#include "../lib/macro_error.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+//* STRUCT DEFINITION *********************************************************
+
+// Blocks form a list. The ones after the current block are free, their used
+// counts are stale and get zeroed when the arena moves on to them.
+typedef struct ArenaBlock {
+	struct ArenaBlock* next;
+	size_t size;	// Usable bytes after the header
+	size_t used;
+} ArenaBlock;
+
+typedef struct ArenaStruct {
+	ArenaBlock* head;
+	ArenaBlock* current;
+	size_t blockSize;
+} ArenaStruct;
+
+// Arena the calling thread creates its matrices in
+static _Thread_local Arena activeArena = NULL;
+
+//* FUNCTION PROTOTYPES *******************************************************
+
+static Arena create(size_t blockSize);
+static void destroy(Arena* arenaAddr);
+static void* alloc(Arena arena, size_t size);
+static ArenaMark mark(Arena arena);
+static void reset(Arena arena, ArenaMark mark);
+static void clear(Arena arena);
+static size_t used(Arena arena);
+static Arena use(Arena arena);
+static Arena current(void);
+static size_t roundUp(size_t size);
+static char* blockData(ArenaBlock* block);
+
+//* INTERFACE INITIALIZATION **************************************************
+
+const struct ArenaInterface ArenaOps = {
+	.create = create,
+	.destroy = destroy,
+	.alloc = alloc,
+	.mark = mark,
+	.reset = reset,
+	.clear = clear,
+	.used = used,
+	.use = use,
+	.current = current
+};
+
+//* FUNCTION DEFINITIONS ******************************************************
+
+static Arena create(size_t blockSize)
+{
+	Arena arena;
+
+	arena = malloc(sizeof(ArenaStruct));
+	if (arena == NULL) {
+		MAL_ERR();
+		return NULL;
+	}
+
+	arena->head = NULL;
+	arena->current = NULL;
+	arena->blockSize = roundUp(blockSize ? blockSize : ARENA_BLOCK_SIZE);
+
+	return arena;
+}
+
+static void destroy(Arena* arenaAddr)
+{
+	Arena arena;
+	ArenaBlock* block, * next;
+
+	if (arenaAddr == NULL) {
+		return;
+	}
+
+	arena = *arenaAddr;
+	if (arena) {
+		for (block = arena->head; block != NULL; block = next) {
+			next = block->next;
+			free(block);
+		}
+
+		if (activeArena == arena) {
+			activeArena = NULL;
+		}
+
+		free(arena);
+	}
+
+	*arenaAddr = NULL;
+}
+
+static void* alloc(Arena arena, size_t size)
+{
+	ArenaBlock* block, * next;
+	void* memory;
+
+	if (arena == NULL) {
+		PRINT_ERR("NULL pointer exception! (arena)");
+		return NULL;
+	}
+
+	size = roundUp(size ? size : 1);
+	block = arena->current;
+
+	if (block == NULL || block->used + size > block->size) {
+		// Move on to the first following free block that is large enough,
+		// the ones skipped stay unused until the next reset
+		next = block ? block->next : arena->head;
+		while (next != NULL && next->size < size) {
+			next->used = 0;
+			next = next->next;
+		}
+
+		if (next == NULL) {
+			next = aligned_alloc(ARENA_ALIGNMENT, roundUp(sizeof(ArenaBlock))
+				+ (size > arena->blockSize ? size : arena->blockSize));
+			if (next == NULL) {
+				MAL_ERR();
+				return NULL;
+			}
+
+			next->size = size > arena->blockSize ? size : arena->blockSize;
+
+			// Insert it right after the current block, so every block
+			// after the current one is still free
+			if (block == NULL) {
+				next->next = arena->head;
+				arena->head = next;
+			}
+			else {
+				next->next = block->next;
+				block->next = next;
+			}
+		}
+
+		next->used = 0;
+		arena->current = block = next;
+	}
+
+	memory = blockData(block) + block->used;
+	block->used += size;
+
+	return memory;
+}
+
+static ArenaMark mark(Arena arena)
+{
+	ArenaMark position = {NULL, 0};
+
+	if (arena == NULL) {
+		PRINT_ERR("NULL pointer exception! (arena)");
+		return position;
+	}
+
+	if (arena->current != NULL) {
+		position.block = arena->current;
+		position.used = arena->current->used;
+	}
+
+	return position;
+}
+
+static void reset(Arena arena, ArenaMark mark)
+{
+	if (arena == NULL) {
+		PRINT_ERR("NULL pointer exception! (arena)");
+		return;
+	}
+
+	// A mark taken before the first allocation
+	if (mark.block == NULL) {
+		clear(arena);
+		return;
+	}
+
+	arena->current = mark.block;
+	arena->current->used = mark.used;
+}
+
+static void clear(Arena arena)
+{
+	if (arena == NULL) {
+		PRINT_ERR("NULL pointer exception! (arena)");
+		return;
+	}
+
+	arena->current = arena->head;
+	if (arena->head != NULL) {
+		arena->head->used = 0;
+	}
+}
+
+static size_t used(Arena arena)
+{
+	ArenaBlock* block;
+	size_t total = 0;
+
+	if (arena == NULL || arena->current == NULL) {
+		return 0;
+	}
+
+	for (block = arena->head; block != arena->current; block = block->next) {
+		total += block->used;
+	}
+
+	return total + arena->current->used;
+}
+
+static Arena use(Arena arena)
+{
+	Arena previous = activeArena;
+
+	activeArena = arena;
+
+	return previous;
+}
+
+static Arena current(void)
+{
+	return activeArena;
+}
+
+static size_t roundUp(size_t size)
+{
+	return (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+}
+
+// The data of a block starts on the first cache line after its header
+static char* blockData(ArenaBlock* block)
+{
+	return (char*)block + roundUp(sizeof(ArenaBlock));
+}
@@ -0,0 +1,404 @@
+#include "../include/expression.h"
+#include "../include/activation.h"
+#include "../include/simd.h"
+#include "../lib/macro_error.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+//* STRUCT DEFINITION *********************************************************
+
+typedef enum ExpressionKind {
+	EXPRESSION_UNARY,
+	EXPRESSION_BINARY,
+	EXPRESSION_ELEMENT_WISE,
+	EXPRESSION_SCALE,
+	EXPRESSION_NORMALIZE
+} ExpressionKind;
+
+typedef struct ExpressionOp {
+	ExpressionKind kind;
+	double (*unary)(double);
+	double (*binary)(double, double);
+	double value;		// Broadcast value, scalar, or factor of a normalize
+	Matrix operand;		// Second matrix of an element-wise operation
+} ExpressionOp;
+
+typedef struct ExpressionStruct {
+	Matrix source;
+	ExpressionOp* ops;
+	size_t count;
+	size_t capacity;
+} ExpressionStruct;
+
+//* FUNCTION PROTOTYPES *******************************************************
+
+static Expression create(const Matrix source);
+static void destroy(Expression* exprAddr);
+static int setSource(Expression expr, const Matrix source);
+static int unary(Expression expr, double (*func)(double));
+static int binary(Expression expr, double (*func)(double, double),
+	double value);
+static int elementWise(Expression expr, const Matrix matrix,
+	double (*func)(double, double));
+static int scale(Expression expr, double scalar);
+static int normalize(Expression expr);
+static int evaluate(Expression expr, Matrix dst);
+static int sum(Expression expr, double* result);
+static int record(Expression expr, ExpressionOp op);
+static int isValid(Expression expr);
+static int isFlat(const Matrix matrix);
+static int runPass(Expression expr, size_t start, size_t end,
+	const Matrix from, Matrix dst, double* total);
+static void applyOp(const ExpressionOp* op, double* block, size_t row,
+	size_t col, size_t length);
+
+//* INTERFACE INITIALIZATION **************************************************
+
+const struct ExpressionInterface ExpressionOps = {
+	.create = create,
+	.destroy = destroy,
+	.setSource = setSource,
+	.unary = unary,
+	.binary = binary,
+	.elementWise = elementWise,
+	.scale = scale,
+	.normalize = normalize,
+	.evaluate = evaluate,
+	.sum = sum
+};
+
+//* FUNCTION DEFINITIONS ******************************************************
+
+static Expression create(const Matrix source)
+{
+	Expression expr;
+
+	if (!MatrixOps.isValid(source)) {
+		PRINT_ERR("Invalid matrix!");
+		return NULL;
+	}
+
+	expr = malloc(sizeof(ExpressionStruct));
+	if (expr == NULL) {
+		MAL_ERR();
+		return NULL;
+	}
+
+	expr->source = source;
+	expr->ops = NULL;
+	expr->count = 0;
+	expr->capacity = 0;
+
+	return expr;
+}
+
+static void destroy(Expression* exprAddr)
+{
+	Expression expr;
+
+	if (exprAddr == NULL) {
+		return;
+	}
+
+	expr = *exprAddr;
+	if (expr) {
+		free(expr->ops);
+		free(expr);
+	}
+
+	*exprAddr = NULL;
+}
+
+static int setSource(Expression expr, const Matrix source)
+{
+	if (expr == NULL) {
+		PRINT_ERR("NULL pointer exception! (expr)");
+		return -1;
+	}
+
+	if (!MatrixOps.isValid(source)) {
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	expr->source = source;
+	return 0;
+}
+
+static int unary(Expression expr, double (*func)(double))
+{
+	ExpressionOp op = {.kind = EXPRESSION_UNARY, .unary = func};
+
+	if (func == NULL) {
+		PRINT_ERR("NULL pointer exception! (func)");
+		return -1;
+	}
+
+	return record(expr, op);
+}
+
+static int binary(Expression expr, double (*func)(double, double),
+	double value)
+{
+	ExpressionOp op = {.kind = EXPRESSION_BINARY, .binary = func,
+		.value = value};
+
+	if (func == NULL) {
+		PRINT_ERR("NULL pointer exception! (func)");
+		return -1;
+	}
+
+	return record(expr, op);
+}
+
+static int elementWise(Expression expr, const Matrix matrix,
+	double (*func)(double, double))
+{
+	ExpressionOp op = {.kind = EXPRESSION_ELEMENT_WISE, .binary = func,
+		.operand = matrix};
+
+	if (func == NULL) {
+		PRINT_ERR("NULL pointer exception! (func)");
+		return -1;
+	}
+
+	if (expr != NULL && !MatrixOps.isSameShape(expr->source, matrix)) {
+		PRINT_ERR("Matrix dimensions do not match!");
+		return -1;
+	}
+
+	return record(expr, op);
+}
+
+static int scale(Expression expr, double scalar)
+{
+	ExpressionOp op = {.kind = EXPRESSION_SCALE, .value = scalar};
+
+	return record(expr, op);
+}
+
+static int normalize(Expression expr)
+{
+	ExpressionOp op = {.kind = EXPRESSION_NORMALIZE, .value = 1.0};
+
+	return record(expr, op);
+}
+
+static int evaluate(Expression expr, Matrix dst)
+{
+	size_t k, start = 0;
+	double total;
+	Matrix from;
+
+	if (!isValid(expr)) {
+		PRINT_ERR("Invalid expression!");
+		return -1;
+	}
+
+	if (!MatrixOps.isSameShape(dst, expr->source)) {
+		PRINT_ERR("Matrix dimensions do not match!");
+		return -1;
+	}
+
+	// Every normalize ends a pass, the next one goes on from dst
+	from = expr->source;
+	for (k = 0; k < expr->count; k++) {
+		if (expr->ops[k].kind != EXPRESSION_NORMALIZE) {
+			continue;
+		}
+
+		if (runPass(expr, start, k, from, dst, &total) == -1) {
+			return -1;
+		}
+		expr->ops[k].value = 1.0 / total;
+
+		from = dst;
+		start = k;
+	}
+
+	return runPass(expr, start, expr->count, from, dst, NULL);
+}
+
+static int sum(Expression expr, double* result)
+{
+	size_t k;
+	double total;
+
+	if (!isValid(expr)) {
+		PRINT_ERR("Invalid expression!");
+		return -1;
+	}
+
+	if (result == NULL) {
+		PRINT_ERR("NULL pointer exception! (result)");
+		return -1;
+	}
+
+	// Nothing is stored, so each normalize starts over from the source
+	for (k = 0; k < expr->count; k++) {
+		if (expr->ops[k].kind == EXPRESSION_NORMALIZE) {
+			runPass(expr, 0, k, expr->source, NULL, &total);
+			expr->ops[k].value = 1.0 / total;
+		}
+	}
+
+	runPass(expr, 0, expr->count, expr->source, NULL, result);
+
+	return 0;
+}
+
+static int record(Expression expr, ExpressionOp op)
+{
+	size_t capacity;
+	ExpressionOp* ops;
+
+	if (expr == NULL) {
+		PRINT_ERR("NULL pointer exception! (expr)");
+		return -1;
+	}
+
+	if (expr->count == expr->capacity) {
+		capacity = expr->capacity ? 2 * expr->capacity : 4;
+		ops = realloc(expr->ops, capacity * sizeof(ExpressionOp));
+		if (ops == NULL) {
+			MAL_ERR();
+			return -1;
+		}
+
+		expr->ops = ops;
+		expr->capacity = capacity;
+	}
+
+	expr->ops[expr->count++] = op;
+	return 0;
+}
+
+static int isValid(Expression expr)
+{
+	size_t k;
+
+	if (expr == NULL) {
+		PRINT_ERR("NULL pointer exception! (expr)");
+		return 0;
+	}
+
+	if (!MatrixOps.isValid(expr->source)) {
+		return 0;
+	}
+
+	// The source may have changed since the operands were recorded
+	for (k = 0; k < expr->count; k++) {
+		if (expr->ops[k].kind == EXPRESSION_ELEMENT_WISE
+			&& !MatrixOps.isSameShape(expr->ops[k].operand, expr->source))
+		{
+			PRINT_ERR("Matrix dimensions do not match!");
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static int isFlat(const Matrix matrix)
+{
+	return MatrixOps.getLd(matrix) == MatrixOps.getCol(matrix)
+		|| MatrixOps.getRow(matrix) == 1;
+}
+
+// Runs ops [start, end) over the whole matrix, reading from and writing to
+// dst when it isn't NULL, and adding the results to total when it isn't
+// NULL. A normalize at start scales by the factor found by the pass before.
+static int runPass(Expression expr, size_t start, size_t end,
+	const Matrix from, Matrix dst, double* total)
+{
+	double block[EXPRESSION_BLOCK];
+	size_t i, j, k, rows, cols, length, fromLd, dstLd = 0;
+	const double* fromData;
+	double* dstData = NULL;
+	int flat;
+
+	// dst first, so from is read after dst got data of its own if they match
+	if (dst != NULL) {
+		dstData = MatrixOps.getData(dst);
+		if (dstData == NULL) {
+			return -1;
+		}
+		dstLd = MatrixOps.getLd(dst);
+	}
+	rows = MatrixOps.getRow(from);
+	cols = MatrixOps.getCol(from);
+	fromData = MatrixOps.getDataConst(from);
+	fromLd = MatrixOps.getLd(from);
+
+	// Walk gapless matrices as a single row so every block is full
+	flat = isFlat(from) && (dst == NULL || isFlat(dst));
+	for (k = start; k < end && flat; k++) {
+		if (expr->ops[k].kind == EXPRESSION_ELEMENT_WISE) {
+			flat = isFlat(expr->ops[k].operand);
+		}
+	}
+	if (flat) {
+		cols *= rows;
+		rows = 1;
+	}
+
+	if (total != NULL) {
+		*total = 0;
+	}
+
+	for (i = 0; i < rows; i++) {
+		for (j = 0; j < cols; j += EXPRESSION_BLOCK) {
+			length = (cols - j < EXPRESSION_BLOCK) ? cols - j : EXPRESSION_BLOCK;
+
+			SimdOps.copy(block, fromData + i * fromLd + j, length);
+			for (k = start; k < end; k++) {
+				applyOp(&expr->ops[k], block, i, j, length);
+			}
+
+			if (total != NULL) {
+				*total += SimdOps.sum(block, length);
+			}
+			if (dst != NULL) {
+				SimdOps.copy(dstData + i * dstLd + j, block, length);
+			}
+		}
+	}
+
+	return 0;
+}
+
+// Applies one operation to the block starting at (row, col). Rows are
+// those of the pass, a flat pass has a single one.
+static void applyOp(const ExpressionOp* op, double* block, size_t row,
+	size_t col, size_t length)
+{
+	size_t j;
+	const double* operand;
+
+	switch (op->kind) {
+	case EXPRESSION_UNARY:
+		ActivationOps.apply(op->unary, block, block, length);
+		break;
+
+	case EXPRESSION_BINARY:
+		for (j = 0; j < length; j++) {
+			block[j] = op->binary(block[j], op->value);
+		}
+		break;
+
+	case EXPRESSION_ELEMENT_WISE:
+		operand = MatrixOps.getDataConst(op->operand)
+			+ row * MatrixOps.getLd(op->operand) + col;
+		for (j = 0; j < length; j++) {
+			block[j] = op->binary(block[j], operand[j]);
+		}
+		break;
+
+	case EXPRESSION_SCALE:
+	case EXPRESSION_NORMALIZE:
+		SimdOps.scale(block, op->value, length);
+		break;
+	}
+}
@@ -0,0 +1,563 @@
+#include "../include/gemm.h"
+#include "../include/simd.h"
+#include "../include/thread_pool.h"
+#include "../lib/macro_error.h"
+#include "../lib/macro_str.h"
+
+#include <pthread.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define GEMM_X86 1
+#endif
+
+#if defined(GEMM_CBLAS)
+#include <cblas.h>
+#endif
+
+//* STRUCT DEFINITION *********************************************************
+
+// Packing buffers of the calling thread, shared by both precisions. They
+// only grow, so repeated products of similar shapes don't touch the
+// allocator.
+static _Thread_local void* workspace = NULL;
+static _Thread_local size_t workspaceSize = 0;
+
+// Also holds the buffer of every thread, so worker threads free it when
+// they exit
+static pthread_key_t workspaceKey;
+static pthread_once_t workspaceKeyOnce = PTHREAD_ONCE_INIT;
+
+// Size from which products use Strassen-Winograd, see gemm.h
+static size_t strassenThreshold = GEMM_STRASSEN_THRESHOLD;
+
+// Implementation of the products, see gemm.h. Native until the constructor
+// below has read GEMM_BACKEND_ENV.
+static GemmBackend backend = GEMM_BACKEND_NATIVE;
+
+// A product split over the thread pool. C is cut into rowParts x colParts
+// blocks, one task each. Operands are those of the element type of the
+// product.
+typedef struct GemmTask {
+	int transA;
+	int transB;
+	size_t m;
+	size_t n;
+	size_t k;
+	double alpha;
+	double beta;
+	const void* a;
+	size_t lda;
+	const void* b;
+	size_t ldb;
+	void* c;
+	size_t ldc;
+	size_t rowParts;
+	size_t colParts;
+} GemmTask;
+
+// A matrix-vector product split over the thread pool, along rows of A, or
+// along columns of A when it is transposed. x and y are contiguous.
+typedef struct GemvTask {
+	int trans;
+	size_t rows;
+	size_t cols;
+	double alpha;
+	double beta;
+	const void* a;
+	size_t lda;
+	const void* x;
+	void* y;
+	size_t incy;
+	size_t parts;
+} GemvTask;
+
+// A rank-1 update split over the thread pool along rows of A. x and y are
+// contiguous.
+typedef struct GerTask {
+	size_t rows;
+	size_t cols;
+	double alpha;
+	const void* x;
+	const void* y;
+	void* a;
+	size_t lda;
+	size_t parts;
+} GerTask;
+
+// Columns of a transposed GEMV task are multiples of this, which is a
+// multiple of every vector width
+#define GEMV_UNIT 16
+
+//* FUNCTION PROTOTYPES *******************************************************
+
+static void* reserveWorkspace(size_t size);
+static void releaseWorkspace(void);
+static void createWorkspaceKey(void);
+static void* alignedAlloc(size_t size);
+static size_t chooseGrid(size_t m, size_t n, size_t k, size_t nr,
+	size_t* rowParts, size_t* colParts);
+static size_t chooseGemvParts(size_t rows, size_t cols, size_t length,
+	size_t unit);
+static void setStrassenThreshold(size_t threshold);
+static int useStrassen(size_t m, size_t n, size_t k);
+static size_t strassenWorkspace(size_t m, size_t n, size_t k);
+static int setBackend(GemmBackend value);
+static GemmBackend getBackend(void);
+#if defined(GEMM_CBLAS)
+static int fitsCblas(size_t x, size_t y, size_t z);
+#endif
+static void init(void) __attribute__((constructor));
+
+//* KERNEL INSTANTIATION ******************************************************
+
+// Portable GEMV kernels, a "vector" of one element
+#define GEMV_NAME(name) XCAT(d, XCAT(name, Generic))
+#define GEMV_TARGET
+#define GEMV_T double
+#define GEMV_WIDTH 1
+#define GEMV_VEC double
+#define VLOADU(p) (*(p))
+#define VSTOREU(p, v) (*(p) = (v))
+#define VSET1(x) (x)
+#define VZERO() 0.0
+#define VFMADD(a, b, c) ((a) * (b) + (c))
+#define VHSUM(v) (v)
+#include "gemv_kernels.inc"
+
+#define GEMV_NAME(name) XCAT(s, XCAT(name, Generic))
+#define GEMV_TARGET
+#define GEMV_T float
+#define GEMV_WIDTH 1
+#define GEMV_VEC float
+#define VLOADU(p) (*(p))
+#define VSTOREU(p, v) (*(p) = (v))
+#define VSET1(x) (x)
+#define VZERO() 0.0f
+#define VFMADD(a, b, c) ((a) * (b) + (c))
+#define VHSUM(v) ((double)(v))
+#include "gemv_kernels.inc"
+
+#if defined(GEMM_X86)
+
+__attribute__((target("avx2,fma")))
+static inline double dhsumAvx2(__m256d v)
+{
+	double lanes[4];
+
+	_mm256_storeu_pd(lanes, v);
+	return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+// Float lanes are added in double
+__attribute__((target("avx2,fma")))
+static inline double shsumAvx2(__m256 v)
+{
+	float lanes[8];
+	double total = 0;
+	size_t i;
+
+	_mm256_storeu_ps(lanes, v);
+	for (i = 0; i < 8; i++) {
+		total += lanes[i];
+	}
+	return total;
+}
+
+#define GEMV_NAME(name) XCAT(d, XCAT(name, Avx2))
+#define GEMV_TARGET __attribute__((target("avx2,fma")))
+#define GEMV_T double
+#define GEMV_WIDTH 4
+#define GEMV_VEC __m256d
+#define VLOADU _mm256_loadu_pd
+#define VSTOREU _mm256_storeu_pd
+#define VSET1 _mm256_set1_pd
+#define VZERO _mm256_setzero_pd
+#define VFMADD _mm256_fmadd_pd
+#define VHSUM dhsumAvx2
+#include "gemv_kernels.inc"
+
+#define GEMV_NAME(name) XCAT(s, XCAT(name, Avx2))
+#define GEMV_TARGET __attribute__((target("avx2,fma")))
+#define GEMV_T float
+#define GEMV_WIDTH 8
+#define GEMV_VEC __m256
+#define VLOADU _mm256_loadu_ps
+#define VSTOREU _mm256_storeu_ps
+#define VSET1 _mm256_set1_ps
+#define VZERO _mm256_setzero_ps
+#define VFMADD _mm256_fmadd_ps
+#define VHSUM shsumAvx2
+#include "gemv_kernels.inc"
+
+#endif
+
+#define GEMM_FN(name) XCAT(d, name)
+#define GEMM_BLAS_FN(name) XCAT(cblas_d, name)
+#define GEMM_T double
+#define GEMM_TNR GEMM_NR
+#include "gemm_driver.inc"
+
+#define GEMM_FN(name) XCAT(s, name)
+#define GEMM_BLAS_FN(name) XCAT(cblas_s, name)
+#define GEMM_T float
+#define GEMM_TNR GEMM_SNR
+#include "gemm_driver.inc"
+
+//* INTERFACE INITIALIZATION **************************************************
+
+const struct GemmInterface GemmOps = {
+	.dgemm = dgemm,
+	.dgemmReference = dgemmReference,
+	.sgemm = sgemm,
+	.sgemmReference = sgemmReference,
+	.dgemv = dgemv,
+	.sgemv = sgemv,
+	.dger = dger,
+	.sger = sger,
+	.setStrassenThreshold = setStrassenThreshold,
+	.setBackend = setBackend,
+	.getBackend = getBackend,
+	.releaseWorkspace = releaseWorkspace
+};
+
+//* FUNCTION DEFINITIONS ******************************************************
+
+#if defined(GEMM_X86) && GEMM_MR == 6 && GEMM_NR == 8
+
+// 6x8 AVX2/FMA micro-kernel: 12 ymm accumulators, 2 for the B row and
+// 1 for the broadcast A value.
+__attribute__((target("avx2,fma")))
+static void dmicroKernelAvx2(size_t kc, const double* a, const double* b,
+	double* c, size_t ldc, double alpha, double beta)
+{
+	size_t p, i;
+	__m256d acc[GEMM_MR][2], b0, b1, ai, va, vb;
+
+	for (i = 0; i < GEMM_MR; i++) {
+		acc[i][0] = _mm256_setzero_pd();
+		acc[i][1] = _mm256_setzero_pd();
+	}
+
+	for (p = 0; p < kc; p++) {
+		b0 = _mm256_load_pd(b);
+		b1 = _mm256_load_pd(b + 4);
+
+		for (i = 0; i < GEMM_MR; i++) {
+			ai = _mm256_broadcast_sd(a + i);
+			acc[i][0] = _mm256_fmadd_pd(ai, b0, acc[i][0]);
+			acc[i][1] = _mm256_fmadd_pd(ai, b1, acc[i][1]);
+		}
+
+		a += GEMM_MR;
+		b += GEMM_NR;
+	}
+
+	va = _mm256_set1_pd(alpha);
+	vb = _mm256_set1_pd(beta);
+	for (i = 0; i < GEMM_MR; i++) {
+		if (beta == 0.0) {
+			_mm256_storeu_pd(c + i * ldc, _mm256_mul_pd(va, acc[i][0]));
+			_mm256_storeu_pd(c + i * ldc + 4, _mm256_mul_pd(va, acc[i][1]));
+		}
+		else {
+			_mm256_storeu_pd(c + i * ldc, _mm256_fmadd_pd(va, acc[i][0],
+				_mm256_mul_pd(vb, _mm256_loadu_pd(c + i * ldc))));
+			_mm256_storeu_pd(c + i * ldc + 4, _mm256_fmadd_pd(va, acc[i][1],
+				_mm256_mul_pd(vb, _mm256_loadu_pd(c + i * ldc + 4))));
+		}
+	}
+}
+
+#endif
+
+#if defined(GEMM_X86) && GEMM_MR == 6 && GEMM_SNR == 16
+
+// 6x16 single precision AVX2/FMA micro-kernel, the same register layout as
+// the double one with 8 floats per ymm, so it does twice the work per FMA.
+__attribute__((target("avx2,fma")))
+static void smicroKernelAvx2(size_t kc, const float* a, const float* b,
+	float* c, size_t ldc, double alpha, double beta)
+{
+	size_t p, i;
+	__m256 acc[GEMM_MR][2], b0, b1, ai, va, vb;
+
+	for (i = 0; i < GEMM_MR; i++) {
+		acc[i][0] = _mm256_setzero_ps();
+		acc[i][1] = _mm256_setzero_ps();
+	}
+
+	for (p = 0; p < kc; p++) {
+		b0 = _mm256_load_ps(b);
+		b1 = _mm256_load_ps(b + 8);
+
+		for (i = 0; i < GEMM_MR; i++) {
+			ai = _mm256_broadcast_ss(a + i);
+			acc[i][0] = _mm256_fmadd_ps(ai, b0, acc[i][0]);
+			acc[i][1] = _mm256_fmadd_ps(ai, b1, acc[i][1]);
+		}
+
+		a += GEMM_MR;
+		b += GEMM_SNR;
+	}
+
+	va = _mm256_set1_ps((float)alpha);
+	vb = _mm256_set1_ps((float)beta);
+	for (i = 0; i < GEMM_MR; i++) {
+		if (beta == 0.0) {
+			_mm256_storeu_ps(c + i * ldc, _mm256_mul_ps(va, acc[i][0]));
+			_mm256_storeu_ps(c + i * ldc + 8, _mm256_mul_ps(va, acc[i][1]));
+		}
+		else {
+			_mm256_storeu_ps(c + i * ldc, _mm256_fmadd_ps(va, acc[i][0],
+				_mm256_mul_ps(vb, _mm256_loadu_ps(c + i * ldc))));
+			_mm256_storeu_ps(c + i * ldc + 8, _mm256_fmadd_ps(va, acc[i][1],
+				_mm256_mul_ps(vb, _mm256_loadu_ps(c + i * ldc + 8))));
+		}
+	}
+}
+
+#endif
+
+static dMicroKernel dselectMicroKernel(void)
+{
+#if defined(GEMM_X86) && GEMM_MR == 6 && GEMM_NR == 8
+	if (SimdOps.level() >= SIMD_AVX2) {
+		return dmicroKernelAvx2;
+	}
+#endif
+	return dmicroKernelGeneric;
+}
+
+static sMicroKernel sselectMicroKernel(void)
+{
+#if defined(GEMM_X86) && GEMM_MR == 6 && GEMM_SNR == 16
+	if (SimdOps.level() >= SIMD_AVX2) {
+		return smicroKernelAvx2;
+	}
+#endif
+	return smicroKernelGeneric;
+}
+
+static void dselectGemv(dGemvN* gemvN, dGemvT* gemvT, dGer* ger)
+{
+#if defined(GEMM_X86)
+	if (SimdOps.level() >= SIMD_AVX2) {
+		*gemvN = dgemvNAvx2;
+		*gemvT = dgemvTAvx2;
+		*ger = dgerAvx2;
+		return;
+	}
+#endif
+	*gemvN = dgemvNGeneric;
+	*gemvT = dgemvTGeneric;
+	*ger = dgerGeneric;
+}
+
+static void sselectGemv(sGemvN* gemvN, sGemvT* gemvT, sGer* ger)
+{
+#if defined(GEMM_X86)
+	if (SimdOps.level() >= SIMD_AVX2) {
+		*gemvN = sgemvNAvx2;
+		*gemvT = sgemvTAvx2;
+		*ger = sgerAvx2;
+		return;
+	}
+#endif
+	*gemvN = sgemvNGeneric;
+	*gemvT = sgemvTGeneric;
+	*ger = sgerGeneric;
+}
+
+// Size in bytes
+static void* reserveWorkspace(size_t size)
+{
+	void* buffer;
+
+	if (size <= workspaceSize) {
+		return workspace;
+	}
+
+	buffer = alignedAlloc(size);
+	if (buffer == NULL) {
+		MAL_ERR();
+		return NULL;
+	}
+
+	free(workspace);
+	workspace = buffer;
+	workspaceSize = size;
+
+	pthread_once(&workspaceKeyOnce, createWorkspaceKey);
+	pthread_setspecific(workspaceKey, workspace);
+
+	return workspace;
+}
+
+static void releaseWorkspace(void)
+{
+	free(workspace);
+	workspace = NULL;
+	workspaceSize = 0;
+
+	pthread_once(&workspaceKeyOnce, createWorkspaceKey);
+	pthread_setspecific(workspaceKey, NULL);
+}
+
+static void createWorkspaceKey(void)
+{
+	pthread_key_create(&workspaceKey, free);
+}
+
+// Packed panels are read with aligned vector loads, so they are placed on
+// cache line boundaries.
+static void* alignedAlloc(size_t size)
+{
+	size = (size + 63) & ~(size_t)63;
+	return aligned_alloc(64, size);
+}
+
+// Picks the grid a product is split into, returns its number of blocks.
+// Small products stay serial. Otherwise the grid uses as many threads as
+// the register tiles allow, with blocks as square as possible, which
+// minimizes the packing every block repeats.
+static size_t chooseGrid(size_t m, size_t n, size_t k, size_t nr,
+	size_t* rowParts, size_t* colParts)
+{
+	size_t threads, r, c, maxRows, maxCols, best = 0;
+	double rows, cols, shape, bestShape = 0;
+
+	*rowParts = 1;
+	*colParts = 1;
+
+	if ((double)m * n * k < GEMM_PARALLEL_THRESHOLD) {
+		return 1;
+	}
+
+	threads = ThreadPoolOps.threadCount();
+	maxRows = (m + GEMM_MR - 1) / GEMM_MR;
+	maxCols = (n + nr - 1) / nr;
+
+	for (r = 1; r <= threads && r <= maxRows; r++) {
+		c = threads / r;
+		if (c > maxCols) {
+			c = maxCols;
+		}
+
+		rows = (double)m / r;
+		cols = (double)n / c;
+		shape = (rows < cols) ? rows / cols : cols / rows;
+
+		if (r * c > best || (r * c == best && shape > bestShape)) {
+			best = r * c;
+			bestShape = shape;
+			*rowParts = r;
+			*colParts = c;
+		}
+	}
+
+	return best;
+}
+
+// Matrix-vector products are bound by reading A once, so they only go
+// parallel when A is large, then on every thread the units of the split
+// length allow
+static size_t chooseGemvParts(size_t rows, size_t cols, size_t length,
+	size_t unit)
+{
+	size_t threads, units;
+
+	if ((double)rows * cols < GEMV_PARALLEL_THRESHOLD) {
+		return 1;
+	}
+
+	threads = ThreadPoolOps.threadCount();
+	units = (length + unit - 1) / unit;
+
+	return (threads < units) ? threads : units;
+}
+
+static void setStrassenThreshold(size_t threshold)
+{
+	strassenThreshold = (threshold == 1) ? 2 : threshold;
+}
+
+// Halving must leave every dimension at least 1, and vectors go to GEMV
+static int useStrassen(size_t m, size_t n, size_t k)
+{
+	size_t threshold = strassenThreshold;
+
+	return threshold != 0 && m >= threshold && n >= threshold
+		&& k >= threshold;
+}
+
+// Elements of the temporaries of a recursion: at each level X holds a
+// quarter of op(A) or of C, Y a quarter of op(B)
+static size_t strassenWorkspace(size_t m, size_t n, size_t k)
+{
+	size_t size = 0;
+
+	while (useStrassen(m, n, k)) {
+		m /= 2;
+		n /= 2;
+		k /= 2;
+		size += m * ((k > n) ? k : n) + k * n;
+	}
+
+	return size;
+}
+
+static int setBackend(GemmBackend value)
+{
+	if (value == GEMM_BACKEND_NATIVE) {
+		backend = value;
+		return 0;
+	}
+
+#if defined(GEMM_CBLAS)
+	if (value == GEMM_BACKEND_CBLAS) {
+		backend = value;
+		return 0;
+	}
+#endif
+
+	PRINT_ERR("GEMM backend not built in!");
+	return -1;
+}
+
+static GemmBackend getBackend(void)
+{
+	return backend;
+}
+
+#if defined(GEMM_CBLAS)
+
+// CBLAS takes sizes as positive ints. Empty products stay native, where
+// they cost nothing.
+static int fitsCblas(size_t x, size_t y, size_t z)
+{
+	return x > 0 && y > 0 && z > 0 && x <= INT_MAX && y <= INT_MAX
+		&& z <= INT_MAX;
+}
+
+#endif
+
+static void init(void)
+{
+	const char* env = getenv(GEMM_BACKEND_ENV);
+
+	if (env == NULL || *env == '\0' || strcmp(env, "native") == 0) {
+		return;
+	}
+
+	if (strcmp(env, "cblas") == 0) {
+		setBackend(GEMM_BACKEND_CBLAS);
+		return;
+	}
+
+	PRINT_ERR("Invalid " GEMM_BACKEND_ENV " value!");
+}
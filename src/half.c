@@ -0,0 +1,700 @@
+#include "../include/half.h"
+#include "../include/gemm.h"
+#include "../include/simd.h"
+#include "../include/thread_pool.h"
+#include "../lib/macro_error.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#include <cpuid.h>
+#define HALF_X86 1
+#endif
+
+//* STRUCT DEFINITION *********************************************************
+
+typedef struct HalfStruct {
+	size_t row;
+	size_t col;
+	size_t ld;			// Multiple of HALF_ALIGN, padding is 0
+	HalfFormat format;
+	uint16_t* data;
+} HalfStruct;
+
+// A matrix-vector product y = A * x split along rows over the thread pool
+typedef struct HalfTask {
+	const HalfStruct* half;
+	const double* x;
+	double* y;
+	size_t incy;
+	size_t parts;
+} HalfTask;
+
+// Dot products of four rows with x, and the widening of n elements
+typedef void (*DotKernel)(size_t k, const uint16_t* const rows[4],
+	const double* x, double out[4]);
+typedef void (*WidenKernel)(const uint16_t* h, double* x, size_t n);
+
+// Row length of the stored elements is a multiple of this
+#define HALF_ALIGN 16
+
+// Rows of a matrix-vector product computed together
+#define HALF_TILE 4
+
+static int hasF16c = 0;
+
+//* FUNCTION PROTOTYPES *******************************************************
+
+static Half create(size_t row, size_t col, HalfFormat format);
+static Half fromMatrix(const Matrix matrix, HalfFormat format);
+static Matrix toMatrix(const Half half);
+static void destroy(Half* halfAddr);
+static int get(const Half half, size_t row, size_t col, double* value);
+static size_t getRow(const Half half);
+static size_t getCol(const Half half);
+static HalfFormat getFormat(const Half half);
+static uint16_t encode(double x, HalfFormat format);
+static double decode(uint16_t h, HalfFormat format);
+static Matrix multiply(const Half half, const Matrix matrix);
+static int fromMatrixInto(Half dst, const Matrix matrix);
+static int toMatrixInto(Matrix dst, const Half half);
+static int multiplyInto(Matrix dst, const Half half, const Matrix matrix);
+static int isValid(const Half half);
+static int gemv(const HalfStruct* half, const double* x, double* y,
+	size_t incy);
+static int gemvTask(void* arg, size_t index);
+static int gemm(const HalfStruct* half, const double* b, size_t ldb,
+	size_t n, double* c, size_t ldc);
+static DotKernel selectDot(HalfFormat format);
+static WidenKernel selectWiden(HalfFormat format);
+static void dotFp16Generic(size_t k, const uint16_t* const rows[4],
+	const double* x, double out[4]);
+static void dotBf16Generic(size_t k, const uint16_t* const rows[4],
+	const double* x, double out[4]);
+static void widenFp16Generic(const uint16_t* h, double* x, size_t n);
+static void widenBf16Generic(const uint16_t* h, double* x, size_t n);
+static double decodeFp16(uint16_t h);
+static double decodeBf16(uint16_t h);
+static void init(void) __attribute__((constructor));
+
+//* INTERFACE INITIALIZATION **************************************************
+
+const struct HalfInterface HalfOps = {
+	.create = create,
+	.fromMatrix = fromMatrix,
+	.toMatrix = toMatrix,
+	.destroy = destroy,
+	.get = get,
+	.getRow = getRow,
+	.getCol = getCol,
+	.getFormat = getFormat,
+	.encode = encode,
+	.decode = decode,
+	.multiply = multiply,
+	.into = {
+		.fromMatrix = fromMatrixInto,
+		.toMatrix = toMatrixInto,
+		.multiply = multiplyInto
+	}
+};
+
+//* FUNCTION DEFINITIONS ******************************************************
+
+static Half create(size_t row, size_t col, HalfFormat format)
+{
+	Half half;
+
+	if (format != HALF_FP16 && format != HALF_BF16) {
+		PRINT_ERR("Invalid half format!");
+		return NULL;
+	}
+
+	if (row == 0 || col == 0) {
+		PRINT_ERR("Invalid matrix dimensions!");
+		return NULL;
+	}
+
+	half = (Half)malloc(sizeof(HalfStruct));
+	if (half == NULL) {
+		MAL_ERR();
+		return NULL;
+	}
+
+	half->row = row;
+	half->col = col;
+	half->ld = (col + HALF_ALIGN - 1) / HALF_ALIGN * HALF_ALIGN;
+	half->format = format;
+	half->data = (uint16_t*)calloc(row * half->ld, sizeof(uint16_t));
+	if (half->data == NULL) {
+		MAL_ERR();
+		free(half);
+		return NULL;
+	}
+
+	return half;
+}
+
+static Half fromMatrix(const Matrix matrix, HalfFormat format)
+{
+	Half half;
+
+	if (!MatrixOps.isValid(matrix)) {
+		PRINT_ERR("Invalid matrix!");
+		return NULL;
+	}
+
+	half = create(MatrixOps.getRow(matrix), MatrixOps.getCol(matrix), format);
+	if (half == NULL) {
+		return NULL;
+	}
+
+	if (fromMatrixInto(half, matrix) == -1) {
+		destroy(&half);
+		return NULL;
+	}
+
+	return half;
+}
+
+static Matrix toMatrix(const Half half)
+{
+	Matrix matrix;
+
+	if (!isValid(half)) {
+		PRINT_ERR("Invalid half matrix!");
+		return NULL;
+	}
+
+	matrix = MatrixOps.create(half->row, half->col);
+	if (matrix == NULL) {
+		return NULL;
+	}
+
+	if (toMatrixInto(matrix, half) == -1) {
+		MatrixOps.destroy(&matrix);
+		return NULL;
+	}
+
+	return matrix;
+}
+
+static void destroy(Half* halfAddr)
+{
+	Half half;
+
+	if (halfAddr == NULL) {
+		return;
+	}
+
+	half = *halfAddr;
+	if (half) {
+		free(half->data);
+		free(half);
+	}
+
+	*halfAddr = NULL;
+}
+
+static int get(const Half half, size_t row, size_t col, double* value)
+{
+	if (!isValid(half) || value == NULL) {
+		PRINT_ERR("NULL pointer exception!");
+		return -1;
+	}
+
+	if (row >= half->row || col >= half->col) {
+		PRINT_ERR("Index out of bounds!");
+		return -1;
+	}
+
+	*value = decode(half->data[row * half->ld + col], half->format);
+
+	return 0;
+}
+
+static size_t getRow(const Half half)
+{
+	if (!isValid(half)) {
+		PRINT_ERR("Invalid half matrix!");
+		return 0;
+	}
+
+	return half->row;
+}
+
+static size_t getCol(const Half half)
+{
+	if (!isValid(half)) {
+		PRINT_ERR("Invalid half matrix!");
+		return 0;
+	}
+
+	return half->col;
+}
+
+static HalfFormat getFormat(const Half half)
+{
+	if (!isValid(half)) {
+		PRINT_ERR("Invalid half matrix!");
+		return HALF_FP16;
+	}
+
+	return half->format;
+}
+
+// Rounds straight from the double, rounding through a float first could
+// round twice. The significand of a normal value is scaled to an integer
+// with rint, ties to even. A carry out of it lands in the exponent field,
+// which is the right encoding, up to infinity. Subnormals are multiples of
+// the smallest one.
+static uint16_t encode(double x, HalfFormat format)
+{
+	int bits = (format == HALF_BF16) ? 7 : 10;
+	int bias = (format == HALF_BF16) ? 127 : 15;
+	uint16_t sign = signbit(x) ? 0x8000 : 0;
+	uint16_t inf = (uint16_t)((2 * bias + 1) << bits);
+	double a = fabs(x), m;
+	unsigned long value;
+	int e;
+
+	if (isnan(x)) {
+		return sign | inf | (uint16_t)(1u << (bits - 1));
+	}
+
+	if (isinf(x)) {
+		return sign | inf;
+	}
+
+	if (a < ldexp(1.0, 1 - bias)) {
+		value = (unsigned long)rint(ldexp(a, bias - 1 + bits));
+		return sign | (uint16_t)value;
+	}
+
+	// a = m * 2^e with m in [1, 2)
+	m = frexp(a, &e) * 2;
+	e--;
+	if (e > bias) {
+		return sign | inf;
+	}
+
+	value = ((unsigned long)(e + bias) << bits)
+		+ (unsigned long)rint(ldexp(m - 1, bits));
+
+	return sign | (uint16_t)((value < inf) ? value : inf);
+}
+
+static double decode(uint16_t h, HalfFormat format)
+{
+	return (format == HALF_BF16) ? decodeBf16(h) : decodeFp16(h);
+}
+
+static Matrix multiply(const Half half, const Matrix matrix)
+{
+	Matrix result;
+
+	if (!isValid(half) || !MatrixOps.isValid(matrix)) {
+		PRINT_ERR("Invalid matrix!");
+		return NULL;
+	}
+
+	result = MatrixOps.create(half->row, MatrixOps.getCol(matrix));
+	if (result == NULL) {
+		return NULL;
+	}
+
+	if (multiplyInto(result, half, matrix) == -1) {
+		MatrixOps.destroy(&result);
+		return NULL;
+	}
+
+	return result;
+}
+
+static int fromMatrixInto(Half dst, const Matrix matrix)
+{
+	size_t i, j, ld;
+	const double* data;
+
+	if (!isValid(dst) || !MatrixOps.isValid(matrix)) {
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	if (MatrixOps.getRow(matrix) != dst->row
+		|| MatrixOps.getCol(matrix) != dst->col)
+	{
+		PRINT_ERR("Matrix dimensions do not match!");
+		return -1;
+	}
+
+	data = MatrixOps.getDataConst(matrix);
+	ld = MatrixOps.getLd(matrix);
+	for (i = 0; i < dst->row; i++) {
+		for (j = 0; j < dst->col; j++) {
+			dst->data[i * dst->ld + j] = encode(data[i * ld + j], dst->format);
+		}
+	}
+
+	return 0;
+}
+
+static int toMatrixInto(Matrix dst, const Half half)
+{
+	size_t i, ld;
+	double* data;
+	WidenKernel widen;
+
+	if (!isValid(half) || !MatrixOps.isValid(dst)) {
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	if (MatrixOps.getRow(dst) != half->row
+		|| MatrixOps.getCol(dst) != half->col)
+	{
+		PRINT_ERR("Matrix dimensions do not match!");
+		return -1;
+	}
+
+	data = MatrixOps.getData(dst);
+	if (data == NULL) {
+		return -1;
+	}
+
+	ld = MatrixOps.getLd(dst);
+	widen = selectWiden(half->format);
+	for (i = 0; i < half->row; i++) {
+		widen(half->data + i * half->ld, data + i * ld, half->col);
+	}
+
+	return 0;
+}
+
+static int multiplyInto(Matrix dst, const Half half, const Matrix matrix)
+{
+	size_t i, k, n, ld;
+	const double* data;
+	double* x, * out;
+	int err;
+
+	if (!isValid(half) || !MatrixOps.isValid(matrix)
+		|| !MatrixOps.isValid(dst))
+	{
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	k = half->col;
+	n = MatrixOps.getCol(matrix);
+	if (MatrixOps.getRow(matrix) != k || MatrixOps.getRow(dst) != half->row
+		|| MatrixOps.getCol(dst) != n)
+	{
+		PRINT_ERR("Matrix dimensions do not match!");
+		return -1;
+	}
+
+	out = MatrixOps.getData(dst);
+	if (out == NULL) {
+		return -1;
+	}
+
+	data = MatrixOps.getDataConst(matrix);
+	ld = MatrixOps.getLd(matrix);
+
+	if (n > 1) {
+		// The GEMM reads the matrix while writing dst
+		if (MatrixOps.overlaps(dst, matrix)) {
+			PRINT_ERR("Destination can't alias an operand!");
+			return -1;
+		}
+		return gemm(half, data, ld, n, out, MatrixOps.getLd(dst));
+	}
+
+	// The vector, contiguous, also keeps dst from aliasing it
+	x = (double*)malloc(k * sizeof(double));
+	if (x == NULL) {
+		MAL_ERR();
+		return -1;
+	}
+
+	for (i = 0; i < k; i++) {
+		x[i] = data[i * ld];
+	}
+
+	err = gemv(half, x, out, MatrixOps.getLd(dst));
+	free(x);
+
+	return err;
+}
+
+static int isValid(const Half half)
+{
+	return half != NULL && half->data != NULL;
+}
+
+static int gemv(const HalfStruct* half, const double* x, double* y,
+	size_t incy)
+{
+	HalfTask task = {half, x, y, incy, 1};
+	size_t units, threads;
+
+	if ((double)half->row * half->col >= HALF_PARALLEL_THRESHOLD) {
+		units = (half->row + HALF_TILE - 1) / HALF_TILE;
+		threads = ThreadPoolOps.threadCount();
+		task.parts = (threads < units) ? threads : units;
+	}
+
+	return ThreadPoolOps.run(gemvTask, &task, task.parts);
+}
+
+// Runs part index of the HalfTask arg. Short tiles repeat their first row
+// and drop the extra results.
+static int gemvTask(void* arg, size_t index)
+{
+	const HalfTask* task = arg;
+	const HalfStruct* half = task->half;
+	DotKernel dot = selectDot(half->format);
+	const uint16_t* rows[HALF_TILE];
+	double out[HALF_TILE];
+	size_t i, t, first, size, count;
+
+	ThreadPoolOps.partition(half->row, HALF_TILE, task->parts, index,
+		&first, &size);
+	for (i = first; i < first + size; i += count) {
+		count = (first + size - i < HALF_TILE) ? first + size - i : HALF_TILE;
+		for (t = 0; t < HALF_TILE; t++) {
+			rows[t] = half->data + (i + ((t < count) ? t : 0)) * half->ld;
+		}
+		dot(half->col, rows, task->x, out);
+		for (t = 0; t < count; t++) {
+			task->y[(i + t) * task->incy] = out[t];
+		}
+	}
+
+	return 0;
+}
+
+// Products with several columns are compute bound, the widened panels go
+// through the double GEMM
+static int gemm(const HalfStruct* half, const double* b, size_t ldb,
+	size_t n, double* c, size_t ldc)
+{
+	WidenKernel widen = selectWiden(half->format);
+	size_t i, r, rows, k = half->col;
+	double* panel;
+	int err = 0;
+
+	panel = (double*)malloc(HALF_PANEL * k * sizeof(double));
+	if (panel == NULL) {
+		MAL_ERR();
+		return -1;
+	}
+
+	for (i = 0; i < half->row && !err; i += HALF_PANEL) {
+		rows = (half->row - i < HALF_PANEL) ? half->row - i : HALF_PANEL;
+		for (r = 0; r < rows; r++) {
+			widen(half->data + (i + r) * half->ld, panel + r * k, k);
+		}
+		err = GemmOps.dgemm(0, 0, rows, n, k, 1.0, panel, k, b, ldb, 0.0,
+			c + i * ldc, ldc);
+	}
+
+	free(panel);
+
+	return err;
+}
+
+#if defined(HALF_X86)
+
+// Eight elements as floats: vcvtph2ps for fp16, a shift for bf16
+#define HALF_WIDEN_FP16(p) _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(p)))
+#define HALF_WIDEN_BF16(p) _mm256_castsi256_ps(_mm256_slli_epi32( \
+	_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(p))), 16))
+
+// Four rows share the loads of x. Each row sums in two vectors of doubles,
+// added at the end, then the tail in order.
+#define HALF_DOT_KERNEL(name, isa, WIDEN, DECODE) \
+__attribute__((target(isa))) \
+static void name(size_t k, const uint16_t* const rows[4], const double* x, \
+	double out[4]) \
+{ \
+	__m256d low[4], high[4], x0, x1; \
+	__m256 f; \
+	double lanes[4]; \
+	size_t p, q, r; \
+	for (r = 0; r < 4; r++) { \
+		low[r] = high[r] = _mm256_setzero_pd(); \
+	} \
+	for (p = 0; p + 8 <= k; p += 8) { \
+		x0 = _mm256_loadu_pd(x + p); \
+		x1 = _mm256_loadu_pd(x + p + 4); \
+		for (r = 0; r < 4; r++) { \
+			f = WIDEN(rows[r] + p); \
+			low[r] = _mm256_fmadd_pd(_mm256_cvtps_pd( \
+				_mm256_castps256_ps128(f)), x0, low[r]); \
+			high[r] = _mm256_fmadd_pd(_mm256_cvtps_pd( \
+				_mm256_extractf128_ps(f, 1)), x1, high[r]); \
+		} \
+	} \
+	for (r = 0; r < 4; r++) { \
+		_mm256_storeu_pd(lanes, _mm256_add_pd(low[r], high[r])); \
+		out[r] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]); \
+		for (q = p; q < k; q++) { \
+			out[r] += DECODE(rows[r][q]) * x[q]; \
+		} \
+	} \
+}
+
+#define HALF_WIDEN_KERNEL(name, isa, WIDEN, DECODE) \
+__attribute__((target(isa))) \
+static void name(const uint16_t* h, double* x, size_t n) \
+{ \
+	__m256 f; \
+	size_t p; \
+	for (p = 0; p + 8 <= n; p += 8) { \
+		f = WIDEN(h + p); \
+		_mm256_storeu_pd(x + p, _mm256_cvtps_pd(_mm256_castps256_ps128(f))); \
+		_mm256_storeu_pd(x + p + 4, \
+			_mm256_cvtps_pd(_mm256_extractf128_ps(f, 1))); \
+	} \
+	for (; p < n; p++) { \
+		x[p] = DECODE(h[p]); \
+	} \
+}
+
+HALF_DOT_KERNEL(dotFp16F16c, "avx2,fma,f16c", HALF_WIDEN_FP16, decodeFp16)
+HALF_DOT_KERNEL(dotBf16Avx2, "avx2,fma", HALF_WIDEN_BF16, decodeBf16)
+HALF_WIDEN_KERNEL(widenFp16F16c, "avx2,f16c", HALF_WIDEN_FP16, decodeFp16)
+HALF_WIDEN_KERNEL(widenBf16Avx2, "avx2", HALF_WIDEN_BF16, decodeBf16)
+
+#undef HALF_DOT_KERNEL
+#undef HALF_WIDEN_KERNEL
+#undef HALF_WIDEN_FP16
+#undef HALF_WIDEN_BF16
+
+#endif
+
+static DotKernel selectDot(HalfFormat format)
+{
+#if defined(HALF_X86)
+	if (SimdOps.level() >= SIMD_AVX2) {
+		if (format == HALF_BF16) {
+			return dotBf16Avx2;
+		}
+		if (hasF16c) {
+			return dotFp16F16c;
+		}
+	}
+#endif
+	return (format == HALF_BF16) ? dotBf16Generic : dotFp16Generic;
+}
+
+static WidenKernel selectWiden(HalfFormat format)
+{
+#if defined(HALF_X86)
+	if (SimdOps.level() >= SIMD_AVX2) {
+		if (format == HALF_BF16) {
+			return widenBf16Avx2;
+		}
+		if (hasF16c) {
+			return widenFp16F16c;
+		}
+	}
+#endif
+	return (format == HALF_BF16) ? widenBf16Generic : widenFp16Generic;
+}
+
+static void dotFp16Generic(size_t k, const uint16_t* const rows[4],
+	const double* x, double out[4])
+{
+	size_t p, r;
+
+	for (r = 0; r < 4; r++) {
+		out[r] = 0;
+		for (p = 0; p < k; p++) {
+			out[r] += decodeFp16(rows[r][p]) * x[p];
+		}
+	}
+}
+
+static void dotBf16Generic(size_t k, const uint16_t* const rows[4],
+	const double* x, double out[4])
+{
+	size_t p, r;
+
+	for (r = 0; r < 4; r++) {
+		out[r] = 0;
+		for (p = 0; p < k; p++) {
+			out[r] += decodeBf16(rows[r][p]) * x[p];
+		}
+	}
+}
+
+static void widenFp16Generic(const uint16_t* h, double* x, size_t n)
+{
+	size_t p;
+
+	for (p = 0; p < n; p++) {
+		x[p] = decodeFp16(h[p]);
+	}
+}
+
+static void widenBf16Generic(const uint16_t* h, double* x, size_t n)
+{
+	size_t p;
+
+	for (p = 0; p < n; p++) {
+		x[p] = decodeBf16(h[p]);
+	}
+}
+
+// Normal values move their fields into a double, subnormals are multiples
+// of 2^-24
+static double decodeFp16(uint16_t h)
+{
+	uint64_t exponent = (h >> 10) & 0x1F, mantissa = h & 0x3FF;
+	uint64_t bits = (uint64_t)(h & 0x8000) << 48;
+	double value;
+
+	if (exponent == 0) {
+		value = (double)mantissa * 0x1p-24;
+		return (h & 0x8000) ? -value : value;
+	}
+
+	if (exponent == 0x1F) {
+		bits |= 0x7FF0000000000000ull | (mantissa << 42);
+	}
+	else {
+		bits |= ((exponent + 1008) << 52) | (mantissa << 42);
+	}
+	memcpy(&value, &bits, sizeof(value));
+
+	return value;
+}
+
+// The upper half of a float
+static double decodeBf16(uint16_t h)
+{
+	uint32_t bits = (uint32_t)h << 16;
+	float value;
+
+	memcpy(&value, &bits, sizeof(value));
+
+	return value;
+}
+
+// vcvtph2ps is not part of AVX2, F16C has its own cpuid bit
+static void init(void)
+{
+#if defined(HALF_X86)
+	unsigned int eax, ebx, ecx, edx;
+
+	if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+		hasF16c = (ecx & bit_F16C) != 0;
+	}
+#endif
+}
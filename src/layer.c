@@ -1,9 +1,12 @@
 #include "../include/layer.h"
+#include "../include/activation.h"
+#include "../include/random.h"
 #include "../lib/macro_error.h"
 
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <math.h>
 
 // Will error function be in the layer or in the neural network?
 
@@ -14,7 +17,11 @@ typedef struct LayerStruct {
 	size_t outputSize;
 	double (*activationFunction)(double);
 	double (*activationDerivative)(double);
-	Matrix weights;
+	MatrixPrecision precision;
+	Matrix weights;		// Used by double precision layers, NULL otherwise
+	MatrixF weightsF;	// Used by single precision layers, NULL otherwise
+	Quantized weightsQ;	// Used by MATRIX_INT8 layers, NULL otherwise
+	Half weightsH;		// Used by MATRIX_FP16 and MATRIX_BF16 layers
 } LayerStruct;
 
 //* FUNCTION PROTOTYPES *******************************************************
@@ -22,8 +29,18 @@ typedef struct LayerStruct {
 Layer create(size_t inputSize, size_t outputSize,
 	double (*activationFunction)(double),
 	double (*activationDerivative)(double));
+Layer createWithPrecision(size_t inputSize, size_t outputSize,
+	double (*activationFunction)(double),
+	double (*activationDerivative)(double), MatrixPrecision precision);
 void destroy(Layer* layerAddr);
-const Matrix getWeights(Layer layer);
+int initialize(Layer layer, LayerInit init, uint64_t seed, uint64_t stream);
+Matrix getWeights(Layer layer);
+MatrixF getWeightsF(Layer layer);
+Quantized getWeightsQ(Layer layer);
+Half getWeightsH(Layer layer);
+int quantize(Layer layer);
+int compress(Layer layer, MatrixPrecision precision);
+MatrixPrecision getPrecision(Layer layer);
 double (*getActivationFunction(Layer layer))(double);
 double (*getActivationDerivative(Layer layer))(double);
 size_t getInputSize(Layer layer);
@@ -34,14 +51,23 @@ int updateWeights(Layer layer, const Matrix gradient, double learningRate);
 int setWeights(Layer layer, const Matrix weights);
 int isValid(Layer layer);
 int feedForward(Layer layer, const Matrix input, Matrix output);
+int feedForwardF(Layer layer, const MatrixF input, MatrixF output);
 Matrix jacobian(Layer layer, const Matrix input);
 
 //* INTERFACE INITIALIZATION **************************************************
 
 const struct LayerInterface LayerOps = {
 	.create = create,
+	.createWithPrecision = createWithPrecision,
 	.destroy = destroy,
+	.initialize = initialize,
 	.getWeights = getWeights,
+	.getWeightsF = getWeightsF,
+	.getWeightsQ = getWeightsQ,
+	.getWeightsH = getWeightsH,
+	.quantize = quantize,
+	.compress = compress,
+	.getPrecision = getPrecision,
 	.getActivationFunction = getActivationFunction,
 	.getActivationDerivative = getActivationDerivative,
 	.getInputSize = getInputSize,
@@ -51,6 +77,8 @@ const struct LayerInterface LayerOps = {
 	.setWeights = setWeights,
 	.isValid = isValid,
 	.feedForward = feedForward,
+	.feedForwardF = feedForwardF,
+	.jacobian = jacobian
 };
 
 //* FUNCTION DEFINITIONS ******************************************************
@@ -58,9 +86,21 @@ const struct LayerInterface LayerOps = {
 Layer create(size_t inputSize, size_t outputSize,
 	double (*activationFunction)(double),
 	double (*activationDerivative)(double))
+{
+	return createWithPrecision(inputSize, outputSize, activationFunction,
+		activationDerivative, MATRIX_DOUBLE);
+}
+
+Layer createWithPrecision(size_t inputSize, size_t outputSize,
+	double (*activationFunction)(double),
+	double (*activationDerivative)(double), MatrixPrecision precision)
 {
 	Layer layer;
-	Matrix weights;
+	Matrix weights = NULL;
+	MatrixF weightsF = NULL;
+	Quantized weightsQ = NULL;
+	Half weightsH = NULL;
+	LayerInit init;
 
 	if (inputSize == 0 || outputSize == 0) {
 		PRINT_ERR("Layer size can't be zero!");
@@ -78,8 +118,22 @@ Layer create(size_t inputSize, size_t outputSize,
 		return NULL;
 	}
 
-	weights = MatrixOps.create(outputSize, inputSize);
-	if (weights == NULL) {
+	if (precision == MATRIX_FLOAT) {
+		weightsF = MatrixFOps.create(outputSize, inputSize);
+	}
+	else if (precision == MATRIX_INT8) {
+		weightsQ = QuantizedOps.create(outputSize, inputSize);
+	}
+	else if (precision == MATRIX_FP16 || precision == MATRIX_BF16) {
+		weightsH = HalfOps.create(outputSize, inputSize,
+			(precision == MATRIX_BF16) ? HALF_BF16 : HALF_FP16);
+	}
+	else {
+		weights = MatrixOps.create(outputSize, inputSize);
+	}
+
+	if (weights == NULL && weightsF == NULL && weightsQ == NULL
+		&& weightsH == NULL) {
 		free(layer);
 		return NULL;
 	}
@@ -88,7 +142,20 @@ Layer create(size_t inputSize, size_t outputSize,
 	layer->outputSize = outputSize;
 	layer->activationFunction = activationFunction;
 	layer->activationDerivative = activationDerivative;
+	layer->precision = precision;
 	layer->weights = weights;
+	layer->weightsF = weightsF;
+	layer->weightsQ = weightsQ;
+	layer->weightsH = weightsH;
+
+	// He for the rectifiers, which zero half of their inputs
+	init = (activationFunction == ActivationOps.f.relu
+		|| activationFunction == ActivationOps.f.leakyRelu)
+		? LAYER_INIT_HE : LAYER_INIT_XAVIER;
+	if (initialize(layer, init, RandomOps.seed(), RandomOps.nextStream())) {
+		destroy(&layer);
+		return NULL;
+	}
 
 	return layer;
 }
@@ -104,13 +171,65 @@ void destroy(Layer* layerAddr)
 	layer = *layerAddr;
 	if (layer) {
 		MatrixOps.destroy(&layer->weights);
+		MatrixFOps.destroy(&layer->weightsF);
+		QuantizedOps.destroy(&layer->weightsQ);
+		HalfOps.destroy(&layer->weightsH);
 		free(layer);
 	}
 
 	*layerAddr = NULL;
 }
 
-const Matrix getWeights(Layer layer)
+int initialize(Layer layer, LayerInit init, uint64_t seed, uint64_t stream)
+{
+	Matrix weights;
+	double scale;
+	int err;
+
+	if (!isValid(layer)) {
+		PRINT_ERR("Invalid layer!");
+		return -1;
+	}
+
+	if (init != LAYER_INIT_XAVIER && init != LAYER_INIT_HE) {
+		PRINT_ERR("Unknown initialization!");
+		return -1;
+	}
+
+	scale = (init == LAYER_INIT_XAVIER)
+		? sqrt(6.0 / (double)(layer->inputSize + layer->outputSize))
+		: sqrt(2.0 / (double)layer->inputSize);
+
+	if (layer->precision == MATRIX_FLOAT) {
+		return (init == LAYER_INIT_XAVIER)
+			? RandomOps.matrix.uniformF(layer->weightsF, seed, stream,
+				-scale, scale)
+			: RandomOps.matrix.normalF(layer->weightsF, seed, stream,
+				0.0, scale);
+	}
+
+	// Compressed layers draw double weights and compress them
+	weights = (layer->precision == MATRIX_DOUBLE) ? layer->weights
+		: MatrixOps.create(layer->outputSize, layer->inputSize);
+	if (weights == NULL) {
+		return -1;
+	}
+
+	err = (init == LAYER_INIT_XAVIER)
+		? RandomOps.matrix.uniform(weights, seed, stream, -scale, scale)
+		: RandomOps.matrix.normal(weights, seed, stream, 0.0, scale);
+
+	if (layer->precision != MATRIX_DOUBLE) {
+		err = err || ((layer->precision == MATRIX_INT8)
+			? QuantizedOps.into.quantize(layer->weightsQ, weights)
+			: HalfOps.into.fromMatrix(layer->weightsH, weights));
+		MatrixOps.destroy(&weights);
+	}
+
+	return err ? -1 : 0;
+}
+
+Matrix getWeights(Layer layer)
 {
 	if (layer == NULL) {
 		PRINT_ERR("NULL pointer exception!");
@@ -120,6 +239,87 @@ const Matrix getWeights(Layer layer)
 	return layer->weights;
 }
 
+MatrixF getWeightsF(Layer layer)
+{
+	if (layer == NULL) {
+		PRINT_ERR("NULL pointer exception!");
+		return NULL;
+	}
+
+	return layer->weightsF;
+}
+
+Quantized getWeightsQ(Layer layer)
+{
+	if (layer == NULL) {
+		PRINT_ERR("NULL pointer exception!");
+		return NULL;
+	}
+
+	return layer->weightsQ;
+}
+
+Half getWeightsH(Layer layer)
+{
+	if (layer == NULL) {
+		PRINT_ERR("NULL pointer exception!");
+		return NULL;
+	}
+
+	return layer->weightsH;
+}
+
+int quantize(Layer layer)
+{
+	return compress(layer, MATRIX_INT8);
+}
+
+int compress(Layer layer, MatrixPrecision precision)
+{
+	if (!isValid(layer)) {
+		PRINT_ERR("Invalid layer!");
+		return -1;
+	}
+
+	if (layer->precision != MATRIX_DOUBLE) {
+		PRINT_ERR("Only double precision layers can be compressed!");
+		return -1;
+	}
+
+	if (precision == MATRIX_INT8) {
+		layer->weightsQ = QuantizedOps.quantize(layer->weights);
+		if (layer->weightsQ == NULL) {
+			return -1;
+		}
+	}
+	else if (precision == MATRIX_FP16 || precision == MATRIX_BF16) {
+		layer->weightsH = HalfOps.fromMatrix(layer->weights,
+			(precision == MATRIX_BF16) ? HALF_BF16 : HALF_FP16);
+		if (layer->weightsH == NULL) {
+			return -1;
+		}
+	}
+	else {
+		PRINT_ERR("Invalid compressed precision!");
+		return -1;
+	}
+
+	MatrixOps.destroy(&layer->weights);
+	layer->precision = precision;
+
+	return 0;
+}
+
+MatrixPrecision getPrecision(Layer layer)
+{
+	if (layer == NULL) {
+		PRINT_ERR("NULL pointer exception!");
+		return MATRIX_DOUBLE;
+	}
+
+	return layer->precision;
+}
+
 double (*getActivationFunction(Layer layer))(double)
 {
 	if (layer == NULL) {
@@ -170,8 +370,14 @@ Matrix calculateActivationDeriv(Layer layer, const Matrix input)
 		PRINT_ERR("Invalid parameters!");
 		return NULL;
 	}
+
+	if (layer->precision != MATRIX_DOUBLE) {
+		PRINT_ERR("Float, int8, fp16 and bf16 layers are inference only!");
+		return NULL;
+	}
 	
 	activationDerivative = layer->activationDerivative;
+	activationFunction = layer->activationFunction;
 	outputSize = layer->outputSize;
 	weights = layer->weights;
 
@@ -227,13 +433,20 @@ int updateWeights(Layer layer, const Matrix gradient, double learningRate)
 		return -1;
 	}
 
-	if (MatrixOps.scalarMultiply(gradient, learningRate) == -1) {
+	if (layer->precision != MATRIX_DOUBLE) {
+		PRINT_ERR("Float, int8, fp16 and bf16 layers are inference only!");
+		return -1;
+	}
+
+	deltaWeights = MatrixOps.outOfPlace.scalarMultiply(gradient, learningRate);
+	if (deltaWeights == NULL) {
 		PRINT_ERR("Matrix operation failed!");
 		return -1;
 	}
 
 	if (MatrixOps.subtract(layer->weights, deltaWeights) == -1) {
 		PRINT_ERR("Matrix operation failed!");
+		MatrixOps.destroy(&deltaWeights);
 		return -1;
 	}
 
@@ -254,6 +467,19 @@ int setWeights(Layer layer, const Matrix weights)
 		return -1;
 	}
 
+	// Single precision layers keep a rounded copy
+	if (layer->precision == MATRIX_FLOAT) {
+		return MatrixFOps.into.convert(layer->weightsF, weights);
+	}
+
+	if (layer->precision == MATRIX_INT8) {
+		return QuantizedOps.into.quantize(layer->weightsQ, weights);
+	}
+
+	if (layer->precision == MATRIX_FP16 || layer->precision == MATRIX_BF16) {
+		return HalfOps.into.fromMatrix(layer->weightsH, weights);
+	}
+
 	return MatrixOps.replace(&layer->weights, weights);
 }
 
@@ -274,6 +500,43 @@ int isValid(Layer layer)
 		return 0;
 	}
 
+	if (layer->precision == MATRIX_FLOAT) {
+		if (!MatrixFOps.isValid(layer->weightsF)) {
+			PRINT_ERR("Invalid weights matrix!");
+			return 0;
+		}
+
+		if (MatrixFOps.getCol(layer->weightsF) != layer->inputSize ||
+			MatrixFOps.getRow(layer->weightsF) != layer->outputSize) {
+			PRINT_ERR("Matrix dimensions do not match!");
+			return 0;
+		}
+
+		return 1;
+	}
+
+	if (layer->precision == MATRIX_INT8) {
+		if (layer->weightsQ == NULL
+			|| QuantizedOps.getCol(layer->weightsQ) != layer->inputSize
+			|| QuantizedOps.getRow(layer->weightsQ) != layer->outputSize) {
+			PRINT_ERR("Invalid weights matrix!");
+			return 0;
+		}
+
+		return 1;
+	}
+
+	if (layer->precision == MATRIX_FP16 || layer->precision == MATRIX_BF16) {
+		if (layer->weightsH == NULL
+			|| HalfOps.getCol(layer->weightsH) != layer->inputSize
+			|| HalfOps.getRow(layer->weightsH) != layer->outputSize) {
+			PRINT_ERR("Invalid weights matrix!");
+			return 0;
+		}
+
+		return 1;
+	}
+
 	if (!MatrixOps.isValid(layer->weights)) {
 		PRINT_ERR("Invalid weights matrix!");
 		return 0;
@@ -300,8 +563,6 @@ int isValid(Layer layer)
  */
 int feedForward(Layer layer, const Matrix input, Matrix output)
 {
-	Matrix result;
-
 	if (layer == NULL || input == NULL || output == NULL) {
 		PRINT_ERR("NULL pointer exception!");
 		return -1;
@@ -312,23 +573,63 @@ int feedForward(Layer layer, const Matrix input, Matrix output)
 		return -1;
 	}
 
-	result = MatrixOps.multiply(layer->weights, input);
+	if (layer->precision == MATRIX_FLOAT) {
+		PRINT_ERR("Use feedForwardF for single precision layers!");
+		return -1;
+	}
+
+	// Quantized layers run the product in integers
+	if (layer->precision == MATRIX_INT8) {
+		if (QuantizedOps.into.multiply(output, layer->weightsQ, input) == -1) {
+			return -1;
+		}
+	}
+	// Half layers widen the weights in the kernels
+	else if (layer->precision == MATRIX_FP16
+		|| layer->precision == MATRIX_BF16) {
+		if (HalfOps.into.multiply(output, layer->weightsH, input) == -1) {
+			return -1;
+		}
+	}
+	// Write the product straight into output, no temporary
+	else if (MatrixOps.into.multiply(output, layer->weights, input) == -1) {
+		return -1;
+	}
+
+	if (MatrixOps.applyToAllUnary(output, layer->activationFunction) == -1) {
+		return -1;
+	}
+
+	return 0;
+}
+
+// Single precision feedForward. The activation function still takes a
+// double, each value is widened for the call and rounded back.
+int feedForwardF(Layer layer, const MatrixF input, MatrixF output)
+{
+	if (layer == NULL || input == NULL || output == NULL) {
+		PRINT_ERR("NULL pointer exception!");
+		return -1;
+	}
+
+	if (!isValid(layer)) {
+		PRINT_ERR("Invalid layer!");
+		return -1;
+	}
 
-	if (result == NULL) {
+	if (layer->precision != MATRIX_FLOAT) {
+		PRINT_ERR("Use feedForward for double, int8, fp16 and bf16 layers!");
 		return -1;
 	}
 
-	if (MatrixOps.applyToAllUnary(result, layer->activationFunction) == -1) {
-		MatrixOps.destroy(&result);
+	if (MatrixFOps.into.multiply(output, layer->weightsF, input) == -1) {
 		return -1;
 	}
 
-	if (MatrixOps.assignValues(output, result) == -1) {
-		MatrixOps.destroy(&result);
+	if (MatrixFOps.applyToAllUnary(output, layer->activationFunction) == -1) {
 		return -1;
 	}
 
-	MatrixOps.destroy(&result);
 	return 0;
 }
 
@@ -337,12 +638,9 @@ int feedForward(Layer layer, const Matrix input, Matrix output)
 Matrix jacobian(Layer layer, const Matrix input)
 {
 	int err = 0;
-	double activationDeriv, w, deriv;
+	double activationDeriv, w;
 	size_t i, j, outputSize, inputSize;
-	Matrix jacobian, const weights, activationDerivMatrix;
-	double (*activationFunction)(double);
-	double (*activationDerivative)(double);
-	const double h = 1e-6;
+	Matrix jacobian, weights, activationDerivMatrix;
 
 	if (layer == NULL || input == NULL) {
 		PRINT_ERR("NULL pointer exception!");
@@ -357,10 +655,12 @@ Matrix jacobian(Layer layer, const Matrix input)
 	outputSize = layer->outputSize;
 	inputSize = layer->inputSize;
 	weights = layer->weights;
-	activationFunction = layer->activationFunction;
-	activationDerivative = layer->activationDerivative;
 
-	activationDerivMatrix = activationDerivativeToWeights(layer, input);
+	// The derivative of the activation at W * input, one per output
+	activationDerivMatrix = calculateActivationDeriv(layer, input);
+	if (activationDerivMatrix == NULL) {
+		return NULL;
+	}
 
 	// Create the jacobian matrix
 	jacobian = MatrixOps.create(outputSize, inputSize);
@@ -392,5 +692,6 @@ Matrix jacobian(Layer layer, const Matrix input)
 		return NULL;
 	}
 
+	MatrixOps.destroy(&activationDerivMatrix);
 	return jacobian;
 }
@@ -1,5 +1,9 @@
 #include "../include/neural_network.h"
 #include "../include/matrix.h"
+#include "../include/arena.h"
+#include "../include/expression.h"
+#include "../include/reduce.h"
+#include "../include/activation.h"
 #include "../lib/macro_error.h"
 #include "../include/layer.h"
 #include "../include/dataset.h"
@@ -19,7 +23,9 @@ typedef struct NeuralNetworkStruct {
 	double (*activationDerivative)(double);
 	double (*errorFunction)(double, double);
 	double (*errorDerivative)(double, double);
+	MatrixPrecision precision;
 	Layer* layers;
+	Arena scratch;	// Temporaries of a training step, reset after each datapoint
 } NeuralNetworkStruct;
 
 typedef struct NeuralNetworkLayerStruct {
@@ -37,12 +43,20 @@ NeuralNetwork create(size_t inputSize, size_t outputSize,
 	double (*activationDerivative)(double),
 	double (*errorFunction)(double, double),
 	double (*errorDerivative)(double, double));
+NeuralNetwork createWithPrecision(size_t inputSize, size_t outputSize,
+	NeuralNetworkLayer* hiddenLayers, size_t hiddenLayerCount,
+	double (*activationFunction)(double),
+	double (*activationDerivative)(double),
+	double (*errorFunction)(double, double),
+	double (*errorDerivative)(double, double), MatrixPrecision precision);
 void destroy(NeuralNetwork* nnAddr);
 NeuralNetworkLayer layerOf(size_t inputSize, size_t outputSize,
 	double (*activationFunction)(double),
 	double (*activationDerivative)(double));
 int feedForward(NeuralNetwork nn, const double* input, double* output);
+int feedForwardF(NeuralNetwork nn, const float* input, float* output);
 double softmax(double x);
+int softmaxInto(Matrix dst, const Matrix input);
 Matrix softmaxJacobian(const Matrix exps);
 double defaultErrorFunction(double predicted, double target);
 double defaultErrorDerivative(double predicted, double target);
@@ -59,9 +73,11 @@ int isValid(NeuralNetwork nn);
 
 const struct NeuralNetworkInterface NeuralNetworkOps = {
 	.create = create,
+	.createWithPrecision = createWithPrecision,
 	.destroy = destroy,
 	.layerOf = layerOf,
 	.feedForward = feedForward,
+	.feedForwardF = feedForwardF,
 	.softmax = softmax
 };
 
@@ -73,6 +89,18 @@ NeuralNetwork create(size_t inputSize, size_t outputSize,
 	double (*activationDerivative)(double),
 	double (*errorFunction)(double, double),
 	double (*errorDerivative)(double, double))
+{
+	return createWithPrecision(inputSize, outputSize, hiddenLayers,
+		hiddenLayerCount, activationFunction, activationDerivative,
+		errorFunction, errorDerivative, MATRIX_DOUBLE);
+}
+
+NeuralNetwork createWithPrecision(size_t inputSize, size_t outputSize,
+	NeuralNetworkLayer *hiddenLayers, size_t hiddenLayerCount,
+	double (*activationFunction)(double),
+	double (*activationDerivative)(double),
+	double (*errorFunction)(double, double),
+	double (*errorDerivative)(double, double), MatrixPrecision precision)
 {
 	NeuralNetwork nn;
 	size_t i, j;
@@ -105,6 +133,15 @@ NeuralNetwork create(size_t inputSize, size_t outputSize,
 		return NULL;
 	}
 
+	// Scratch memory for training, blocks are only allocated on first use
+	nn->scratch = ArenaOps.create(0);
+	if (nn->scratch == NULL) {
+		free(layers);
+		free(nn);
+		for (i = 0; i < hiddenLayerCount; i++) free(hiddenLayers[i]);
+		return NULL;
+	}
+
 	// Set default error functions if not provided
 	if (errorFunction == NULL) {
 		errorFunction = defaultErrorFunction;
@@ -119,6 +156,7 @@ NeuralNetwork create(size_t inputSize, size_t outputSize,
 	nn->activationDerivative = activationDerivative;
 	nn->errorFunction = errorFunction;
 	nn->errorDerivative = errorDerivative;
+	nn->precision = precision;
 	nn->layers = layers;
 
 	// Create layers
@@ -126,10 +164,11 @@ NeuralNetwork create(size_t inputSize, size_t outputSize,
 	// First layer
 	// If there are no hidden layers, create a single layer
 	if (hiddenLayerCount == 0) {
-		layer = LayerOps.create(inputSize, outputSize,
-			activationFunction, activationDerivative);
+		layer = LayerOps.createWithPrecision(inputSize, outputSize,
+			activationFunction, activationDerivative, precision);
 		if (layer == NULL) {
 			free(layers);
+			ArenaOps.destroy(&nn->scratch);
 			free(nn);
 			for (i = 0; i < hiddenLayerCount; i++) free(hiddenLayers[i]);
 			return NULL;
@@ -140,11 +179,12 @@ NeuralNetwork create(size_t inputSize, size_t outputSize,
 	}
 
 	// Hidden layers
-	layer = LayerOps.create(inputSize,
+	layer = LayerOps.createWithPrecision(inputSize,
 		(hiddenLayerCount == 0) ? outputSize : hiddenLayers[0]->outputSize,
-		activationFunction, activationDerivative);
+		activationFunction, activationDerivative, precision);
 	if (layer == NULL) {
 		free(layers);
+		ArenaOps.destroy(&nn->scratch);
 		free(nn);
 		for (i = 0; i < hiddenLayerCount; i++) free(hiddenLayers[i]);
 		return NULL;
@@ -159,14 +199,15 @@ NeuralNetwork create(size_t inputSize, size_t outputSize,
 	// Other hidden layers
 
 	for (i = 1; i < hiddenLayerCount; i++) {
-		layer = LayerOps.create(hiddenLayers[i - 1]->outputSize,
-			hiddenLayers[i]->outputSize, activationFunction,
-			activationDerivative);
+		layer = LayerOps.createWithPrecision(
+			hiddenLayers[i - 1]->outputSize, hiddenLayers[i]->outputSize,
+			activationFunction, activationDerivative, precision);
 		if (layer == NULL) {
 			// Destroy all previous layers
 			for (j = 0; j < i; j++) LayerOps.destroy(&layers[i]);
 			for (j = i; j < hiddenLayerCount; j++) free(hiddenLayers[i]);
 			free(layers);
+			ArenaOps.destroy(&nn->scratch);
 			free(nn);
 			return NULL;
 		}
@@ -184,14 +225,15 @@ NeuralNetwork create(size_t inputSize, size_t outputSize,
 		activationDerivative = identityDerivative;
 	}
 
-	layer = LayerOps.create(
+	layer = LayerOps.createWithPrecision(
 		hiddenLayers[hiddenLayerCount - 1]->outputSize, outputSize,
-		activationFunction, activationDerivative);
+		activationFunction, activationDerivative, precision);
 	free(hiddenLayers[hiddenLayerCount - 1]);
 	if (layer == NULL) {
 		// Destroy all layers
 		for (i = 0; i < hiddenLayerCount; i++) LayerOps.destroy(&layers[i]);
 		free(layers);
+		ArenaOps.destroy(&nn->scratch);
 		free(nn);
 		return NULL;
 	}
@@ -215,6 +257,7 @@ void destroy(NeuralNetwork* nnAddr)
 			LayerOps.destroy(&nn->layers[i]);
 		}
 		free(nn->layers);
+		ArenaOps.destroy(&nn->scratch);
 		free(nn);
 	}
 
@@ -244,7 +287,6 @@ NeuralNetworkLayer layerOf(size_t inputSize, size_t outputSize,
 int feedForward(NeuralNetwork nn, const double* input, double* output)
 {
 	size_t i, outputSize;
-	double sum;
 	Matrix inputMatrix, outputMatrix;
 
 	if (nn == NULL || input == NULL || output == NULL) {
@@ -252,6 +294,11 @@ int feedForward(NeuralNetwork nn, const double* input, double* output)
 		return -1;
 	}
 
+	if (nn->precision == MATRIX_FLOAT) {
+		PRINT_ERR("Use feedForwardF for single precision networks!");
+		return -1;
+	}
+
 	// Create input matrix
 	inputMatrix = MatrixOps.create(nn->inputSize, 1);
 	if (inputMatrix == NULL) {
@@ -294,33 +341,89 @@ int feedForward(NeuralNetwork nn, const double* input, double* output)
 
 	// Apply softmax if the output layer uses softmax
 	if (nn->activationFunction == softmax) {
-		if (MatrixOps.applyToAllUnary(outputMatrix, softmax) == -1) {
+		if (softmaxInto(outputMatrix, outputMatrix) == -1) {
 			MatrixOps.destroy(&outputMatrix);
 			return -1;
 		}
+	}
 
-		if (MatrixOps.sum(outputMatrix, &sum) == -1) {
+	// Copy output to output array
+	for (i = 0; i < nn->outputSize; i++) {
+		if (MatrixOps.get(outputMatrix, i, 0, &output[i]) == -1) {
 			MatrixOps.destroy(&outputMatrix);
 			return -1;
 		}
+	}
 
-		if (MatrixOps.applyToAllBinary(outputMatrix, MatrixOps.fBinary.mul,
-			1.0 / sum) == -1)
+	MatrixOps.destroy(&outputMatrix);
+	return 0;
+}
+
+// Single precision inference, mirrors feedForward with MatrixFOps
+int feedForwardF(NeuralNetwork nn, const float* input, float* output)
+{
+	size_t i;
+	Matrix scores;
+	MatrixF inputMatrix, outputMatrix = NULL;
+
+	if (nn == NULL || input == NULL || output == NULL) {
+		PRINT_ERR("NULL pointer exception!");
+		return -1;
+	}
+
+	if (nn->precision != MATRIX_FLOAT) {
+		PRINT_ERR("Use feedForward for double, int8, fp16 and bf16 networks!");
+		return -1;
+	}
+
+	inputMatrix = MatrixFOps.create(nn->inputSize, 1);
+	if (inputMatrix == NULL) {
+		return -1;
+	}
+
+	for (i = 0; i < nn->inputSize; i++) {
+		MatrixFOps.set(inputMatrix, i, 0, input[i]);
+	}
+
+	for (i = 0; i < nn->hiddenLayerCount + 1; i++) {
+		outputMatrix = MatrixFOps.create(
+			LayerOps.getOutputSize(nn->layers[i]), 1);
+		if (outputMatrix == NULL) {
+			MatrixFOps.destroy(&inputMatrix);
+			return -1;
+		}
+
+		if (LayerOps.feedForwardF(nn->layers[i], inputMatrix,
+			outputMatrix) == -1)
 		{
-			MatrixOps.destroy(&outputMatrix);
+			MatrixFOps.destroy(&inputMatrix);
+			MatrixFOps.destroy(&outputMatrix);
 			return -1;
 		}
+
+		MatrixFOps.destroy(&inputMatrix);
+		inputMatrix = outputMatrix;
 	}
 
-	// Copy output to output array
-	for (i = 0; i < nn->outputSize; i++) {
-		if (MatrixOps.get(outputMatrix, i, 0, &output[i]) == -1) {
-			MatrixOps.destroy(&outputMatrix);
+	// The softmax of feedForward, on the scores widened to double
+	if (nn->activationFunction == softmax) {
+		scores = MatrixOps.convert(outputMatrix);
+		if (scores == NULL || softmaxInto(scores, scores) == -1
+			|| MatrixFOps.into.convert(outputMatrix, scores) == -1)
+		{
+			MatrixOps.destroy(&scores);
+			MatrixFOps.destroy(&outputMatrix);
 			return -1;
 		}
+
+		MatrixOps.destroy(&scores);
 	}
 
-	MatrixOps.destroy(&outputMatrix);
+	for (i = 0; i < nn->outputSize; i++) {
+		MatrixFOps.get(outputMatrix, i, 0, &output[i]);
+	}
+
+	MatrixFOps.destroy(&outputMatrix);
 	return 0;
 }
 
@@ -329,11 +432,38 @@ double softmax(double x)
     return exp(x);
 }
 
+// Shifts by the maximum, exponentiates and normalizes in two fused passes
+// after the one finding the maximum, dst may be the input
+int softmaxInto(Matrix dst, const Matrix input)
+{
+	Expression expr;
+	double max;
+	int err;
+
+	// exp of the largest input is then 1, it can't overflow
+	if (ReduceOps.matrix.max(input, &max) == -1) {
+		return -1;
+	}
+
+	expr = ExpressionOps.create(input);
+	if (expr == NULL) {
+		return -1;
+	}
+
+	err = ExpressionOps.binary(expr, MatrixOps.fBinary.add, -max)
+		|| ExpressionOps.unary(expr, ActivationOps.f.exp)
+		|| ExpressionOps.normalize(expr)
+		|| ExpressionOps.evaluate(expr, dst);
+
+	ExpressionOps.destroy(&expr);
+	return err ? -1 : 0;
+}
+
 Matrix softmaxJacobian(const Matrix exps)
 {
 	size_t i, n;
 	double value, exp;
-    Matrix expsT, result;
+    Matrix result;
 
 	// Validation
 	if (exps == NULL) {
@@ -346,28 +476,20 @@ Matrix softmaxJacobian(const Matrix exps)
 		return NULL;
 	}
 
-	// Transpose the vector
-	expsT = MatrixOps.transpose(exps);
-	if (expsT == NULL) {
-		PRINT_ERR("Matrix transpose failed!");
+	// Create the jacobian matrix by multiplying the vector by its transpose,
+	// the transpose is read in place by the kernel
+	result = MatrixOps.multiplyTransposed(exps, 0, exps, 1);
+	if (result == NULL) {
+		PRINT_ERR("Matrix multiplication failed!");
 		return NULL;
 	}
 
-	// Multiply the vector by -1
-	if (MatrixOps.scalarMultiply(expsT, -1) == -1) {
+	// Multiply the outer product by -1
+	if (MatrixOps.scalarMultiply(result, -1) == -1) {
 		PRINT_ERR("Matrix scalar multiplication failed!");
-		MatrixOps.destroy(&expsT);
-		return NULL;
-	}
-
-	// Create the jacobian matrix by multiplying the vector by its transpose
-	result = MatrixOps.multiply(exps, expsT);
-	if (result == NULL) {
-		PRINT_ERR("Matrix multiplication failed!");
-		MatrixOps.destroy(&expsT);
+		MatrixOps.destroy(&result);
 		return NULL;
 	}
-	MatrixOps.destroy(&expsT);
 
 	// Add exponentials to the diagonal
 	n = MatrixOps.getRow(exps);
@@ -487,13 +609,15 @@ int gradientDescentStep(NeuralNetwork nn, const Dataset dataset,
 	double learningRate)
 {
 	int err = 0, isSoftmax = 0;
-    size_t i, j, k, layerCount, inputSize, outputSize, dataSize;
-	double targetValue, predictedValue, deriv, inputValue;
+    size_t i, layerCount, dataSize;
+	double targetValue, predictedValue;
 	Node node;
-	Matrix input, * gradients, gradient, * outputs, jacobian, tmpMtr,
+	Matrix input, * gradients, * outputs, jacobian, tmpMtr,
 		errorDerivative, currentDeriv, weights;
 	Layer layer, * layers;
 	Datapoint datapoint_buf;
+	Arena previousArena;
+	ArenaMark stepStart;
 
 	// Validate parameters
 	if (nn == NULL || dataset == NULL) {
@@ -540,6 +664,13 @@ int gradientDescentStep(NeuralNetwork nn, const Dataset dataset,
 	for (i = 0; i < layerCount; i++) outputs[i] = NULL;
 	if (isSoftmax) outputs[layerCount] = NULL;
 
+	// Gradients are accumulated over the whole dataset, so they live on the heap
+	for (i = 0; i < layerCount && !err; i++) {
+		gradients[i] = MatrixOps.create(LayerOps.getOutputSize(layers[i]),
+			LayerOps.getInputSize(layers[i]));
+		err = (gradients[i] == NULL || MatrixOps.fill(gradients[i], 0) == -1);
+	}
+
 	// Initialize output matrices
 	for (i = 0; i < layerCount && !err; i++) {
 		outputs[i] = MatrixOps.create(LayerOps.getOutputSize(layers[i]), 1);
@@ -554,6 +685,11 @@ int gradientDescentStep(NeuralNetwork nn, const Dataset dataset,
 		}
 	}
 
+	// Every temporary of a datapoint comes from the scratch arena and is
+	// dropped at once when the datapoint is done
+	previousArena = ArenaOps.use(nn->scratch);
+	stepStart = ArenaOps.mark(nn->scratch);
+
 	// For each datapoint in the dataset
 	dataSize = 0;
 	if (!err) do {
@@ -579,9 +715,6 @@ int gradientDescentStep(NeuralNetwork nn, const Dataset dataset,
                 err = -1;
                 break;
             }
-			outputSize = LayerOps.getOutputSize(layer);
-			inputSize = LayerOps.getInputSize(layer);
-			
 			input = (i == 0) ? DatapointOps.getInput(datapoint_buf)
 				: outputs[i - 1];
 			
@@ -592,25 +725,10 @@ int gradientDescentStep(NeuralNetwork nn, const Dataset dataset,
 				errorDerivative, tmpMtr)) == NULL;
 			MatrixOps.destroy(&tmpMtr);
 			
-			err = err || (gradient = MatrixOps.create(
-				outputSize, inputSize)) == NULL;
-
-			// Set the gradient values
-			for (j = 0; j < outputSize; j++) {
-				for (k = 0; k < inputSize; k++) {
-					err = err || MatrixOps.get(currentDeriv, j, k, &deriv);
-					err = err || MatrixOps.get(input, k, 0, &inputValue);
-					err = err || MatrixOps.set(gradient, j, k, deriv * inputValue);
-				}
-			}
-
-			if (gradients[i] == NULL) {
-				gradients[i] = gradient;
-			}
-			else {
-				err = err || MatrixOps.add(gradients[i], gradient);
-				MatrixOps.destroy(&gradient);
-			}
+			// Accumulate the outer product of the derivative and the input,
+			// the gradient with respect to the weights
+			err = err || MatrixOps.rankOneUpdate(gradients[i], 1.0,
+				currentDeriv, input);
 
 			// Get jacobian of output layer with respect to the
 			// input of current layer to apply the chain rule
@@ -626,9 +744,14 @@ int gradientDescentStep(NeuralNetwork nn, const Dataset dataset,
 
 		// Update data size
 		dataSize++;
+
+		ArenaOps.reset(nn->scratch, stepStart);
 	}
 	while(NodeOps.next(node) && err == 0);
 
+	ArenaOps.reset(nn->scratch, stepStart);
+	ArenaOps.use(previousArena);
+
 	// Average the gradients
 	for (i = 0; i < layerCount && !err; i++) {
 		err = err || MatrixOps.scalarMultiply(gradients[i], 1.0 / dataSize);
@@ -669,7 +792,6 @@ int gradientDescentStep(NeuralNetwork nn, const Dataset dataset,
  */
 int feedForward(NeuralNetwork nn, Matrix input, Matrix* outputs) {
 	size_t i, outputSize, layerCount;
-	double sum;
 	Layer layer;
 	Matrix layerInput;
 
@@ -704,22 +826,10 @@ int feedForward(NeuralNetwork nn, Matrix input, Matrix* outputs) {
 
 	// Apply softmax if the output layer uses softmax
 	if (nn->activationFunction == softmax) {
-		outputs[layerCount] = MatrixOps.outOfPlace
-			.applyToAllUnary(outputs[layerCount - 1], softmax);
-		if (outputs[layerCount] == NULL) {
+		if (softmaxInto(outputs[layerCount], outputs[layerCount - 1]) == -1) {
 			PRINT_ERR("Softmax failed!");
 			return -1;
 		}
-
-		if (MatrixOps.sum(outputs[layerCount], &sum) == -1) {
-			PRINT_ERR("Matrix sum failed!");
-			return -1;
-		}
-
-		if (MatrixOps.scalarMultiply(outputs[layerCount], 1.0 / sum) == -1) {
-			PRINT_ERR("Matrix scalar multiplication failed!");
-			return -1;
-		}
 	}
 
 	return 0;
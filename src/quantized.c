@@ -0,0 +1,746 @@
+#include "../include/quantized.h"
+#include "../include/simd.h"
+#include "../include/thread_pool.h"
+#include "../lib/macro_error.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#include <cpuid.h>
+#define QUANTIZED_X86 1
+#endif
+
+//* STRUCT DEFINITION *********************************************************
+
+typedef struct QuantizedStruct {
+	size_t row;
+	size_t col;
+	size_t ld;			// Multiple of QUANTIZED_ALIGN, padding is 0
+	int8_t* data;
+	double* scale;		// Per row
+	int32_t* zeroPoint;	// Per row, in [-127, 127]
+	int32_t* sum;		// Per row, sum of the stored elements
+} QuantizedStruct;
+
+// An integer product split over the thread pool, along rows of C when
+// byRows is set, along columns otherwise.
+typedef struct QuantizedTask {
+	size_t m;
+	size_t n;
+	size_t k;
+	const int8_t* a;
+	size_t lda;
+	const int8_t* b;
+	size_t ldb;
+	int32_t* c;
+	size_t ldc;
+	int byRows;
+	size_t parts;
+} QuantizedTask;
+
+// Dot products of x with four rows
+typedef void (*DotKernel)(size_t k, const int8_t* x,
+	const int8_t* const rows[4], int32_t out[4]);
+
+// Row length of the stored elements is a multiple of this
+#define QUANTIZED_ALIGN 32
+
+// Rows or columns of C computed together by a kernel
+#define QUANTIZED_TILE 4
+
+// Largest magnitude of a stored element
+#define QUANTIZED_MAX 127
+
+static int hasVnni = 0;
+
+//* FUNCTION PROTOTYPES *******************************************************
+
+static Quantized create(size_t row, size_t col);
+static Quantized quantize(const Matrix matrix);
+static Matrix dequantize(const Quantized quantized);
+static void destroy(Quantized* quantizedAddr);
+static int get(const Quantized quantized, size_t row, size_t col,
+	double* value);
+static size_t getRow(const Quantized quantized);
+static size_t getCol(const Quantized quantized);
+static const int8_t* getData(const Quantized quantized);
+static size_t getLd(const Quantized quantized);
+static double getScale(const Quantized quantized, size_t row);
+static int getZeroPoint(const Quantized quantized, size_t row);
+static int gemm(size_t m, size_t n, size_t k, const int8_t* a, size_t lda,
+	const int8_t* b, size_t ldb, int32_t* c, size_t ldc);
+static Matrix multiply(const Quantized quantized, const Matrix matrix);
+static int quantizeInto(Quantized dst, const Matrix matrix);
+static int dequantizeInto(Matrix dst, const Quantized quantized);
+static int multiplyInto(Matrix dst, const Quantized quantized,
+	const Matrix matrix);
+static int isValid(const Quantized quantized);
+static int quantizeRow(const double* x, size_t stride, size_t n, int8_t* q,
+	double* scale, int32_t* zeroPoint, int32_t* sum);
+static int gemmTask(void* arg, size_t index);
+static void block(DotKernel dot, size_t m, size_t n, size_t k,
+	const int8_t* a, size_t lda, const int8_t* b, size_t ldb, int32_t* c,
+	size_t ldc);
+static DotKernel selectDot(void);
+static void dotGeneric(size_t k, const int8_t* x, const int8_t* const rows[4],
+	int32_t out[4]);
+static void init(void) __attribute__((constructor));
+
+//* INTERFACE INITIALIZATION **************************************************
+
+const struct QuantizedInterface QuantizedOps = {
+	.create = create,
+	.quantize = quantize,
+	.dequantize = dequantize,
+	.destroy = destroy,
+	.get = get,
+	.getRow = getRow,
+	.getCol = getCol,
+	.getData = getData,
+	.getLd = getLd,
+	.getScale = getScale,
+	.getZeroPoint = getZeroPoint,
+	.gemm = gemm,
+	.multiply = multiply,
+	.into = {
+		.quantize = quantizeInto,
+		.dequantize = dequantizeInto,
+		.multiply = multiplyInto
+	}
+};
+
+//* FUNCTION DEFINITIONS ******************************************************
+
+static Quantized create(size_t row, size_t col)
+{
+	Quantized quantized;
+	size_t i;
+
+	if (row == 0 || col == 0) {
+		PRINT_ERR("Invalid matrix dimensions!");
+		return NULL;
+	}
+
+	quantized = (Quantized)malloc(sizeof(QuantizedStruct));
+	if (quantized == NULL) {
+		MAL_ERR();
+		return NULL;
+	}
+
+	quantized->row = row;
+	quantized->col = col;
+	quantized->ld = (col + QUANTIZED_ALIGN - 1) / QUANTIZED_ALIGN
+		* QUANTIZED_ALIGN;
+	quantized->data = (int8_t*)calloc(row * quantized->ld, sizeof(int8_t));
+	quantized->scale = (double*)malloc(row * sizeof(double));
+	quantized->zeroPoint = (int32_t*)calloc(row, sizeof(int32_t));
+	quantized->sum = (int32_t*)calloc(row, sizeof(int32_t));
+
+	if (quantized->data == NULL || quantized->scale == NULL
+		|| quantized->zeroPoint == NULL || quantized->sum == NULL)
+	{
+		MAL_ERR();
+		destroy(&quantized);
+		return NULL;
+	}
+
+	for (i = 0; i < row; i++) {
+		quantized->scale[i] = 1.0;
+	}
+
+	return quantized;
+}
+
+static Quantized quantize(const Matrix matrix)
+{
+	Quantized quantized;
+
+	if (!MatrixOps.isValid(matrix)) {
+		PRINT_ERR("Invalid matrix!");
+		return NULL;
+	}
+
+	quantized = create(MatrixOps.getRow(matrix), MatrixOps.getCol(matrix));
+	if (quantized == NULL) {
+		return NULL;
+	}
+
+	if (quantizeInto(quantized, matrix) == -1) {
+		destroy(&quantized);
+		return NULL;
+	}
+
+	return quantized;
+}
+
+static Matrix dequantize(const Quantized quantized)
+{
+	Matrix matrix;
+
+	if (!isValid(quantized)) {
+		PRINT_ERR("Invalid quantized matrix!");
+		return NULL;
+	}
+
+	matrix = MatrixOps.create(quantized->row, quantized->col);
+	if (matrix == NULL) {
+		return NULL;
+	}
+
+	if (dequantizeInto(matrix, quantized) == -1) {
+		MatrixOps.destroy(&matrix);
+		return NULL;
+	}
+
+	return matrix;
+}
+
+static void destroy(Quantized* quantizedAddr)
+{
+	Quantized quantized;
+
+	if (quantizedAddr == NULL) {
+		return;
+	}
+
+	quantized = *quantizedAddr;
+	if (quantized) {
+		free(quantized->data);
+		free(quantized->scale);
+		free(quantized->zeroPoint);
+		free(quantized->sum);
+		free(quantized);
+	}
+
+	*quantizedAddr = NULL;
+}
+
+static int get(const Quantized quantized, size_t row, size_t col,
+	double* value)
+{
+	if (!isValid(quantized) || value == NULL) {
+		PRINT_ERR("NULL pointer exception!");
+		return -1;
+	}
+
+	if (row >= quantized->row || col >= quantized->col) {
+		PRINT_ERR("Index out of bounds!");
+		return -1;
+	}
+
+	*value = quantized->scale[row] * (quantized->data[row * quantized->ld
+		+ col] - quantized->zeroPoint[row]);
+
+	return 0;
+}
+
+static size_t getRow(const Quantized quantized)
+{
+	if (!isValid(quantized)) {
+		PRINT_ERR("Invalid quantized matrix!");
+		return 0;
+	}
+
+	return quantized->row;
+}
+
+static size_t getCol(const Quantized quantized)
+{
+	if (!isValid(quantized)) {
+		PRINT_ERR("Invalid quantized matrix!");
+		return 0;
+	}
+
+	return quantized->col;
+}
+
+static const int8_t* getData(const Quantized quantized)
+{
+	if (!isValid(quantized)) {
+		PRINT_ERR("Invalid quantized matrix!");
+		return NULL;
+	}
+
+	return quantized->data;
+}
+
+static size_t getLd(const Quantized quantized)
+{
+	if (!isValid(quantized)) {
+		PRINT_ERR("Invalid quantized matrix!");
+		return 0;
+	}
+
+	return quantized->ld;
+}
+
+static double getScale(const Quantized quantized, size_t row)
+{
+	if (!isValid(quantized) || row >= quantized->row) {
+		PRINT_ERR("Invalid parameters!");
+		return 0;
+	}
+
+	return quantized->scale[row];
+}
+
+static int getZeroPoint(const Quantized quantized, size_t row)
+{
+	if (!isValid(quantized) || row >= quantized->row) {
+		PRINT_ERR("Invalid parameters!");
+		return 0;
+	}
+
+	return quantized->zeroPoint[row];
+}
+
+static int gemm(size_t m, size_t n, size_t k, const int8_t* a, size_t lda,
+	const int8_t* b, size_t ldb, int32_t* c, size_t ldc)
+{
+	QuantizedTask task = {m, n, k, a, lda, b, ldb, c, ldc, 1, 1};
+	size_t units, threads;
+
+	if (a == NULL || b == NULL || c == NULL) {
+		PRINT_ERR("NULL pointer exception!");
+		return -1;
+	}
+
+	if (lda < k || ldb < k || ldc < n) {
+		PRINT_ERR("Invalid leading dimension!");
+		return -1;
+	}
+
+	if (m == 0 || n == 0) {
+		return 0;
+	}
+
+	// Split the longer side of C, in whole tiles
+	task.byRows = (m >= n);
+	units = ((task.byRows ? m : n) + QUANTIZED_TILE - 1) / QUANTIZED_TILE;
+	if ((double)m * n * k >= QUANTIZED_PARALLEL_THRESHOLD) {
+		threads = ThreadPoolOps.threadCount();
+		task.parts = (threads < units) ? threads : units;
+	}
+
+	return ThreadPoolOps.run(gemmTask, &task, task.parts);
+}
+
+static Matrix multiply(const Quantized quantized, const Matrix matrix)
+{
+	Matrix result;
+
+	if (!isValid(quantized) || !MatrixOps.isValid(matrix)) {
+		PRINT_ERR("Invalid matrix!");
+		return NULL;
+	}
+
+	result = MatrixOps.create(quantized->row, MatrixOps.getCol(matrix));
+	if (result == NULL) {
+		return NULL;
+	}
+
+	if (multiplyInto(result, quantized, matrix) == -1) {
+		MatrixOps.destroy(&result);
+		return NULL;
+	}
+
+	return result;
+}
+
+static int quantizeInto(Quantized dst, const Matrix matrix)
+{
+	size_t i, ld;
+	const double* data;
+
+	if (!isValid(dst) || !MatrixOps.isValid(matrix)) {
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	if (MatrixOps.getRow(matrix) != dst->row
+		|| MatrixOps.getCol(matrix) != dst->col)
+	{
+		PRINT_ERR("Matrix dimensions do not match!");
+		return -1;
+	}
+
+	data = MatrixOps.getDataConst(matrix);
+	ld = MatrixOps.getLd(matrix);
+	for (i = 0; i < dst->row; i++) {
+		if (quantizeRow(data + i * ld, 1, dst->col, dst->data + i * dst->ld,
+			dst->scale + i, dst->zeroPoint + i, dst->sum + i) == -1)
+		{
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int dequantizeInto(Matrix dst, const Quantized quantized)
+{
+	size_t i, j, ld;
+	const int8_t* q;
+	double* data;
+
+	if (!isValid(quantized) || !MatrixOps.isValid(dst)) {
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	if (MatrixOps.getRow(dst) != quantized->row
+		|| MatrixOps.getCol(dst) != quantized->col)
+	{
+		PRINT_ERR("Matrix dimensions do not match!");
+		return -1;
+	}
+
+	data = MatrixOps.getData(dst);
+	if (data == NULL) {
+		return -1;
+	}
+
+	ld = MatrixOps.getLd(dst);
+	for (i = 0; i < quantized->row; i++) {
+		q = quantized->data + i * quantized->ld;
+		for (j = 0; j < quantized->col; j++) {
+			data[i * ld + j] = quantized->scale[i]
+				* (q[j] - quantized->zeroPoint[i]);
+		}
+	}
+
+	return 0;
+}
+
+// With A = sa * (qa - za) per row and B^T = sb * (qb - zb) per row,
+// (A * B)[i][j] = sa[i] * sb[j] * (qa[i] . qb[j] - za[i] * sum(qb[j])
+// - zb[j] * sum(qa[i]) + k * za[i] * zb[j]).
+static int multiplyInto(Matrix dst, const Quantized quantized,
+	const Matrix matrix)
+{
+	size_t i, j, k, n, ldm, ldd, ldt;
+	const double* data;
+	double* out;
+	int8_t* transposed;
+	double* scale;
+	int32_t* zeroPoint, * sum, * product;
+	int64_t value;
+	int err = 0;
+
+	if (!isValid(quantized) || !MatrixOps.isValid(matrix)
+		|| !MatrixOps.isValid(dst))
+	{
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	k = quantized->col;
+	n = MatrixOps.getCol(matrix);
+	if (MatrixOps.getRow(matrix) != k || MatrixOps.getRow(dst) != quantized->row
+		|| MatrixOps.getCol(dst) != n)
+	{
+		PRINT_ERR("Matrix dimensions do not match!");
+		return -1;
+	}
+
+	// The columns of matrix, quantized as the rows of its transpose
+	ldt = quantized->ld;
+	transposed = (int8_t*)calloc(n * ldt, sizeof(int8_t));
+	scale = (double*)malloc(n * sizeof(double));
+	zeroPoint = (int32_t*)malloc(n * sizeof(int32_t));
+	sum = (int32_t*)malloc(n * sizeof(int32_t));
+	product = (int32_t*)malloc(quantized->row * n * sizeof(int32_t));
+	if (transposed == NULL || scale == NULL || zeroPoint == NULL
+		|| sum == NULL || product == NULL)
+	{
+		MAL_ERR();
+		err = -1;
+		goto cleanup;
+	}
+
+	data = MatrixOps.getDataConst(matrix);
+	ldm = MatrixOps.getLd(matrix);
+	for (j = 0; j < n && !err; j++) {
+		err = quantizeRow(data + j, ldm, k, transposed + j * ldt, scale + j,
+			zeroPoint + j, sum + j);
+	}
+
+	err = err || gemm(quantized->row, n, k, quantized->data, quantized->ld,
+		transposed, ldt, product, n);
+	if (err) {
+		err = -1;
+		goto cleanup;
+	}
+
+	out = MatrixOps.getData(dst);
+	if (out == NULL) {
+		err = -1;
+		goto cleanup;
+	}
+
+	ldd = MatrixOps.getLd(dst);
+	for (i = 0; i < quantized->row; i++) {
+		for (j = 0; j < n; j++) {
+			value = (int64_t)product[i * n + j]
+				- (int64_t)quantized->zeroPoint[i] * sum[j]
+				- (int64_t)zeroPoint[j] * quantized->sum[i]
+				+ (int64_t)k * quantized->zeroPoint[i] * zeroPoint[j];
+			out[i * ldd + j] = quantized->scale[i] * scale[j] * (double)value;
+		}
+	}
+
+cleanup:
+	free(transposed);
+	free(scale);
+	free(zeroPoint);
+	free(sum);
+	free(product);
+
+	return err;
+}
+
+static int isValid(const Quantized quantized)
+{
+	return quantized != NULL && quantized->data != NULL
+		&& quantized->scale != NULL && quantized->zeroPoint != NULL
+		&& quantized->sum != NULL;
+}
+
+// Quantizes n elements stride apart. The range is widened to include 0 and
+// split in 2 * QUANTIZED_MAX steps, zero point being the image of 0.
+static int quantizeRow(const double* x, size_t stride, size_t n, int8_t* q,
+	double* scale, int32_t* zeroPoint, int32_t* sum)
+{
+	size_t p;
+	double low = 0, high = 0, step;
+	long value, zero;
+	int32_t total = 0;
+
+	for (p = 0; p < n; p++) {
+		if (!isfinite(x[p * stride])) {
+			PRINT_ERR("Can't quantize a non finite value!");
+			return -1;
+		}
+		low = (x[p * stride] < low) ? x[p * stride] : low;
+		high = (x[p * stride] > high) ? x[p * stride] : high;
+	}
+
+	step = (high - low) / (2 * QUANTIZED_MAX);
+
+	// All zero, or too small for a nonzero step
+	if (!(step > 0)) {
+		memset(q, 0, n);
+		*scale = 1.0;
+		*zeroPoint = 0;
+		*sum = 0;
+		return 0;
+	}
+
+	zero = lrint(-QUANTIZED_MAX - low / step);
+	zero = (zero < -QUANTIZED_MAX) ? -QUANTIZED_MAX
+		: (zero > QUANTIZED_MAX) ? QUANTIZED_MAX : zero;
+
+	for (p = 0; p < n; p++) {
+		value = lrint(x[p * stride] / step) + zero;
+		value = (value < -QUANTIZED_MAX) ? -QUANTIZED_MAX
+			: (value > QUANTIZED_MAX) ? QUANTIZED_MAX : value;
+		q[p] = (int8_t)value;
+		total += (int32_t)value;
+	}
+
+	*scale = step;
+	*zeroPoint = (int32_t)zero;
+	*sum = total;
+
+	return 0;
+}
+
+// Runs part index of the QuantizedTask arg
+static int gemmTask(void* arg, size_t index)
+{
+	const QuantizedTask* task = arg;
+	size_t first, size;
+
+	if (task->byRows) {
+		ThreadPoolOps.partition(task->m, QUANTIZED_TILE, task->parts, index,
+			&first, &size);
+		block(selectDot(), size, task->n, task->k, task->a + first * task->lda,
+			task->lda, task->b, task->ldb, task->c + first * task->ldc,
+			task->ldc);
+	}
+	else {
+		ThreadPoolOps.partition(task->n, QUANTIZED_TILE, task->parts, index,
+			&first, &size);
+		block(selectDot(), task->m, size, task->k, task->a, task->lda,
+			task->b + first * task->ldb, task->ldb, task->c + first,
+			task->ldc);
+	}
+
+	return 0;
+}
+
+// Four columns of C against one row of A while there are enough columns,
+// otherwise four rows of C against one row of B, as in a GEMV. Short tiles
+// repeat their first row and drop the extra results.
+static void block(DotKernel dot, size_t m, size_t n, size_t k,
+	const int8_t* a, size_t lda, const int8_t* b, size_t ldb, int32_t* c,
+	size_t ldc)
+{
+	const int8_t* rows[QUANTIZED_TILE];
+	int32_t out[QUANTIZED_TILE];
+	size_t i, j, t, count;
+
+	if (n >= QUANTIZED_TILE) {
+		for (i = 0; i < m; i++) {
+			for (j = 0; j < n; j += count) {
+				count = (n - j < QUANTIZED_TILE) ? n - j : QUANTIZED_TILE;
+				for (t = 0; t < QUANTIZED_TILE; t++) {
+					rows[t] = b + (j + ((t < count) ? t : 0)) * ldb;
+				}
+				dot(k, a + i * lda, rows, out);
+				memcpy(c + i * ldc + j, out, count * sizeof(int32_t));
+			}
+		}
+		return;
+	}
+
+	for (j = 0; j < n; j++) {
+		for (i = 0; i < m; i += count) {
+			count = (m - i < QUANTIZED_TILE) ? m - i : QUANTIZED_TILE;
+			for (t = 0; t < QUANTIZED_TILE; t++) {
+				rows[t] = a + (i + ((t < count) ? t : 0)) * lda;
+			}
+			dot(k, b + j * ldb, rows, out);
+			for (t = 0; t < count; t++) {
+				c[(i + t) * ldc + j] = out[t];
+			}
+		}
+	}
+}
+
+#if defined(QUANTIZED_X86)
+
+// Sums the int32 lanes of each accumulator, out[r] from acc[r]
+__attribute__((target("avx2")))
+static inline void reduce4(__m256i acc0, __m256i acc1, __m256i acc2,
+	__m256i acc3, int32_t out[4])
+{
+	__m256i sum = _mm256_hadd_epi32(_mm256_hadd_epi32(acc0, acc1),
+		_mm256_hadd_epi32(acc2, acc3));
+
+	_mm_storeu_si128((__m128i*)out, _mm_add_epi32(
+		_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1)));
+}
+
+// vpmaddubsw takes unsigned bytes on the left: |x| times the row with the
+// sign of x gives the same products. Pairs are summed in int16, then
+// vpmaddwd widens them to int32.
+__attribute__((target("avx2")))
+static void dotAvx2(size_t k, const int8_t* x, const int8_t* const rows[4],
+	int32_t out[4])
+{
+	size_t p, r;
+	__m256i acc0, acc1, acc2, acc3, xv, xu, ones;
+
+	acc0 = acc1 = acc2 = acc3 = _mm256_setzero_si256();
+	ones = _mm256_set1_epi16(1);
+
+	for (p = 0; p + 32 <= k; p += 32) {
+		xv = _mm256_loadu_si256((const __m256i*)(x + p));
+		xu = _mm256_sign_epi8(xv, xv);
+#define DOT_AVX2_ROW(acc, row) \
+		acc = _mm256_add_epi32(acc, _mm256_madd_epi16(_mm256_maddubs_epi16( \
+			xu, _mm256_sign_epi8(_mm256_loadu_si256( \
+			(const __m256i*)((row) + p)), xv)), ones))
+		DOT_AVX2_ROW(acc0, rows[0]);
+		DOT_AVX2_ROW(acc1, rows[1]);
+		DOT_AVX2_ROW(acc2, rows[2]);
+		DOT_AVX2_ROW(acc3, rows[3]);
+#undef DOT_AVX2_ROW
+	}
+
+	reduce4(acc0, acc1, acc2, acc3, out);
+
+	for (; p < k; p++) {
+		for (r = 0; r < 4; r++) {
+			out[r] += (int32_t)x[p] * rows[r][p];
+		}
+	}
+}
+
+// The same with vpdpbusd, which sums groups of four bytes into int32
+__attribute__((target("avx2,avx512vnni,avx512vl")))
+static void dotVnni(size_t k, const int8_t* x, const int8_t* const rows[4],
+	int32_t out[4])
+{
+	size_t p, r;
+	__m256i acc0, acc1, acc2, acc3, xv, xu;
+
+	acc0 = acc1 = acc2 = acc3 = _mm256_setzero_si256();
+
+	for (p = 0; p + 32 <= k; p += 32) {
+		xv = _mm256_loadu_si256((const __m256i*)(x + p));
+		xu = _mm256_sign_epi8(xv, xv);
+#define DOT_VNNI_ROW(acc, row) \
+		acc = _mm256_dpbusd_epi32(acc, xu, _mm256_sign_epi8( \
+			_mm256_loadu_si256((const __m256i*)((row) + p)), xv))
+		DOT_VNNI_ROW(acc0, rows[0]);
+		DOT_VNNI_ROW(acc1, rows[1]);
+		DOT_VNNI_ROW(acc2, rows[2]);
+		DOT_VNNI_ROW(acc3, rows[3]);
+#undef DOT_VNNI_ROW
+	}
+
+	reduce4(acc0, acc1, acc2, acc3, out);
+
+	for (; p < k; p++) {
+		for (r = 0; r < 4; r++) {
+			out[r] += (int32_t)x[p] * rows[r][p];
+		}
+	}
+}
+
+#endif
+
+static DotKernel selectDot(void)
+{
+#if defined(QUANTIZED_X86)
+	if (SimdOps.level() >= SIMD_AVX512 && hasVnni) {
+		return dotVnni;
+	}
+	if (SimdOps.level() >= SIMD_AVX2) {
+		return dotAvx2;
+	}
+#endif
+	return dotGeneric;
+}
+
+static void dotGeneric(size_t k, const int8_t* x, const int8_t* const rows[4],
+	int32_t out[4])
+{
+	size_t p, r;
+
+	for (r = 0; r < 4; r++) {
+		out[r] = 0;
+		for (p = 0; p < k; p++) {
+			out[r] += (int32_t)x[p] * rows[r][p];
+		}
+	}
+}
+
+// VNNI on 256 bit vectors needs AVX512_VNNI and AVX512VL. The OS support
+// for the wider state is part of the SIMD_AVX512 level.
+static void init(void)
+{
+#if defined(QUANTIZED_X86)
+	unsigned int eax, ebx, ecx, edx;
+
+	if (__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+		hasVnni = (ecx & (1u << 11)) && (ebx & (1u << 31));
+	}
+#endif
+}
@@ -0,0 +1,486 @@
+#include "../include/random.h"
+#include "../include/simd.h"
+#include "../include/thread_pool.h"
+#include "../lib/macro_error.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RANDOM_X86 1
+#endif
+
+//* STRUCT DEFINITION *********************************************************
+
+typedef enum RandomKind {
+	RANDOM_UNIFORM,
+	RANDOM_NORMAL
+} RandomKind;
+
+// A fill of rows x cols elements with leading dimension ld, cut into chunks
+// of RANDOM_CHUNK elements, one task each. a and b are min and max - min for
+// uniform values, mean and standard deviation for normal ones.
+typedef struct RandomTask {
+	RandomKind kind;
+	int isFloat;
+	uint64_t seed;
+	uint64_t stream;
+	uint64_t offset;
+	void* x;
+	size_t rows;
+	size_t cols;
+	size_t ld;
+	double a;
+	double b;
+} RandomTask;
+
+// Philox4x32 multipliers and Weyl increments of the key
+#define PHILOX_M0 0xD2511F53u
+#define PHILOX_M1 0xCD9E8D57u
+#define PHILOX_W0 0x9E3779B9u
+#define PHILOX_W1 0xBB67AE85u
+#define PHILOX_ROUNDS 10
+
+// Blocks generated at once before they are converted
+#define RANDOM_BATCH 64
+
+static uint64_t defaultSeed = RANDOM_DEFAULT_SEED;
+static uint64_t streamCount = 0;
+static pthread_mutex_t streamLock = PTHREAD_MUTEX_INITIALIZER;
+
+//* FUNCTION PROTOTYPES *******************************************************
+
+static void block(const uint32_t counter[4], const uint32_t key[2],
+	uint32_t out[4]);
+static int uniform(uint64_t seed, uint64_t stream, uint64_t offset,
+	double* x, size_t n, double min, double max);
+static int normal(uint64_t seed, uint64_t stream, uint64_t offset,
+	double* x, size_t n, double mean, double stddev);
+static int uniformF(uint64_t seed, uint64_t stream, uint64_t offset,
+	float* x, size_t n, double min, double max);
+static int normalF(uint64_t seed, uint64_t stream, uint64_t offset,
+	float* x, size_t n, double mean, double stddev);
+static int matrixUniform(Matrix matrix, uint64_t seed, uint64_t stream,
+	double min, double max);
+static int matrixNormal(Matrix matrix, uint64_t seed, uint64_t stream,
+	double mean, double stddev);
+static int matrixUniformF(MatrixF matrix, uint64_t seed, uint64_t stream,
+	double min, double max);
+static int matrixNormalF(MatrixF matrix, uint64_t seed, uint64_t stream,
+	double mean, double stddev);
+static void setSeed(uint64_t seed);
+static uint64_t seed(void);
+static uint64_t nextStream(void);
+static int fill(RandomTask* task);
+static int fillTask(void* arg, size_t index);
+static void generate(const RandomTask* task, uint64_t first, void* out,
+	size_t n);
+static void blocksGeneric(uint64_t seed, uint64_t stream, uint64_t first,
+	size_t count, uint32_t* out);
+static double toUniform(const uint32_t* words);
+
+//* INTERFACE INITIALIZATION **************************************************
+
+const struct RandomInterface RandomOps = {
+	.block = block,
+	.uniform = uniform,
+	.normal = normal,
+	.uniformF = uniformF,
+	.normalF = normalF,
+	.matrix = {
+		.uniform = matrixUniform,
+		.normal = matrixNormal,
+		.uniformF = matrixUniformF,
+		.normalF = matrixNormalF
+	},
+	.setSeed = setSeed,
+	.seed = seed,
+	.nextStream = nextStream
+};
+
+//* FUNCTION DEFINITIONS ******************************************************
+
+static void block(const uint32_t counter[4], const uint32_t key[2],
+	uint32_t out[4])
+{
+	uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2];
+	uint32_t c3 = counter[3], k0 = key[0], k1 = key[1];
+	uint64_t p0, p1;
+	int r;
+
+	for (r = 0; r < PHILOX_ROUNDS; r++) {
+		p0 = (uint64_t)PHILOX_M0 * c0;
+		p1 = (uint64_t)PHILOX_M1 * c2;
+		c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+		c1 = (uint32_t)p1;
+		c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+		c3 = (uint32_t)p0;
+		k0 += PHILOX_W0;
+		k1 += PHILOX_W1;
+	}
+
+	out[0] = c0;
+	out[1] = c1;
+	out[2] = c2;
+	out[3] = c3;
+}
+
+static int uniform(uint64_t seed, uint64_t stream, uint64_t offset,
+	double* x, size_t n, double min, double max)
+{
+	RandomTask task = {RANDOM_UNIFORM, 0, seed, stream, offset, x, 1, n, n,
+		min, max - min};
+
+	return fill(&task);
+}
+
+static int normal(uint64_t seed, uint64_t stream, uint64_t offset,
+	double* x, size_t n, double mean, double stddev)
+{
+	RandomTask task = {RANDOM_NORMAL, 0, seed, stream, offset, x, 1, n, n,
+		mean, stddev};
+
+	return fill(&task);
+}
+
+static int uniformF(uint64_t seed, uint64_t stream, uint64_t offset,
+	float* x, size_t n, double min, double max)
+{
+	RandomTask task = {RANDOM_UNIFORM, 1, seed, stream, offset, x, 1, n, n,
+		min, max - min};
+
+	return fill(&task);
+}
+
+static int normalF(uint64_t seed, uint64_t stream, uint64_t offset,
+	float* x, size_t n, double mean, double stddev)
+{
+	RandomTask task = {RANDOM_NORMAL, 1, seed, stream, offset, x, 1, n, n,
+		mean, stddev};
+
+	return fill(&task);
+}
+
+static int matrixUniform(Matrix matrix, uint64_t seed, uint64_t stream,
+	double min, double max)
+{
+	RandomTask task = {RANDOM_UNIFORM, 0, seed, stream, 0, NULL, 0, 0, 0,
+		min, max - min};
+
+	if (!MatrixOps.isValid(matrix)) {
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	task.x = MatrixOps.getData(matrix);
+	if (task.x == NULL) {
+		return -1;
+	}
+
+	task.rows = MatrixOps.getRow(matrix);
+	task.cols = MatrixOps.getCol(matrix);
+	task.ld = MatrixOps.getLd(matrix);
+
+	return fill(&task);
+}
+
+static int matrixNormal(Matrix matrix, uint64_t seed, uint64_t stream,
+	double mean, double stddev)
+{
+	RandomTask task = {RANDOM_NORMAL, 0, seed, stream, 0, NULL, 0, 0, 0,
+		mean, stddev};
+
+	if (!MatrixOps.isValid(matrix)) {
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	task.x = MatrixOps.getData(matrix);
+	if (task.x == NULL) {
+		return -1;
+	}
+
+	task.rows = MatrixOps.getRow(matrix);
+	task.cols = MatrixOps.getCol(matrix);
+	task.ld = MatrixOps.getLd(matrix);
+
+	return fill(&task);
+}
+
+static int matrixUniformF(MatrixF matrix, uint64_t seed, uint64_t stream,
+	double min, double max)
+{
+	RandomTask task = {RANDOM_UNIFORM, 1, seed, stream, 0, NULL, 0, 0, 0,
+		min, max - min};
+
+	if (!MatrixFOps.isValid(matrix)) {
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	task.x = MatrixFOps.getData(matrix);
+	if (task.x == NULL) {
+		return -1;
+	}
+
+	task.rows = MatrixFOps.getRow(matrix);
+	task.cols = MatrixFOps.getCol(matrix);
+	task.ld = MatrixFOps.getLd(matrix);
+
+	return fill(&task);
+}
+
+static int matrixNormalF(MatrixF matrix, uint64_t seed, uint64_t stream,
+	double mean, double stddev)
+{
+	RandomTask task = {RANDOM_NORMAL, 1, seed, stream, 0, NULL, 0, 0, 0,
+		mean, stddev};
+
+	if (!MatrixFOps.isValid(matrix)) {
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	task.x = MatrixFOps.getData(matrix);
+	if (task.x == NULL) {
+		return -1;
+	}
+
+	task.rows = MatrixFOps.getRow(matrix);
+	task.cols = MatrixFOps.getCol(matrix);
+	task.ld = MatrixFOps.getLd(matrix);
+
+	return fill(&task);
+}
+
+static void setSeed(uint64_t seed)
+{
+	pthread_mutex_lock(&streamLock);
+	defaultSeed = seed;
+	streamCount = 0;
+	pthread_mutex_unlock(&streamLock);
+}
+
+static uint64_t seed(void)
+{
+	uint64_t value;
+
+	pthread_mutex_lock(&streamLock);
+	value = defaultSeed;
+	pthread_mutex_unlock(&streamLock);
+
+	return value;
+}
+
+static uint64_t nextStream(void)
+{
+	uint64_t stream;
+
+	pthread_mutex_lock(&streamLock);
+	stream = streamCount++;
+	pthread_mutex_unlock(&streamLock);
+
+	return stream;
+}
+
+static int fill(RandomTask* task)
+{
+	size_t chunks;
+
+	if (task->x == NULL) {
+		PRINT_ERR("NULL pointer exception!");
+		return -1;
+	}
+
+	if (task->kind == RANDOM_NORMAL && task->b < 0) {
+		PRINT_ERR("Standard deviation can't be negative!");
+		return -1;
+	}
+
+	chunks = (task->rows * task->cols + RANDOM_CHUNK - 1) / RANDOM_CHUNK;
+	if (chunks == 0) {
+		return 0;
+	}
+
+	return ThreadPoolOps.run(fillTask, task, chunks);
+}
+
+// Fills chunk index, walking the rows it spans
+static int fillTask(void* arg, size_t index)
+{
+	const RandomTask* task = arg;
+	size_t start, end, row, col, length;
+	char* x = task->x;
+	size_t size = task->isFloat ? sizeof(float) : sizeof(double);
+
+	start = index * RANDOM_CHUNK;
+	end = start + RANDOM_CHUNK;
+	if (end > task->rows * task->cols) {
+		end = task->rows * task->cols;
+	}
+
+	while (start < end) {
+		row = start / task->cols;
+		col = start % task->cols;
+		length = task->cols - col;
+		if (length > end - start) {
+			length = end - start;
+		}
+
+		generate(task, task->offset + start,
+			x + (row * task->ld + col) * size, length);
+		start += length;
+	}
+
+	return 0;
+}
+
+#if defined(RANDOM_X86)
+
+// Four blocks at once, every word of a block in a 64 bit lane so that
+// _mm256_mul_epu32 gives the full products
+__attribute__((target("avx2")))
+static void blocksAvx2(uint64_t seed, uint64_t stream, uint64_t first,
+	size_t count, uint32_t* out)
+{
+	size_t i, lane;
+	int r;
+	uint32_t k0, k1;
+	uint64_t lanes[4][4];
+	__m256i c0, c1, c2, c3, p0, p1, counter, low, m0, m1;
+
+	low = _mm256_set1_epi64x(0xFFFFFFFF);
+	m0 = _mm256_set1_epi64x(PHILOX_M0);
+	m1 = _mm256_set1_epi64x(PHILOX_M1);
+
+	for (i = 0; i + 4 <= count; i += 4) {
+		counter = _mm256_add_epi64(_mm256_set1_epi64x((long long)(first + i)),
+			_mm256_set_epi64x(3, 2, 1, 0));
+		c0 = _mm256_and_si256(counter, low);
+		c1 = _mm256_srli_epi64(counter, 32);
+		c2 = _mm256_set1_epi64x((uint32_t)stream);
+		c3 = _mm256_set1_epi64x((uint32_t)(stream >> 32));
+		k0 = (uint32_t)seed;
+		k1 = (uint32_t)(seed >> 32);
+
+		for (r = 0; r < PHILOX_ROUNDS; r++) {
+			p0 = _mm256_mul_epu32(c0, m0);
+			p1 = _mm256_mul_epu32(c2, m1);
+			c0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p1, 32),
+				c1), _mm256_set1_epi64x(k0));
+			c1 = _mm256_and_si256(p1, low);
+			c2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p0, 32),
+				c3), _mm256_set1_epi64x(k1));
+			c3 = _mm256_and_si256(p0, low);
+			k0 += PHILOX_W0;
+			k1 += PHILOX_W1;
+		}
+
+		_mm256_storeu_si256((__m256i*)lanes[0], c0);
+		_mm256_storeu_si256((__m256i*)lanes[1], c1);
+		_mm256_storeu_si256((__m256i*)lanes[2], c2);
+		_mm256_storeu_si256((__m256i*)lanes[3], c3);
+		for (lane = 0; lane < 4; lane++) {
+			out[(i + lane) * 4] = (uint32_t)lanes[0][lane];
+			out[(i + lane) * 4 + 1] = (uint32_t)lanes[1][lane];
+			out[(i + lane) * 4 + 2] = (uint32_t)lanes[2][lane];
+			out[(i + lane) * 4 + 3] = (uint32_t)lanes[3][lane];
+		}
+	}
+
+	// The conversion calls libm, whose SSE code stalls on dirty upper halves
+	_mm256_zeroupper();
+	blocksGeneric(seed, stream, first + i, count - i, out + i * 4);
+}
+
+#endif
+
+// Writes the n elements of the stream starting at first. Element e comes
+// from block e / 2: its first two words for an even e, its last two for an
+// odd one, or the pair of normals of the block.
+static void generate(const RandomTask* task, uint64_t first, void* out,
+	size_t n)
+{
+	uint32_t words[RANDOM_BATCH * 4];
+	uint64_t blockStart, blockEnd, b, e, end = first + n;
+	size_t count, i;
+	double value[2], radius, angle;
+	void (*blocks)(uint64_t, uint64_t, uint64_t, size_t, uint32_t*);
+
+	blocks = blocksGeneric;
+#if defined(RANDOM_X86)
+	if (SimdOps.level() >= SIMD_AVX2) {
+		blocks = blocksAvx2;
+	}
+#endif
+
+	blockEnd = (end + 1) / 2;
+	for (blockStart = first / 2; blockStart < blockEnd; blockStart += count) {
+		count = (blockEnd - blockStart < RANDOM_BATCH)
+			? (size_t)(blockEnd - blockStart) : RANDOM_BATCH;
+		blocks(task->seed, task->stream, blockStart, count, words);
+
+		for (i = 0; i < count; i++) {
+			b = blockStart + i;
+			if (task->kind == RANDOM_UNIFORM) {
+				value[0] = task->a + task->b * toUniform(words + i * 4);
+				value[1] = task->a + task->b * toUniform(words + i * 4 + 2);
+			}
+			else {
+				// 1 - u is in (0, 1], so the logarithm is finite
+				radius = sqrt(-2.0 * log(1.0 - toUniform(words + i * 4)));
+				angle = 6.283185307179586 * toUniform(words + i * 4 + 2);
+				value[0] = task->a + task->b * radius * cos(angle);
+				value[1] = task->a + task->b * radius * sin(angle);
+			}
+
+			for (e = 2 * b; e < 2 * b + 2; e++) {
+				if (e < first || e >= end) {
+					continue;
+				}
+				if (task->isFloat) {
+					((float*)out)[e - first] = (float)value[e - 2 * b];
+				}
+				else {
+					((double*)out)[e - first] = value[e - 2 * b];
+				}
+			}
+		}
+	}
+}
+
+static void blocksGeneric(uint64_t seed, uint64_t stream, uint64_t first,
+	size_t count, uint32_t* out)
+{
+	size_t i;
+	uint32_t counter[4], key[2];
+
+	key[0] = (uint32_t)seed;
+	key[1] = (uint32_t)(seed >> 32);
+	counter[2] = (uint32_t)stream;
+	counter[3] = (uint32_t)(stream >> 32);
+
+	for (i = 0; i < count; i++) {
+		counter[0] = (uint32_t)(first + i);
+		counter[1] = (uint32_t)((first + i) >> 32);
+		block(counter, key, out + i * 4);
+	}
+}
+
+// The top 52 bits of two words as the mantissa of a double in [1, 2), minus
+// one. Exact, so every SIMD level gives the same values.
+static double toUniform(const uint32_t* words)
+{
+	uint64_t bits;
+	double value;
+
+	bits = ((((uint64_t)words[1] << 32) | words[0]) >> 12)
+		| 0x3FF0000000000000ull;
+	memcpy(&value, &bits, sizeof(value));
+
+	return value - 1.0;
+}
@@ -0,0 +1,798 @@
+#include "../include/reduce.h"
+#include "../include/simd.h"
+#include "../include/thread_pool.h"
+#include "../lib/macro_error.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <float.h>
+#include <math.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define REDUCE_X86 1
+#endif
+
+//* STRUCT DEFINITION *********************************************************
+
+typedef enum ReduceOp {
+	REDUCE_OP_SUM,
+	REDUCE_OP_DOT,
+	REDUCE_OP_MAX
+} ReduceOp;
+
+// Result of a chunk. error holds the compensation of REDUCE_KAHAN and is 0
+// otherwise.
+typedef struct ReducePartial {
+	double value;
+	double error;
+} ReducePartial;
+
+// A reduction split into chunks of REDUCE_CHUNK elements, one task each
+typedef struct ReduceTask {
+	ReduceOp op;
+	ReduceMode mode;
+	const double* x;
+	const double* y;
+	size_t n;
+	ReducePartial* partials;
+} ReduceTask;
+
+// Sums of squares outside of this range are recomputed scaled by norm, in
+// case they overflowed or lost precision to underflow
+#define NORM_SMALL 0x1p-900
+#define NORM_LARGE 0x1p+900
+
+//* FUNCTION PROTOTYPES *******************************************************
+
+static int sum(const double* x, size_t n, ReduceMode mode, double* result);
+static int dot(const double* x, const double* y, size_t n, ReduceMode mode,
+	double* result);
+static int norm(const double* x, size_t n, ReduceMode mode, double* result);
+static int max(const double* x, size_t n, double* result);
+static int argmax(const double* x, size_t n, size_t* index);
+static int matrixSum(const Matrix matrix, ReduceMode mode, double* result);
+static int matrixDot(const Matrix matrix1, const Matrix matrix2,
+	ReduceMode mode, double* result);
+static int matrixNorm(const Matrix matrix, ReduceMode mode, double* result);
+static int matrixMax(const Matrix matrix, double* result);
+static int matrixArgmax(const Matrix matrix, size_t* row, size_t* col);
+static int reduce(ReduceOp op, ReduceMode mode, const double* x,
+	const double* y, size_t n, double* result);
+static int reduceTask(void* arg, size_t index);
+static ReducePartial reduceChunk(ReduceOp op, ReduceMode mode,
+	const double* x, const double* y, size_t n);
+static double combine(ReduceOp op, ReduceMode mode,
+	const ReducePartial* partials, size_t count);
+static double pairwiseSum(const double* x, size_t n);
+static double pairwiseDot(const double* x, const double* y, size_t n);
+static double pairwiseCombine(const ReducePartial* partials, size_t count);
+static void neumaierAdd(double* sum, double* error, double value);
+static ReducePartial kahanSum(const double* x, size_t n);
+static ReducePartial kahanDot(const double* x, const double* y, size_t n);
+static double fastDot(const double* x, const double* y, size_t n);
+static double fastMax(const double* x, size_t n);
+static double scaledNorm(const double* x, size_t n);
+static int isFlat(const Matrix matrix);
+
+//* INTERFACE INITIALIZATION **************************************************
+
+const struct ReduceInterface ReduceOps = {
+	.sum = sum,
+	.dot = dot,
+	.norm = norm,
+	.max = max,
+	.argmax = argmax,
+	.matrix = {
+		.sum = matrixSum,
+		.dot = matrixDot,
+		.norm = matrixNorm,
+		.max = matrixMax,
+		.argmax = matrixArgmax
+	}
+};
+
+//* KERNEL INSTANTIATION ******************************************************
+
+#if defined(REDUCE_X86)
+
+// Two vectors of Neumaier accumulators, the rounding error of every
+// addition goes to the matching compensation lane
+__attribute__((target("avx2,fma")))
+static ReducePartial kahanSumAvx2(const double* x, size_t n)
+{
+	size_t i = 0, j;
+	double lanes[8], errors[8];
+	ReducePartial result = {0, 0};
+	__m256d s[2], c[2], v, t, sign;
+
+	sign = _mm256_set1_pd(-0.0);
+	s[0] = s[1] = c[0] = c[1] = _mm256_setzero_pd();
+
+	for (; i + 8 <= n; i += 8) {
+		for (j = 0; j < 2; j++) {
+			v = _mm256_loadu_pd(x + i + 4 * j);
+			t = _mm256_add_pd(s[j], v);
+			c[j] = _mm256_add_pd(c[j], _mm256_blendv_pd(
+				_mm256_add_pd(_mm256_sub_pd(v, t), s[j]),
+				_mm256_add_pd(_mm256_sub_pd(s[j], t), v),
+				_mm256_cmp_pd(_mm256_andnot_pd(sign, s[j]),
+					_mm256_andnot_pd(sign, v), _CMP_GE_OQ)));
+			s[j] = t;
+		}
+	}
+
+	_mm256_storeu_pd(lanes, s[0]);
+	_mm256_storeu_pd(lanes + 4, s[1]);
+	_mm256_storeu_pd(errors, c[0]);
+	_mm256_storeu_pd(errors + 4, c[1]);
+	for (j = 0; j < 8; j++) {
+		neumaierAdd(&result.value, &result.error, lanes[j]);
+		result.error += errors[j];
+	}
+	for (; i < n; i++) {
+		neumaierAdd(&result.value, &result.error, x[i]);
+	}
+
+	return result;
+}
+
+// Kahan dot products add the exact error of every product, x * y - p,
+// which fma gives in one instruction (Ogita, Rump and Oishi's Dot2)
+__attribute__((target("avx2,fma")))
+static ReducePartial kahanDotAvx2(const double* x, const double* y, size_t n)
+{
+	size_t i = 0, j;
+	double lanes[4], errors[4];
+	ReducePartial result = {0, 0};
+	__m256d s, c, a, b, p, t, sign;
+
+	sign = _mm256_set1_pd(-0.0);
+	s = c = _mm256_setzero_pd();
+
+	for (; i + 4 <= n; i += 4) {
+		a = _mm256_loadu_pd(x + i);
+		b = _mm256_loadu_pd(y + i);
+		p = _mm256_mul_pd(a, b);
+		c = _mm256_add_pd(c, _mm256_fmsub_pd(a, b, p));
+
+		t = _mm256_add_pd(s, p);
+		c = _mm256_add_pd(c, _mm256_blendv_pd(
+			_mm256_add_pd(_mm256_sub_pd(p, t), s),
+			_mm256_add_pd(_mm256_sub_pd(s, t), p),
+			_mm256_cmp_pd(_mm256_andnot_pd(sign, s),
+				_mm256_andnot_pd(sign, p), _CMP_GE_OQ)));
+		s = t;
+	}
+
+	_mm256_storeu_pd(lanes, s);
+	_mm256_storeu_pd(errors, c);
+	for (j = 0; j < 4; j++) {
+		neumaierAdd(&result.value, &result.error, lanes[j]);
+		result.error += errors[j];
+	}
+	for (; i < n; i++) {
+		neumaierAdd(&result.value, &result.error, x[i] * y[i]);
+		result.error += fma(x[i], y[i], -(x[i] * y[i]));
+	}
+
+	return result;
+}
+
+// Four accumulators hide the latency of the fma chain
+__attribute__((target("avx2,fma")))
+static double fastDotAvx2(const double* x, const double* y, size_t n)
+{
+	size_t i = 0, j;
+	double lanes[4], total = 0;
+	__m256d acc[4];
+
+	for (j = 0; j < 4; j++) {
+		acc[j] = _mm256_setzero_pd();
+	}
+
+	for (; i + 16 <= n; i += 16) {
+		for (j = 0; j < 4; j++) {
+			acc[j] = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4 * j),
+				_mm256_loadu_pd(y + i + 4 * j), acc[j]);
+		}
+	}
+	for (; i + 4 <= n; i += 4) {
+		acc[0] = _mm256_fmadd_pd(_mm256_loadu_pd(x + i),
+			_mm256_loadu_pd(y + i), acc[0]);
+	}
+
+	_mm256_storeu_pd(lanes, _mm256_add_pd(_mm256_add_pd(acc[0], acc[1]),
+		_mm256_add_pd(acc[2], acc[3])));
+	for (j = 0; j < 4; j++) {
+		total += lanes[j];
+	}
+	for (; i < n; i++) {
+		total += x[i] * y[i];
+	}
+
+	return total;
+}
+
+// max_pd returns its second operand when the first is NaN, which keeps
+// the accumulators free of NaN
+__attribute__((target("avx2,fma")))
+static double fastMaxAvx2(const double* x, size_t n)
+{
+	size_t i = 0, j;
+	double lanes[4], result = -INFINITY;
+	__m256d acc[4];
+
+	for (j = 0; j < 4; j++) {
+		acc[j] = _mm256_set1_pd(-INFINITY);
+	}
+
+	for (; i + 16 <= n; i += 16) {
+		for (j = 0; j < 4; j++) {
+			acc[j] = _mm256_max_pd(_mm256_loadu_pd(x + i + 4 * j), acc[j]);
+		}
+	}
+	for (; i + 4 <= n; i += 4) {
+		acc[0] = _mm256_max_pd(_mm256_loadu_pd(x + i), acc[0]);
+	}
+
+	_mm256_storeu_pd(lanes, _mm256_max_pd(_mm256_max_pd(acc[0], acc[1]),
+		_mm256_max_pd(acc[2], acc[3])));
+	for (j = 0; j < 4; j++) {
+		if (lanes[j] > result) {
+			result = lanes[j];
+		}
+	}
+	for (; i < n; i++) {
+		if (x[i] > result) {
+			result = x[i];
+		}
+	}
+
+	return result;
+}
+
+#define REDUCE_AVX2 (SimdOps.level() >= SIMD_AVX2)
+
+#else
+
+#define REDUCE_AVX2 0
+
+#endif
+
+//* FUNCTION DEFINITIONS ******************************************************
+
+static int sum(const double* x, size_t n, ReduceMode mode, double* result)
+{
+	return reduce(REDUCE_OP_SUM, mode, x, NULL, n, result);
+}
+
+static int dot(const double* x, const double* y, size_t n, ReduceMode mode,
+	double* result)
+{
+	if (y == NULL) {
+		PRINT_ERR("NULL pointer exception! (y)");
+		return -1;
+	}
+
+	return reduce(REDUCE_OP_DOT, mode, x, y, n, result);
+}
+
+static int norm(const double* x, size_t n, ReduceMode mode, double* result)
+{
+	double squares;
+
+	if (reduce(REDUCE_OP_DOT, mode, x, x, n, &squares) == -1) {
+		return -1;
+	}
+
+	if (squares < NORM_SMALL || squares > NORM_LARGE) {
+		*result = scaledNorm(x, n);
+		return 0;
+	}
+
+	*result = sqrt(squares);
+	return 0;
+}
+
+static int max(const double* x, size_t n, double* result)
+{
+	if (n == 0) {
+		PRINT_ERR("Can't find the maximum of nothing!");
+		return -1;
+	}
+
+	return reduce(REDUCE_OP_MAX, REDUCE_FAST, x, NULL, n, result);
+}
+
+static int argmax(const double* x, size_t n, size_t* index)
+{
+	double largest;
+	size_t i;
+
+	if (index == NULL) {
+		PRINT_ERR("NULL pointer exception! (index)");
+		return -1;
+	}
+
+	if (max(x, n, &largest) == -1) {
+		return -1;
+	}
+
+	*index = 0;
+	for (i = 0; i < n; i++) {
+		if (x[i] == largest) {
+			*index = i;
+			break;
+		}
+	}
+
+	return 0;
+}
+
+static int matrixSum(const Matrix matrix, ReduceMode mode, double* result)
+{
+	double total = 0, error = 0, value;
+	size_t i, rows, cols, ld;
+	const double* data;
+
+	if (!MatrixOps.isValid(matrix) || result == NULL) {
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	data = MatrixOps.getDataConst(matrix);
+	ld = MatrixOps.getLd(matrix);
+	rows = MatrixOps.getRow(matrix);
+	cols = MatrixOps.getCol(matrix);
+	if (isFlat(matrix)) {
+		return sum(data, rows * cols, mode, result);
+	}
+
+	for (i = 0; i < rows; i++) {
+		sum(data + i * ld, cols, mode, &value);
+		neumaierAdd(&total, &error, value);
+	}
+
+	*result = total + error;
+	return 0;
+}
+
+static int matrixDot(const Matrix matrix1, const Matrix matrix2,
+	ReduceMode mode, double* result)
+{
+	double total = 0, error = 0, value;
+	size_t i, rows, cols, ld1, ld2;
+	const double* data1, * data2;
+
+	if (!MatrixOps.isValid(matrix1) || !MatrixOps.isValid(matrix2)
+		|| result == NULL)
+	{
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	if (!MatrixOps.isSameShape(matrix1, matrix2)) {
+		PRINT_ERR("Matrix dimensions do not match!");
+		return -1;
+	}
+
+	data1 = MatrixOps.getDataConst(matrix1);
+	data2 = MatrixOps.getDataConst(matrix2);
+	ld1 = MatrixOps.getLd(matrix1);
+	ld2 = MatrixOps.getLd(matrix2);
+	rows = MatrixOps.getRow(matrix1);
+	cols = MatrixOps.getCol(matrix1);
+	if (isFlat(matrix1) && isFlat(matrix2)) {
+		return dot(data1, data2, rows * cols, mode, result);
+	}
+
+	for (i = 0; i < rows; i++) {
+		dot(data1 + i * ld1, data2 + i * ld2, cols, mode, &value);
+		neumaierAdd(&total, &error, value);
+	}
+
+	*result = total + error;
+	return 0;
+}
+
+// Row norms are combined scaled by the largest one, so this can't overflow
+// where the row norms don't
+static int matrixNorm(const Matrix matrix, ReduceMode mode, double* result)
+{
+	double largest = 0, total = 0, error = 0, value;
+	double* rowNorms;
+	size_t i, rows, cols, ld;
+	const double* data;
+
+	if (!MatrixOps.isValid(matrix) || result == NULL) {
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	data = MatrixOps.getDataConst(matrix);
+	ld = MatrixOps.getLd(matrix);
+	rows = MatrixOps.getRow(matrix);
+	cols = MatrixOps.getCol(matrix);
+	if (isFlat(matrix)) {
+		return norm(data, rows * cols, mode, result);
+	}
+
+	rowNorms = malloc(rows * sizeof(double));
+	if (rowNorms == NULL) {
+		MAL_ERR();
+		return -1;
+	}
+
+	for (i = 0; i < rows; i++) {
+		norm(data + i * ld, cols, mode, &rowNorms[i]);
+		if (!(rowNorms[i] <= largest)) {
+			largest = rowNorms[i];
+		}
+	}
+
+	if (largest == 0 || isinf(largest) || isnan(largest)) {
+		*result = largest;
+		free(rowNorms);
+		return 0;
+	}
+
+	for (i = 0; i < rows; i++) {
+		value = rowNorms[i] / largest;
+		neumaierAdd(&total, &error, value * value);
+	}
+
+	*result = largest * sqrt(total + error);
+	free(rowNorms);
+	return 0;
+}
+
+static int matrixMax(const Matrix matrix, double* result)
+{
+	size_t row, col;
+
+	if (matrixArgmax(matrix, &row, &col) == -1) {
+		return -1;
+	}
+
+	return MatrixOps.get(matrix, row, col, result);
+}
+
+static int matrixArgmax(const Matrix matrix, size_t* row, size_t* col)
+{
+	double largest = NAN, value;
+	size_t i, index, rows, cols, ld;
+	const double* data;
+
+	if (!MatrixOps.isValid(matrix) || row == NULL || col == NULL) {
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	data = MatrixOps.getDataConst(matrix);
+	ld = MatrixOps.getLd(matrix);
+	rows = MatrixOps.getRow(matrix);
+	cols = MatrixOps.getCol(matrix);
+	if (isFlat(matrix)) {
+		if (argmax(data, rows * cols, &index) == -1) {
+			return -1;
+		}
+		*row = index / cols;
+		*col = index % cols;
+		return 0;
+	}
+
+	*row = 0;
+	*col = 0;
+	for (i = 0; i < rows; i++) {
+		argmax(data + i * ld, cols, &index);
+		value = data[i * ld + index];
+
+		// Strictly larger, so the first occurrence wins
+		if (value > largest || (isnan(largest) && !isnan(value))) {
+			largest = value;
+			*row = i;
+			*col = index;
+		}
+	}
+
+	return 0;
+}
+
+// Reduces chunk by chunk on the thread pool. The chunks and the order
+// their results are combined in are fixed, so is the result.
+static int reduce(ReduceOp op, ReduceMode mode, const double* x,
+	const double* y, size_t n, double* result)
+{
+	ReduceTask task;
+	ReducePartial partial;
+	size_t chunks;
+	int err;
+
+	if (x == NULL || result == NULL) {
+		PRINT_ERR("NULL pointer exception!");
+		return -1;
+	}
+
+	if (mode != REDUCE_FAST && mode != REDUCE_PAIRWISE && mode != REDUCE_KAHAN) {
+		PRINT_ERR("Invalid reduction mode!");
+		return -1;
+	}
+
+	chunks = (n + REDUCE_CHUNK - 1) / REDUCE_CHUNK;
+	if (chunks <= 1) {
+		partial = reduceChunk(op, mode, x, y, n);
+		*result = partial.value + partial.error;
+		return 0;
+	}
+
+	task.op = op;
+	task.mode = mode;
+	task.x = x;
+	task.y = y;
+	task.n = n;
+	task.partials = malloc(chunks * sizeof(ReducePartial));
+	if (task.partials == NULL) {
+		MAL_ERR();
+		return -1;
+	}
+
+	err = ThreadPoolOps.run(reduceTask, &task, chunks);
+	if (err == 0) {
+		*result = combine(op, mode, task.partials, chunks);
+	}
+
+	free(task.partials);
+	return err;
+}
+
+static int reduceTask(void* arg, size_t index)
+{
+	ReduceTask* task = arg;
+	size_t start, length;
+
+	start = index * REDUCE_CHUNK;
+	length = (task->n - start < REDUCE_CHUNK) ? task->n - start : REDUCE_CHUNK;
+
+	task->partials[index] = reduceChunk(task->op, task->mode, task->x + start,
+		task->y ? task->y + start : NULL, length);
+
+	return 0;
+}
+
+static ReducePartial reduceChunk(ReduceOp op, ReduceMode mode,
+	const double* x, const double* y, size_t n)
+{
+	ReducePartial partial = {0, 0};
+
+	if (op == REDUCE_OP_MAX) {
+		partial.value = fastMax(x, n);
+		return partial;
+	}
+
+	switch (mode) {
+	case REDUCE_FAST:
+		partial.value = (op == REDUCE_OP_SUM) ? SimdOps.sum(x, n)
+			: fastDot(x, y, n);
+		break;
+
+	case REDUCE_PAIRWISE:
+		partial.value = (op == REDUCE_OP_SUM) ? pairwiseSum(x, n)
+			: pairwiseDot(x, y, n);
+		break;
+
+	case REDUCE_KAHAN:
+		partial = (op == REDUCE_OP_SUM) ? kahanSum(x, n) : kahanDot(x, y, n);
+		break;
+	}
+
+	return partial;
+}
+
+static double combine(ReduceOp op, ReduceMode mode,
+	const ReducePartial* partials, size_t count)
+{
+	double total = 0, error = 0;
+	size_t i;
+
+	if (op == REDUCE_OP_MAX) {
+		total = partials[0].value;
+		for (i = 1; i < count; i++) {
+			if (partials[i].value > total || isnan(total)) {
+				total = partials[i].value;
+			}
+		}
+		return total;
+	}
+
+	if (mode != REDUCE_KAHAN) {
+		return pairwiseCombine(partials, count);
+	}
+
+	for (i = 0; i < count; i++) {
+		neumaierAdd(&total, &error, partials[i].value);
+		error += partials[i].error;
+	}
+
+	return total + error;
+}
+
+// Splits on a multiple of the block size, so the leaves are full blocks
+static double pairwiseSum(const double* x, size_t n)
+{
+	size_t half;
+
+	if (n <= REDUCE_PAIRWISE_BLOCK) {
+		return SimdOps.sum(x, n);
+	}
+
+	half = (n / REDUCE_PAIRWISE_BLOCK + 1) / 2 * REDUCE_PAIRWISE_BLOCK;
+	return pairwiseSum(x, half) + pairwiseSum(x + half, n - half);
+}
+
+static double pairwiseDot(const double* x, const double* y, size_t n)
+{
+	size_t half;
+
+	if (n <= REDUCE_PAIRWISE_BLOCK) {
+		return fastDot(x, y, n);
+	}
+
+	half = (n / REDUCE_PAIRWISE_BLOCK + 1) / 2 * REDUCE_PAIRWISE_BLOCK;
+	return pairwiseDot(x, y, half) + pairwiseDot(x + half, y + half, n - half);
+}
+
+static double pairwiseCombine(const ReducePartial* partials, size_t count)
+{
+	if (count == 1) {
+		return partials[0].value;
+	}
+
+	return pairwiseCombine(partials, count / 2)
+		+ pairwiseCombine(partials + count / 2, count - count / 2);
+}
+
+// Neumaier's compensated addition. The low bits lost are those of the
+// smaller operand, which unlike Kahan's version may be the new value.
+static void neumaierAdd(double* sum, double* error, double value)
+{
+	double t = *sum + value;
+
+	if (fabs(*sum) >= fabs(value)) {
+		*error += (*sum - t) + value;
+	}
+	else {
+		*error += (value - t) + *sum;
+	}
+
+	*sum = t;
+}
+
+static ReducePartial kahanSum(const double* x, size_t n)
+{
+	ReducePartial result = {0, 0};
+	size_t i;
+
+#if defined(REDUCE_X86)
+	if (REDUCE_AVX2) {
+		return kahanSumAvx2(x, n);
+	}
+#endif
+
+	for (i = 0; i < n; i++) {
+		neumaierAdd(&result.value, &result.error, x[i]);
+	}
+
+	return result;
+}
+
+static ReducePartial kahanDot(const double* x, const double* y, size_t n)
+{
+	ReducePartial result = {0, 0};
+	double p;
+	size_t i;
+
+#if defined(REDUCE_X86)
+	if (REDUCE_AVX2) {
+		return kahanDotAvx2(x, y, n);
+	}
+#endif
+
+	for (i = 0; i < n; i++) {
+		p = x[i] * y[i];
+		neumaierAdd(&result.value, &result.error, p);
+		result.error += fma(x[i], y[i], -p);
+	}
+
+	return result;
+}
+
+static double fastDot(const double* x, const double* y, size_t n)
+{
+	double acc[4] = {0, 0, 0, 0};
+	size_t i = 0;
+
+#if defined(REDUCE_X86)
+	if (REDUCE_AVX2) {
+		return fastDotAvx2(x, y, n);
+	}
+#endif
+
+	for (; i + 4 <= n; i += 4) {
+		acc[0] += x[i] * y[i];
+		acc[1] += x[i + 1] * y[i + 1];
+		acc[2] += x[i + 2] * y[i + 2];
+		acc[3] += x[i + 3] * y[i + 3];
+	}
+	for (; i < n; i++) {
+		acc[0] += x[i] * y[i];
+	}
+
+	return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+// NaN elements are skipped, an array of NaN gives NaN
+static double fastMax(const double* x, size_t n)
+{
+	double result = -INFINITY;
+	size_t i;
+
+#if defined(REDUCE_X86)
+	if (REDUCE_AVX2) {
+		result = fastMaxAvx2(x, n);
+	}
+	else
+#endif
+	{
+		for (i = 0; i < n; i++) {
+			if (x[i] > result) {
+				result = x[i];
+			}
+		}
+	}
+
+	// -INFINITY is also what an array of NaN leaves
+	if (result == -INFINITY) {
+		for (i = 0; i < n; i++) {
+			if (x[i] == -INFINITY) {
+				return result;
+			}
+		}
+		return (n > 0) ? NAN : result;
+	}
+
+	return result;
+}
+
+// Norm with every element scaled by a power of two close to the largest
+// magnitude, which is exact and brings the squares in range
+static double scaledNorm(const double* x, size_t n)
+{
+	double largest = 0, total = 0, error = 0, scaled;
+	int exponent;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		if (!(fabs(x[i]) <= largest)) {
+			largest = fabs(x[i]);
+		}
+	}
+
+	if (largest == 0 || isinf(largest) || isnan(largest)) {
+		return largest;
+	}
+
+	exponent = ilogb(largest);
+	for (i = 0; i < n; i++) {
+		scaled = ldexp(x[i], -exponent);
+		neumaierAdd(&total, &error, scaled * scaled);
+	}
+
+	return ldexp(sqrt(total + error), exponent);
+}
+
+static int isFlat(const Matrix matrix)
+{
+	return MatrixOps.getLd(matrix) == MatrixOps.getCol(matrix)
+		|| MatrixOps.getRow(matrix) == 1;
+}
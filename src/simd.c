@@ -0,0 +1,438 @@
+#include "../include/simd.h"
+#include "../lib/macro_error.h"
+#include "../lib/macro_str.h"
+
+#include <stdint.h>
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#include <cpuid.h>
+#define SIMD_X86 1
+#endif
+
+//* STRUCT DEFINITION *********************************************************
+
+// Kernel table of one instruction set for elements of type T
+#define SIMD_KERNELS(T) {											\
+	void (*add)(T* x, const T* y, size_t n);						\
+	void (*subtract)(T* x, const T* y, size_t n);					\
+	void (*scale)(T* x, double alpha, size_t n);					\
+	void (*addTo)(T* z, const T* x, const T* y, size_t n);			\
+	void (*subtractTo)(T* z, const T* x, const T* y, size_t n);		\
+	void (*scaleTo)(T* z, const T* x, double alpha, size_t n);		\
+	void (*multiply)(T* x, const T* y, size_t n);					\
+	void (*shift)(T* x, double alpha, size_t n);					\
+	void (*maximum)(T* x, const T* y, size_t n);					\
+	void (*fill)(T* x, double value, size_t n);						\
+	void (*copy)(T* dst, const T* src, size_t n);					\
+	double (*sum)(const T* x, size_t n);							\
+	double (*max)(const T* x, size_t n);							\
+	void (*transposeTile)(T* dst, size_t ldd, const T* src, size_t lds);	\
+}
+
+typedef struct SimdKernels SIMD_KERNELS(double) SimdKernels;
+typedef struct SimdKernelsF SIMD_KERNELS(float) SimdKernelsF;
+
+// Edge of the square tiles moved by transposeTile
+#define SIMD_TILE 4
+
+// Blocks up to this edge fit in L1 for both source and destination and
+// end the recursion of the cache-oblivious transpose
+#define SIMD_TRANSPOSE_LEAF 32
+
+//* KERNEL INSTANTIATION ******************************************************
+
+// Scalar kernels, a "vector" of one element
+#define SIMD_NAME(name) XCAT(name, Scalar)
+#define SIMD_TARGET
+#define SIMD_T double
+#define SIMD_WIDTH 1
+#define SIMD_VEC double
+#define VLOADU(p) (*(p))
+#define VSTOREU(p, v) (*(p) = (v))
+#define VSTREAM(p, v) (*(p) = (v))
+#define VFENCE() ((void)0)
+#define VSET1(x) (x)
+#define VADD(a, b) ((a) + (b))
+#define VSUB(a, b) ((a) - (b))
+#define VMUL(a, b) ((a) * (b))
+#define VMAX(a, b) (((a) > (b)) ? (a) : (b))
+#include "simd_kernels.inc"
+
+#define SIMD_NAME(name) XCAT(name, ScalarF)
+#define SIMD_TARGET
+#define SIMD_T float
+#define SIMD_WIDTH 1
+#define SIMD_VEC float
+#define VLOADU(p) (*(p))
+#define VSTOREU(p, v) (*(p) = (v))
+#define VSTREAM(p, v) (*(p) = (v))
+#define VFENCE() ((void)0)
+#define VSET1(x) (x)
+#define VADD(a, b) ((a) + (b))
+#define VSUB(a, b) ((a) - (b))
+#define VMUL(a, b) ((a) * (b))
+#define VMAX(a, b) (((a) > (b)) ? (a) : (b))
+#include "simd_kernels.inc"
+
+#if defined(SIMD_X86)
+
+#define SIMD_NAME(name) XCAT(name, Sse2)
+#define SIMD_TARGET __attribute__((target("sse2")))
+#define SIMD_T double
+#define SIMD_WIDTH 2
+#define SIMD_VEC __m128d
+#define VLOADU _mm_loadu_pd
+#define VSTOREU _mm_storeu_pd
+#define VSTREAM _mm_stream_pd
+#define VFENCE _mm_sfence
+#define VSET1 _mm_set1_pd
+#define VADD _mm_add_pd
+#define VSUB _mm_sub_pd
+#define VMUL _mm_mul_pd
+#define VMAX _mm_max_pd
+#include "simd_kernels.inc"
+
+#define SIMD_NAME(name) XCAT(name, Sse2F)
+#define SIMD_TARGET __attribute__((target("sse2")))
+#define SIMD_T float
+#define SIMD_WIDTH 4
+#define SIMD_VEC __m128
+#define VLOADU _mm_loadu_ps
+#define VSTOREU _mm_storeu_ps
+#define VSTREAM _mm_stream_ps
+#define VFENCE _mm_sfence
+#define VSET1 _mm_set1_ps
+#define VADD _mm_add_ps
+#define VSUB _mm_sub_ps
+#define VMUL _mm_mul_ps
+#define VMAX _mm_max_ps
+#include "simd_kernels.inc"
+
+#define SIMD_NAME(name) XCAT(name, Avx2)
+#define SIMD_TARGET __attribute__((target("avx2,fma")))
+#define SIMD_T double
+#define SIMD_WIDTH 4
+#define SIMD_VEC __m256d
+#define VLOADU _mm256_loadu_pd
+#define VSTOREU _mm256_storeu_pd
+#define VSTREAM _mm256_stream_pd
+#define VFENCE _mm_sfence
+#define VSET1 _mm256_set1_pd
+#define VADD _mm256_add_pd
+#define VSUB _mm256_sub_pd
+#define VMUL _mm256_mul_pd
+#define VMAX _mm256_max_pd
+#include "simd_kernels.inc"
+
+#define SIMD_NAME(name) XCAT(name, Avx2F)
+#define SIMD_TARGET __attribute__((target("avx2,fma")))
+#define SIMD_T float
+#define SIMD_WIDTH 8
+#define SIMD_VEC __m256
+#define VLOADU _mm256_loadu_ps
+#define VSTOREU _mm256_storeu_ps
+#define VSTREAM _mm256_stream_ps
+#define VFENCE _mm_sfence
+#define VSET1 _mm256_set1_ps
+#define VADD _mm256_add_ps
+#define VSUB _mm256_sub_ps
+#define VMUL _mm256_mul_ps
+#define VMAX _mm256_max_ps
+#include "simd_kernels.inc"
+
+#define SIMD_NAME(name) XCAT(name, Avx512)
+#define SIMD_TARGET __attribute__((target("avx512f")))
+#define SIMD_T double
+#define SIMD_WIDTH 8
+#define SIMD_VEC __m512d
+#define VLOADU _mm512_loadu_pd
+#define VSTOREU _mm512_storeu_pd
+#define VSTREAM _mm512_stream_pd
+#define VFENCE _mm_sfence
+#define VSET1 _mm512_set1_pd
+#define VADD _mm512_add_pd
+#define VSUB _mm512_sub_pd
+#define VMUL _mm512_mul_pd
+#define VMAX _mm512_max_pd
+#include "simd_kernels.inc"
+
+#define SIMD_NAME(name) XCAT(name, Avx512F)
+#define SIMD_TARGET __attribute__((target("avx512f")))
+#define SIMD_T float
+#define SIMD_WIDTH 16
+#define SIMD_VEC __m512
+#define VLOADU _mm512_loadu_ps
+#define VSTOREU _mm512_storeu_ps
+#define VSTREAM _mm512_stream_ps
+#define VFENCE _mm_sfence
+#define VSET1 _mm512_set1_ps
+#define VADD _mm512_add_ps
+#define VSUB _mm512_sub_ps
+#define VMUL _mm512_mul_ps
+#define VMAX _mm512_max_ps
+#include "simd_kernels.inc"
+
+#endif
+
+// Transposes a SIMD_TILE x SIMD_TILE tile of src into dst.
+static void transposeTileScalar(double* dst, size_t ldd, const double* src,
+	size_t lds)
+{
+	size_t i, j;
+
+	for (i = 0; i < SIMD_TILE; i++) {
+		for (j = 0; j < SIMD_TILE; j++) {
+			dst[j * ldd + i] = src[i * lds + j];
+		}
+	}
+}
+
+static void transposeTileScalarF(float* dst, size_t ldd, const float* src,
+	size_t lds)
+{
+	size_t i, j;
+
+	for (i = 0; i < SIMD_TILE; i++) {
+		for (j = 0; j < SIMD_TILE; j++) {
+			dst[j * ldd + i] = src[i * lds + j];
+		}
+	}
+}
+
+#if defined(SIMD_X86)
+
+// 4x4 tile in registers: unpack pairs of rows, then swap 128-bit halves
+__attribute__((target("avx2")))
+static void transposeTileAvx2(double* dst, size_t ldd, const double* src,
+	size_t lds)
+{
+	__m256d r0, r1, r2, r3, t0, t1, t2, t3;
+
+	r0 = _mm256_loadu_pd(src);
+	r1 = _mm256_loadu_pd(src + lds);
+	r2 = _mm256_loadu_pd(src + 2 * lds);
+	r3 = _mm256_loadu_pd(src + 3 * lds);
+
+	t0 = _mm256_unpacklo_pd(r0, r1);
+	t1 = _mm256_unpackhi_pd(r0, r1);
+	t2 = _mm256_unpacklo_pd(r2, r3);
+	t3 = _mm256_unpackhi_pd(r2, r3);
+
+	_mm256_storeu_pd(dst, _mm256_permute2f128_pd(t0, t2, 0x20));
+	_mm256_storeu_pd(dst + ldd, _mm256_permute2f128_pd(t1, t3, 0x20));
+	_mm256_storeu_pd(dst + 2 * ldd, _mm256_permute2f128_pd(t0, t2, 0x31));
+	_mm256_storeu_pd(dst + 3 * ldd, _mm256_permute2f128_pd(t1, t3, 0x31));
+}
+
+// A 4x4 float tile is one xmm register per row
+__attribute__((target("sse2")))
+static void transposeTileSse2F(float* dst, size_t ldd, const float* src,
+	size_t lds)
+{
+	__m128 r0, r1, r2, r3;
+
+	r0 = _mm_loadu_ps(src);
+	r1 = _mm_loadu_ps(src + lds);
+	r2 = _mm_loadu_ps(src + 2 * lds);
+	r3 = _mm_loadu_ps(src + 3 * lds);
+
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+	_mm_storeu_ps(dst, r0);
+	_mm_storeu_ps(dst + ldd, r1);
+	_mm_storeu_ps(dst + 2 * ldd, r2);
+	_mm_storeu_ps(dst + 3 * ldd, r3);
+}
+
+#endif
+
+#define SIMD_TABLE(SUFFIX, TILE) {		\
+	.add = XCAT(add, SUFFIX),			\
+	.subtract = XCAT(subtract, SUFFIX),	\
+	.scale = XCAT(scale, SUFFIX),		\
+	.addTo = XCAT(addTo, SUFFIX),		\
+	.subtractTo = XCAT(subtractTo, SUFFIX),	\
+	.scaleTo = XCAT(scaleTo, SUFFIX),	\
+	.multiply = XCAT(multiply, SUFFIX),	\
+	.shift = XCAT(shift, SUFFIX),		\
+	.maximum = XCAT(maximum, SUFFIX),	\
+	.fill = XCAT(fill, SUFFIX),			\
+	.copy = XCAT(copy, SUFFIX),			\
+	.sum = XCAT(sum, SUFFIX),			\
+	.max = XCAT(max, SUFFIX),			\
+	.transposeTile = TILE				\
+}
+
+static const SimdKernels kernelTables[] = {
+	[SIMD_SCALAR] = SIMD_TABLE(Scalar, transposeTileScalar),
+#if defined(SIMD_X86)
+	[SIMD_SSE2] = SIMD_TABLE(Sse2, transposeTileScalar),
+	[SIMD_AVX2] = SIMD_TABLE(Avx2, transposeTileAvx2),
+	[SIMD_AVX512] = SIMD_TABLE(Avx512, transposeTileAvx2)
+#endif
+};
+
+static const SimdKernelsF kernelTablesF[] = {
+	[SIMD_SCALAR] = SIMD_TABLE(ScalarF, transposeTileScalarF),
+#if defined(SIMD_X86)
+	[SIMD_SSE2] = SIMD_TABLE(Sse2F, transposeTileSse2F),
+	[SIMD_AVX2] = SIMD_TABLE(Avx2F, transposeTileSse2F),
+	[SIMD_AVX512] = SIMD_TABLE(Avx512F, transposeTileSse2F)
+#endif
+};
+
+// Scalar until the constructor below has run
+static const SimdKernels* active = &kernelTables[SIMD_SCALAR];
+static const SimdKernelsF* activeF = &kernelTablesF[SIMD_SCALAR];
+static SimdLevel activeLevel = SIMD_SCALAR;
+static SimdLevel cpuLevel = SIMD_SCALAR;
+
+//* FUNCTION PROTOTYPES *******************************************************
+
+static SimdLevel level(void);
+static SimdLevel detectedLevel(void);
+static int setLevel(SimdLevel level);
+static size_t splitPoint(size_t n);
+static SimdLevel detect(void);
+static void init(void) __attribute__((constructor));
+
+// Dispatching wrappers and transposes, once per element type
+#define SIMD_FN(name) name
+#define SIMD_T double
+#define SIMD_ACTIVE active
+#include "simd_dispatch.inc"
+
+#define SIMD_FN(name) XCAT(name, F)
+#define SIMD_T float
+#define SIMD_ACTIVE activeF
+#include "simd_dispatch.inc"
+
+//* INTERFACE INITIALIZATION **************************************************
+
+const struct SimdInterface SimdOps = {
+	.level = level,
+	.detectedLevel = detectedLevel,
+	.setLevel = setLevel,
+	.add = add,
+	.subtract = subtract,
+	.scale = scale,
+	.addTo = addTo,
+	.subtractTo = subtractTo,
+	.scaleTo = scaleTo,
+	.multiply = multiply,
+	.shift = shift,
+	.maximum = maximum,
+	.fill = fill,
+	.copy = copy,
+	.sum = sum,
+	.max = max,
+	.transpose = transpose,
+	.transposeSquare = transposeSquare,
+	.f32 = {
+		.add = addF,
+		.subtract = subtractF,
+		.scale = scaleF,
+		.addTo = addToF,
+		.subtractTo = subtractToF,
+		.scaleTo = scaleToF,
+		.multiply = multiplyF,
+		.shift = shiftF,
+		.maximum = maximumF,
+		.fill = fillF,
+		.copy = copyF,
+		.sum = sumF,
+		.max = maxF,
+		.transpose = transposeF,
+		.transposeSquare = transposeSquareF
+	}
+};
+
+//* FUNCTION DEFINITIONS ******************************************************
+
+static SimdLevel level(void)
+{
+	return activeLevel;
+}
+
+static SimdLevel detectedLevel(void)
+{
+	return cpuLevel;
+}
+
+static int setLevel(SimdLevel level)
+{
+	if (level > cpuLevel) {
+		PRINT_ERR("Instruction set is not supported by the CPU!");
+		return -1;
+	}
+
+	active = &kernelTables[level];
+	activeF = &kernelTablesF[level];
+	activeLevel = level;
+	return 0;
+}
+
+// Halves n, keeping the first part a multiple of the tile edge so the
+// recursion ends on whole tiles wherever it can.
+static size_t splitPoint(size_t n)
+{
+	size_t half = (n / 2 + SIMD_TILE - 1) / SIMD_TILE * SIMD_TILE;
+
+	return (half < n) ? half : n / 2;
+}
+
+// Checks both the CPU feature bits and that the OS saves the wider
+// register state (XCR0), otherwise the instructions would fault.
+static SimdLevel detect(void)
+{
+#if defined(SIMD_X86)
+	unsigned int eax, ebx, ecx, edx, xcr0Low, xcr0High;
+	SimdLevel level = SIMD_SCALAR;
+
+	if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+		return level;
+	}
+
+	if (edx & bit_SSE2) {
+		level = SIMD_SSE2;
+	}
+
+	if (!(ecx & bit_OSXSAVE) || !(ecx & bit_AVX) || !(ecx & bit_FMA)) {
+		return level;
+	}
+
+	__asm__ volatile ("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+	(void)xcr0High;
+
+	// XMM and YMM state
+	if ((xcr0Low & 0x6) != 0x6) {
+		return level;
+	}
+
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)
+		|| !(ebx & bit_AVX2))
+	{
+		return level;
+	}
+	level = SIMD_AVX2;
+
+	// Opmask, upper ZMM and high ZMM state
+	if ((ebx & bit_AVX512F) && (xcr0Low & 0xE6) == 0xE6) {
+		level = SIMD_AVX512;
+	}
+
+	return level;
+#else
+	return SIMD_SCALAR;
+#endif
+}
+
+static void init(void)
+{
+	cpuLevel = detect();
+	setLevel(cpuLevel);
+}
@@ -0,0 +1,778 @@
+#include "../include/sparse.h"
+#include "../include/simd.h"
+#include "../include/thread_pool.h"
+#include "../lib/macro_error.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SPARSE_X86 1
+#endif
+
+//* STRUCT DEFINITION *********************************************************
+
+typedef struct SparseStruct {
+	size_t row;
+	size_t col;
+	SparseFormat format;
+	size_t nnz;
+	size_t* start;		// Major dimension + 1 positions into index and values
+	size_t* index;		// Minor coordinate of every element
+	double* values;
+} SparseStruct;
+
+typedef enum SparseProduct {
+	SPARSE_CSR_DENSE,	// Split along rows of C
+	SPARSE_CSC_DENSE,	// Split along columns of C, in SPARSE_UNIT
+	SPARSE_DENSE_CSR,	// Split along rows of C
+	SPARSE_DENSE_CSC	// Split along rows of C
+} SparseProduct;
+
+// A product split over the thread pool. C is m x n, the dense operand B is
+// k x n for sparse x dense and m x k for dense x sparse.
+typedef struct SparseTask {
+	SparseProduct product;
+	const SparseStruct* sparse;
+	const double* b;
+	size_t ldb;
+	double* c;
+	size_t ldc;
+	size_t m;
+	size_t n;
+	size_t parts;
+} SparseTask;
+
+typedef void (*AxpyKernel)(double* y, double alpha, const double* x,
+	size_t n);
+
+// Columns of a CSC x dense task are multiples of this
+#define SPARSE_UNIT 16
+
+//* FUNCTION PROTOTYPES *******************************************************
+
+static Sparse fromDense(const Matrix matrix, SparseFormat format,
+	double threshold);
+static Sparse fromTriplets(size_t row, size_t col, size_t count,
+	const size_t* rows, const size_t* cols, const double* values,
+	SparseFormat format);
+static Matrix toDense(const Sparse sparse);
+static Sparse convert(const Sparse sparse, SparseFormat format);
+static void destroy(Sparse* sparseAddr);
+static int get(const Sparse sparse, size_t row, size_t col, double* value);
+static size_t getRow(const Sparse sparse);
+static size_t getCol(const Sparse sparse);
+static size_t nonZeros(const Sparse sparse);
+static SparseFormat getFormat(const Sparse sparse);
+static Matrix multiply(const Sparse sparse, const Matrix matrix);
+static Matrix multiplyDense(const Matrix matrix, const Sparse sparse);
+static int toDenseInto(Matrix dst, const Sparse sparse);
+static int multiplyInto(Matrix dst, const Sparse sparse, const Matrix matrix);
+static int multiplyDenseInto(Matrix dst, const Matrix matrix,
+	const Sparse sparse);
+static Sparse allocate(size_t row, size_t col, SparseFormat format,
+	size_t nnz);
+static int isValid(const Sparse sparse);
+static size_t majorCount(const SparseStruct* sparse);
+static int runProduct(SparseProduct product, const SparseStruct* sparse,
+	const Matrix matrix, Matrix dst);
+static int productTask(void* arg, size_t index);
+static AxpyKernel selectAxpy(void);
+static void axpyGeneric(double* y, double alpha, const double* x, size_t n);
+
+//* INTERFACE INITIALIZATION **************************************************
+
+const struct SparseInterface SparseOps = {
+	.fromDense = fromDense,
+	.fromTriplets = fromTriplets,
+	.toDense = toDense,
+	.convert = convert,
+	.destroy = destroy,
+	.get = get,
+	.getRow = getRow,
+	.getCol = getCol,
+	.nonZeros = nonZeros,
+	.getFormat = getFormat,
+	.multiply = multiply,
+	.multiplyDense = multiplyDense,
+	.into = {
+		.toDense = toDenseInto,
+		.multiply = multiplyInto,
+		.multiplyDense = multiplyDenseInto
+	}
+};
+
+//* FUNCTION DEFINITIONS ******************************************************
+
+static Sparse fromDense(const Matrix matrix, SparseFormat format,
+	double threshold)
+{
+	size_t i, j, row, col, ld, nnz, majors, minors, pos;
+	const double* data;
+	double value;
+	Sparse sparse;
+
+	if (!MatrixOps.isValid(matrix)) {
+		PRINT_ERR("Invalid matrix!");
+		return NULL;
+	}
+
+	row = MatrixOps.getRow(matrix);
+	col = MatrixOps.getCol(matrix);
+	ld = MatrixOps.getLd(matrix);
+	data = MatrixOps.getDataConst(matrix);
+
+	nnz = 0;
+	for (i = 0; i < row; i++) {
+		for (j = 0; j < col; j++) {
+			value = data[i * ld + j];
+			nnz += (value > threshold || value < -threshold);
+		}
+	}
+
+	sparse = allocate(row, col, format, nnz);
+	if (sparse == NULL) {
+		return NULL;
+	}
+
+	// Rows of a CSR matrix, columns of a CSC one
+	majors = (format == SPARSE_CSR) ? row : col;
+	minors = (format == SPARSE_CSR) ? col : row;
+	pos = 0;
+	for (i = 0; i < majors; i++) {
+		sparse->start[i] = pos;
+		for (j = 0; j < minors; j++) {
+			value = (format == SPARSE_CSR) ? data[i * ld + j]
+				: data[j * ld + i];
+			if (value > threshold || value < -threshold) {
+				sparse->index[pos] = j;
+				sparse->values[pos] = value;
+				pos++;
+			}
+		}
+	}
+	sparse->start[majors] = pos;
+
+	return sparse;
+}
+
+// Two stable counting sorts, by minor then by major coordinate, order the
+// triplets without comparisons. Duplicates end up next to each other in the
+// order they were given and are added.
+static Sparse fromTriplets(size_t row, size_t col, size_t count,
+	const size_t* rows, const size_t* cols, const double* values,
+	SparseFormat format)
+{
+	size_t i, p, end, pos, majors, minors, major, minor;
+	size_t* bucket, * order, * tmp;
+	const size_t* majorOf, * minorOf;
+	Sparse sparse;
+
+	if (count > 0 && (rows == NULL || cols == NULL || values == NULL)) {
+		PRINT_ERR("NULL pointer exception!");
+		return NULL;
+	}
+
+	for (i = 0; i < count; i++) {
+		if (rows[i] >= row || cols[i] >= col) {
+			PRINT_ERR("Index out of bounds!");
+			return NULL;
+		}
+	}
+
+	majors = (format == SPARSE_CSR) ? row : col;
+	minors = (format == SPARSE_CSR) ? col : row;
+	majorOf = (format == SPARSE_CSR) ? rows : cols;
+	minorOf = (format == SPARSE_CSR) ? cols : rows;
+
+	sparse = allocate(row, col, format, count);
+	bucket = (size_t*)calloc(((majors > minors) ? majors : minors) + 1,
+		sizeof(size_t));
+	order = (size_t*)malloc((count > 0 ? count : 1) * sizeof(size_t));
+	tmp = (size_t*)malloc((count > 0 ? count : 1) * sizeof(size_t));
+	if (sparse == NULL || bucket == NULL || order == NULL || tmp == NULL) {
+		if (sparse != NULL) {
+			MAL_ERR();
+		}
+		destroy(&sparse);
+		free(bucket);
+		free(order);
+		free(tmp);
+		return NULL;
+	}
+
+	// By minor coordinate into tmp
+	for (i = 0; i < count; i++) {
+		bucket[minorOf[i] + 1]++;
+	}
+	for (i = 0; i < minors; i++) {
+		bucket[i + 1] += bucket[i];
+	}
+	for (i = 0; i < count; i++) {
+		tmp[bucket[minorOf[i]]++] = i;
+	}
+
+	// Then by major coordinate into order, bucket ends up as start
+	memset(bucket, 0, (majors + 1) * sizeof(size_t));
+	for (i = 0; i < count; i++) {
+		bucket[majorOf[i] + 1]++;
+	}
+	for (i = 0; i < majors; i++) {
+		bucket[i + 1] += bucket[i];
+	}
+	memcpy(sparse->start, bucket, (majors + 1) * sizeof(size_t));
+	for (i = 0; i < count; i++) {
+		order[bucket[majorOf[tmp[i]]]++] = tmp[i];
+	}
+
+	// Add the duplicates while compacting
+	pos = 0;
+	for (major = 0; major < majors; major++) {
+		p = sparse->start[major];
+		end = sparse->start[major + 1];
+		sparse->start[major] = pos;
+
+		for (; p < end; p++) {
+			minor = minorOf[order[p]];
+			if (pos > sparse->start[major]
+				&& sparse->index[pos - 1] == minor)
+			{
+				sparse->values[pos - 1] += values[order[p]];
+			}
+			else {
+				sparse->index[pos] = minor;
+				sparse->values[pos] = values[order[p]];
+				pos++;
+			}
+		}
+	}
+	sparse->start[majors] = pos;
+	sparse->nnz = pos;
+
+	free(bucket);
+	free(order);
+	free(tmp);
+
+	return sparse;
+}
+
+static Matrix toDense(const Sparse sparse)
+{
+	Matrix matrix;
+
+	if (!isValid(sparse)) {
+		PRINT_ERR("Invalid sparse matrix!");
+		return NULL;
+	}
+
+	matrix = MatrixOps.create(sparse->row, sparse->col);
+	if (matrix == NULL) {
+		return NULL;
+	}
+
+	if (toDenseInto(matrix, sparse) == -1) {
+		MatrixOps.destroy(&matrix);
+		return NULL;
+	}
+
+	return matrix;
+}
+
+// Walking the old majors in order appends to every new major in increasing
+// minor order, so the transposed storage comes out sorted
+static Sparse convert(const Sparse sparse, SparseFormat format)
+{
+	size_t i, p, majors, minors, pos;
+	Sparse result;
+
+	if (!isValid(sparse)) {
+		PRINT_ERR("Invalid sparse matrix!");
+		return NULL;
+	}
+
+	result = allocate(sparse->row, sparse->col, format, sparse->nnz);
+	if (result == NULL) {
+		return NULL;
+	}
+
+	majors = majorCount(sparse);
+	if (format == sparse->format) {
+		memcpy(result->start, sparse->start, (majors + 1) * sizeof(size_t));
+		memcpy(result->index, sparse->index, sparse->nnz * sizeof(size_t));
+		memcpy(result->values, sparse->values, sparse->nnz * sizeof(double));
+		return result;
+	}
+
+	minors = majorCount(result);
+	memset(result->start, 0, (minors + 1) * sizeof(size_t));
+	for (p = 0; p < sparse->nnz; p++) {
+		result->start[sparse->index[p] + 1]++;
+	}
+	for (i = 0; i < minors; i++) {
+		result->start[i + 1] += result->start[i];
+	}
+
+	for (i = 0; i < majors; i++) {
+		for (p = sparse->start[i]; p < sparse->start[i + 1]; p++) {
+			pos = result->start[sparse->index[p]]++;
+			result->index[pos] = i;
+			result->values[pos] = sparse->values[p];
+		}
+	}
+
+	// Every start moved to the next one, shift them back
+	for (i = minors; i > 0; i--) {
+		result->start[i] = result->start[i - 1];
+	}
+	result->start[0] = 0;
+
+	return result;
+}
+
+static void destroy(Sparse* sparseAddr)
+{
+	if (sparseAddr == NULL || *sparseAddr == NULL) {
+		return;
+	}
+
+	free((*sparseAddr)->start);
+	free((*sparseAddr)->index);
+	free((*sparseAddr)->values);
+	free(*sparseAddr);
+	*sparseAddr = NULL;
+}
+
+static int get(const Sparse sparse, size_t row, size_t col, double* value)
+{
+	size_t low, high, mid, major, minor;
+
+	if (!isValid(sparse) || value == NULL) {
+		PRINT_ERR("Invalid sparse matrix or value pointer!");
+		return -1;
+	}
+
+	if (row >= sparse->row || col >= sparse->col) {
+		PRINT_ERR("Index out of bounds!");
+		return -1;
+	}
+
+	major = (sparse->format == SPARSE_CSR) ? row : col;
+	minor = (sparse->format == SPARSE_CSR) ? col : row;
+
+	low = sparse->start[major];
+	high = sparse->start[major + 1];
+	while (low < high) {
+		mid = low + (high - low) / 2;
+		if (sparse->index[mid] < minor) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+
+	*value = (low < sparse->start[major + 1] && sparse->index[low] == minor)
+		? sparse->values[low] : 0;
+
+	return 0;
+}
+
+static size_t getRow(const Sparse sparse)
+{
+	if (!isValid(sparse)) {
+		PRINT_ERR("Invalid sparse matrix!");
+		return 0;
+	}
+
+	return sparse->row;
+}
+
+static size_t getCol(const Sparse sparse)
+{
+	if (!isValid(sparse)) {
+		PRINT_ERR("Invalid sparse matrix!");
+		return 0;
+	}
+
+	return sparse->col;
+}
+
+static size_t nonZeros(const Sparse sparse)
+{
+	if (!isValid(sparse)) {
+		PRINT_ERR("Invalid sparse matrix!");
+		return 0;
+	}
+
+	return sparse->nnz;
+}
+
+static SparseFormat getFormat(const Sparse sparse)
+{
+	if (!isValid(sparse)) {
+		PRINT_ERR("Invalid sparse matrix!");
+		return SPARSE_CSR;
+	}
+
+	return sparse->format;
+}
+
+static Matrix multiply(const Sparse sparse, const Matrix matrix)
+{
+	Matrix result;
+
+	if (!isValid(sparse) || !MatrixOps.isValid(matrix)) {
+		PRINT_ERR("Invalid matrix!");
+		return NULL;
+	}
+
+	result = MatrixOps.create(sparse->row, MatrixOps.getCol(matrix));
+	if (result == NULL) {
+		return NULL;
+	}
+
+	if (multiplyInto(result, sparse, matrix) == -1) {
+		MatrixOps.destroy(&result);
+		return NULL;
+	}
+
+	return result;
+}
+
+static Matrix multiplyDense(const Matrix matrix, const Sparse sparse)
+{
+	Matrix result;
+
+	if (!isValid(sparse) || !MatrixOps.isValid(matrix)) {
+		PRINT_ERR("Invalid matrix!");
+		return NULL;
+	}
+
+	result = MatrixOps.create(MatrixOps.getRow(matrix), sparse->col);
+	if (result == NULL) {
+		return NULL;
+	}
+
+	if (multiplyDenseInto(result, matrix, sparse) == -1) {
+		MatrixOps.destroy(&result);
+		return NULL;
+	}
+
+	return result;
+}
+
+static int toDenseInto(Matrix dst, const Sparse sparse)
+{
+	size_t i, p, ld;
+	double* data;
+
+	if (!isValid(sparse) || !MatrixOps.isValid(dst)) {
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	if (MatrixOps.getRow(dst) != sparse->row
+		|| MatrixOps.getCol(dst) != sparse->col)
+	{
+		PRINT_ERR("Matrix dimensions do not match!");
+		return -1;
+	}
+
+	if (MatrixOps.fill(dst, 0) == -1) {
+		return -1;
+	}
+
+	data = MatrixOps.getData(dst);
+	if (data == NULL) {
+		return -1;
+	}
+
+	ld = MatrixOps.getLd(dst);
+	for (i = 0; i < majorCount(sparse); i++) {
+		for (p = sparse->start[i]; p < sparse->start[i + 1]; p++) {
+			if (sparse->format == SPARSE_CSR) {
+				data[i * ld + sparse->index[p]] = sparse->values[p];
+			}
+			else {
+				data[sparse->index[p] * ld + i] = sparse->values[p];
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int multiplyInto(Matrix dst, const Sparse sparse, const Matrix matrix)
+{
+	if (!isValid(sparse) || !MatrixOps.isValid(matrix)
+		|| !MatrixOps.isValid(dst))
+	{
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	if (sparse->col != MatrixOps.getRow(matrix)
+		|| MatrixOps.getRow(dst) != sparse->row
+		|| MatrixOps.getCol(dst) != MatrixOps.getCol(matrix))
+	{
+		PRINT_ERR("Matrix dimensions do not match!");
+		return -1;
+	}
+
+	return runProduct((sparse->format == SPARSE_CSR) ? SPARSE_CSR_DENSE
+		: SPARSE_CSC_DENSE, sparse, matrix, dst);
+}
+
+static int multiplyDenseInto(Matrix dst, const Matrix matrix,
+	const Sparse sparse)
+{
+	if (!isValid(sparse) || !MatrixOps.isValid(matrix)
+		|| !MatrixOps.isValid(dst))
+	{
+		PRINT_ERR("Invalid matrix!");
+		return -1;
+	}
+
+	if (MatrixOps.getCol(matrix) != sparse->row
+		|| MatrixOps.getRow(dst) != MatrixOps.getRow(matrix)
+		|| MatrixOps.getCol(dst) != sparse->col)
+	{
+		PRINT_ERR("Matrix dimensions do not match!");
+		return -1;
+	}
+
+	return runProduct((sparse->format == SPARSE_CSR) ? SPARSE_DENSE_CSR
+		: SPARSE_DENSE_CSC, sparse, matrix, dst);
+}
+
+// Arrays get at least one element, so an empty matrix is still valid
+static Sparse allocate(size_t row, size_t col, SparseFormat format,
+	size_t nnz)
+{
+	Sparse sparse;
+	size_t majors, size;
+
+	if (format != SPARSE_CSR && format != SPARSE_CSC) {
+		PRINT_ERR("Invalid sparse format!");
+		return NULL;
+	}
+
+	if (row == 0 || col == 0) {
+		PRINT_ERR("Invalid matrix dimensions!");
+		return NULL;
+	}
+
+	sparse = (Sparse)malloc(sizeof(SparseStruct));
+	if (sparse == NULL) {
+		MAL_ERR();
+		return NULL;
+	}
+
+	majors = (format == SPARSE_CSR) ? row : col;
+	size = (nnz > 0) ? nnz : 1;
+
+	sparse->row = row;
+	sparse->col = col;
+	sparse->format = format;
+	sparse->nnz = nnz;
+	sparse->start = (size_t*)malloc((majors + 1) * sizeof(size_t));
+	sparse->index = (size_t*)malloc(size * sizeof(size_t));
+	sparse->values = (double*)malloc(size * sizeof(double));
+
+	if (sparse->start == NULL || sparse->index == NULL
+		|| sparse->values == NULL)
+	{
+		MAL_ERR();
+		destroy(&sparse);
+		return NULL;
+	}
+
+	return sparse;
+}
+
+static int isValid(const Sparse sparse)
+{
+	return sparse != NULL && sparse->start != NULL && sparse->index != NULL
+		&& sparse->values != NULL;
+}
+
+static size_t majorCount(const SparseStruct* sparse)
+{
+	return (sparse->format == SPARSE_CSR) ? sparse->row : sparse->col;
+}
+
+static int runProduct(SparseProduct product, const SparseStruct* sparse,
+	const Matrix matrix, Matrix dst)
+{
+	SparseTask task;
+	size_t units, threads;
+	double work;
+
+	task.c = MatrixOps.getData(dst);
+	if (task.c == NULL) {
+		return -1;
+	}
+
+	// The kernels read the dense operand while writing the result
+	if (MatrixOps.overlaps(dst, matrix)) {
+		PRINT_ERR("Destination can't alias an operand!");
+		return -1;
+	}
+
+	task.product = product;
+	task.sparse = sparse;
+	task.b = MatrixOps.getDataConst(matrix);
+	task.ldb = MatrixOps.getLd(matrix);
+	task.ldc = MatrixOps.getLd(dst);
+	task.m = MatrixOps.getRow(dst);
+	task.n = MatrixOps.getCol(dst);
+
+	// Work is one multiply-add per nonzero and dense column or row
+	work = (double)sparse->nnz * ((product == SPARSE_CSR_DENSE
+		|| product == SPARSE_CSC_DENSE) ? task.n : task.m);
+	units = (product == SPARSE_CSC_DENSE)
+		? (task.n + SPARSE_UNIT - 1) / SPARSE_UNIT : task.m;
+
+	task.parts = 1;
+	if (work >= SPARSE_PARALLEL_THRESHOLD) {
+		threads = ThreadPoolOps.threadCount();
+		task.parts = (threads < units) ? threads : units;
+	}
+
+	return ThreadPoolOps.run(productTask, &task, task.parts);
+}
+
+// Runs part index of the SparseTask arg
+static int productTask(void* arg, size_t index)
+{
+	const SparseTask* task = arg;
+	const SparseStruct* sparse = task->sparse;
+	const size_t* start = sparse->start, * col = sparse->index;
+	const double* values = sparse->values, * a;
+	double* c;
+	double acc;
+	size_t i, j, p, q, first, size, n = task->n;
+	AxpyKernel axpy = selectAxpy();
+
+	if (task->product == SPARSE_CSC_DENSE) {
+		ThreadPoolOps.partition(n, SPARSE_UNIT, task->parts, index,
+			&first, &size);
+	}
+	else {
+		ThreadPoolOps.partition(task->m, 1, task->parts, index, &first, &size);
+	}
+
+	switch (task->product) {
+	case SPARSE_CSR_DENSE:
+		// C[i] = sum over p of values[p] * B[col[p]]
+		for (i = first; i < first + size; i++) {
+			c = task->c + i * task->ldc;
+			if (n == 1) {
+				acc = 0;
+				for (p = start[i]; p < start[i + 1]; p++) {
+					acc += values[p] * task->b[col[p] * task->ldb];
+				}
+				*c = acc;
+				continue;
+			}
+			memset(c, 0, n * sizeof(double));
+			for (p = start[i]; p < start[i + 1]; p++) {
+				axpy(c, values[p], task->b + col[p] * task->ldb, n);
+			}
+		}
+		break;
+
+	case SPARSE_CSC_DENSE:
+		// C[row[p]] += values[p] * B[j], on columns [first, first + size)
+		for (i = 0; i < task->m; i++) {
+			memset(task->c + i * task->ldc + first, 0, size * sizeof(double));
+		}
+		for (j = 0; j < sparse->col; j++) {
+			for (p = start[j]; p < start[j + 1]; p++) {
+				axpy(task->c + col[p] * task->ldc + first, values[p],
+					task->b + j * task->ldb + first, size);
+			}
+		}
+		break;
+
+	case SPARSE_DENSE_CSR:
+		// C[i] = sum over q of A[i][q] * S[q], scattered into C[i]
+		for (i = first; i < first + size; i++) {
+			a = task->b + i * task->ldb;
+			c = task->c + i * task->ldc;
+			memset(c, 0, n * sizeof(double));
+			for (q = 0; q < sparse->row; q++) {
+				if (a[q] == 0) {
+					continue;
+				}
+				for (p = start[q]; p < start[q + 1]; p++) {
+					c[col[p]] += a[q] * values[p];
+				}
+			}
+		}
+		break;
+
+	case SPARSE_DENSE_CSC:
+		// C[i][j] = A[i] gathered at the rows of column j, times its values
+		for (i = first; i < first + size; i++) {
+			a = task->b + i * task->ldb;
+			c = task->c + i * task->ldc;
+			for (j = 0; j < n; j++) {
+				acc = 0;
+				for (p = start[j]; p < start[j + 1]; p++) {
+					acc += a[col[p]] * values[p];
+				}
+				c[j] = acc;
+			}
+		}
+		break;
+	}
+
+	return 0;
+}
+
+#if defined(SPARSE_X86)
+
+__attribute__((target("avx2,fma")))
+static void axpyAvx2(double* y, double alpha, const double* x, size_t n)
+{
+	size_t i;
+	__m256d va = _mm256_set1_pd(alpha);
+
+	for (i = 0; i + 8 <= n; i += 8) {
+		_mm256_storeu_pd(y + i, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i),
+			_mm256_loadu_pd(y + i)));
+		_mm256_storeu_pd(y + i + 4, _mm256_fmadd_pd(va,
+			_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)));
+	}
+	for (; i + 4 <= n; i += 4) {
+		_mm256_storeu_pd(y + i, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i),
+			_mm256_loadu_pd(y + i)));
+	}
+	for (; i < n; i++) {
+		y[i] += alpha * x[i];
+	}
+}
+
+#endif
+
+static AxpyKernel selectAxpy(void)
+{
+#if defined(SPARSE_X86)
+	if (SimdOps.level() >= SIMD_AVX2) {
+		return axpyAvx2;
+	}
+#endif
+	return axpyGeneric;
+}
+
+static void axpyGeneric(double* y, double alpha, const double* x, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		y[i] += alpha * x[i];
+	}
+}
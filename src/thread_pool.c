@@ -0,0 +1,282 @@
+#include "../include/thread_pool.h"
+#include "../lib/macro_error.h"
+
+#include <pthread.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+//* STRUCT DEFINITION *********************************************************
+
+typedef struct ThreadPoolStruct {
+	pthread_mutex_t lock;		// Guards everything below
+	pthread_cond_t wake;		// Workers wait here for a batch
+	pthread_cond_t done;		// The caller waits here for the last task
+	pthread_mutex_t batchLock;	// Held by the thread running a batch
+	pthread_t workers[THREAD_POOL_MAX_THREADS - 1];
+	size_t workerCount;
+	size_t threads;				// 0 until the default is looked up
+	ThreadPoolTask task;
+	void* arg;
+	size_t count;				// Tasks of the current batch
+	size_t next;				// First task nobody took yet
+	size_t finished;
+	int failed;
+	int stopping;
+} ThreadPoolStruct;
+
+static ThreadPoolStruct pool = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.wake = PTHREAD_COND_INITIALIZER,
+	.done = PTHREAD_COND_INITIALIZER,
+	.batchLock = PTHREAD_MUTEX_INITIALIZER
+};
+
+//* FUNCTION PROTOTYPES *******************************************************
+
+static size_t threadCount(void);
+static int setThreadCount(size_t count);
+static int run(ThreadPoolTask task, void* arg, size_t count);
+static void shutdown(void);
+static void partition(size_t length, size_t unit, size_t parts, size_t index,
+	size_t* start, size_t* size);
+static size_t defaultThreadCount(void);
+static void startWorkers(size_t count);
+static void stopWorkers(void);
+static void work(void);
+static void* workerMain(void* unused);
+static int runSerial(ThreadPoolTask task, void* arg, size_t count);
+
+//* INTERFACE INITIALIZATION **************************************************
+
+const struct ThreadPoolInterface ThreadPoolOps = {
+	.threadCount = threadCount,
+	.setThreadCount = setThreadCount,
+	.run = run,
+	.shutdown = shutdown,
+	.partition = partition
+};
+
+//* FUNCTION DEFINITIONS ******************************************************
+
+static size_t threadCount(void)
+{
+	size_t threads;
+
+	pthread_mutex_lock(&pool.lock);
+	if (pool.threads == 0) {
+		pool.threads = defaultThreadCount();
+	}
+	threads = pool.threads;
+	pthread_mutex_unlock(&pool.lock);
+
+	return threads;
+}
+
+static int setThreadCount(size_t count)
+{
+	if (count > THREAD_POOL_MAX_THREADS) {
+		PRINT_ERR("Thread count is too large!");
+		return -1;
+	}
+
+	pthread_mutex_lock(&pool.batchLock);
+	stopWorkers();
+
+	pthread_mutex_lock(&pool.lock);
+	pool.threads = count;
+	pthread_mutex_unlock(&pool.lock);
+
+	pthread_mutex_unlock(&pool.batchLock);
+	return 0;
+}
+
+static int run(ThreadPoolTask task, void* arg, size_t count)
+{
+	size_t threads;
+	int failed;
+
+	if (task == NULL) {
+		PRINT_ERR("NULL pointer exception! (task)");
+		return -1;
+	}
+
+	threads = threadCount();
+	if (threads == 1 || count <= 1) {
+		return runSerial(task, arg, count);
+	}
+
+	// Another batch is running, maybe the one this call comes from
+	if (pthread_mutex_trylock(&pool.batchLock) != 0) {
+		return runSerial(task, arg, count);
+	}
+
+	startWorkers(threads - 1);
+	if (pool.workerCount == 0) {
+		pthread_mutex_unlock(&pool.batchLock);
+		return runSerial(task, arg, count);
+	}
+
+	pthread_mutex_lock(&pool.lock);
+	pool.task = task;
+	pool.arg = arg;
+	pool.count = count;
+	pool.next = 0;
+	pool.finished = 0;
+	pool.failed = 0;
+	pthread_cond_broadcast(&pool.wake);
+
+	// The caller takes tasks too, then waits for those still running
+	work();
+	while (pool.finished < pool.count) {
+		pthread_cond_wait(&pool.done, &pool.lock);
+	}
+	failed = pool.failed;
+	pthread_mutex_unlock(&pool.lock);
+
+	pthread_mutex_unlock(&pool.batchLock);
+	return failed ? -1 : 0;
+}
+
+static void shutdown(void)
+{
+	pthread_mutex_lock(&pool.batchLock);
+	stopWorkers();
+	pthread_mutex_unlock(&pool.batchLock);
+}
+
+static void partition(size_t length, size_t unit, size_t parts, size_t index,
+	size_t* start, size_t* size)
+{
+	size_t units, end;
+
+	units = (length + unit - 1) / unit;
+	*start = units * index / parts * unit;
+	end = units * (index + 1) / parts * unit;
+
+	*size = ((end < length) ? end : length) - *start;
+}
+
+static size_t defaultThreadCount(void)
+{
+	const char* env;
+	char* end;
+	unsigned long value;
+	long online;
+
+	env = getenv(THREAD_POOL_ENV);
+	if (env != NULL && *env != '\0') {
+		value = strtoul(env, &end, 10);
+		if (*end == '\0' && value > 0) {
+			return (value < THREAD_POOL_MAX_THREADS) ? value
+				: THREAD_POOL_MAX_THREADS;
+		}
+		PRINT_ERR("Invalid " THREAD_POOL_ENV " value!");
+	}
+
+	online = sysconf(_SC_NPROCESSORS_ONLN);
+	if (online < 1) {
+		return 1;
+	}
+	return ((size_t)online < THREAD_POOL_MAX_THREADS) ? (size_t)online
+		: THREAD_POOL_MAX_THREADS;
+}
+
+// Called with batchLock held. A worker that can't be created is simply
+// missing, the batch still completes on the others and the caller.
+static void startWorkers(size_t count)
+{
+	while (pool.workerCount < count) {
+		if (pthread_create(&pool.workers[pool.workerCount], NULL, workerMain,
+			NULL) != 0)
+		{
+			PRINT_ERR("Could not create a worker thread!");
+			return;
+		}
+		pool.workerCount++;
+	}
+}
+
+// Called with batchLock held
+static void stopWorkers(void)
+{
+	size_t i;
+
+	if (pool.workerCount == 0) {
+		return;
+	}
+
+	pthread_mutex_lock(&pool.lock);
+	pool.stopping = 1;
+	pthread_cond_broadcast(&pool.wake);
+	pthread_mutex_unlock(&pool.lock);
+
+	for (i = 0; i < pool.workerCount; i++) {
+		pthread_join(pool.workers[i], NULL);
+	}
+	pool.workerCount = 0;
+
+	pthread_mutex_lock(&pool.lock);
+	pool.stopping = 0;
+	pthread_mutex_unlock(&pool.lock);
+}
+
+// Takes tasks of the current batch until none is left. Called with lock
+// held, which is released while a task runs.
+static void work(void)
+{
+	ThreadPoolTask task;
+	void* arg;
+	size_t index;
+	int err;
+
+	while (pool.next < pool.count) {
+		index = pool.next++;
+		task = pool.task;
+		arg = pool.arg;
+
+		pthread_mutex_unlock(&pool.lock);
+		err = task(arg, index);
+		pthread_mutex_lock(&pool.lock);
+
+		if (err) {
+			pool.failed = 1;
+		}
+		if (++pool.finished == pool.count) {
+			pthread_cond_signal(&pool.done);
+		}
+	}
+}
+
+static void* workerMain(void* unused)
+{
+	(void)unused;
+
+	pthread_mutex_lock(&pool.lock);
+	for (;;) {
+		while (!pool.stopping && pool.next >= pool.count) {
+			pthread_cond_wait(&pool.wake, &pool.lock);
+		}
+		if (pool.stopping) {
+			break;
+		}
+		work();
+	}
+	pthread_mutex_unlock(&pool.lock);
+
+	return NULL;
+}
+
+static int runSerial(ThreadPoolTask task, void* arg, size_t count)
+{
+	size_t i;
+	int failed = 0;
+
+	for (i = 0; i < count; i++) {
+		if (task(arg, i)) {
+			failed = 1;
+		}
+	}
+
+	return failed ? -1 : 0;
+}
@@ -0,0 +1,97 @@
+/*
+ * Counts the allocator calls of a training-like loop of small column
+ * vectors, and times it. Build it like the tests, against glibc, and run
+ * it on its own.
+ *
+ * The allocation functions are replaced by counting wrappers around the
+ * glibc ones.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../include/matrix.h"
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void* ptr);
+
+static size_t allocations;
+
+void* malloc(size_t size) {
+    allocations++;
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    allocations++;
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    allocations++;
+    return __libc_realloc(ptr, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    allocations++;
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+    allocations++;
+    *ptr = __libc_memalign(alignment, size);
+    return (*ptr == NULL) ? 12 : 0;
+}
+
+void free(void* ptr) {
+    __libc_free(ptr);
+}
+
+double now() {
+    struct timespec time;
+
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+// What a layer does per sample: an output, its activation, and the error
+// derivative, all column vectors
+void run(size_t size, size_t iterations, size_t* count, double* seconds) {
+    Matrix input = MatrixOps.create(size, 1), output, activated, error;
+    size_t before, i;
+    double start;
+
+    MatrixOps.fill(input, 0.5);
+    before = allocations;
+    start = now();
+    for (i = 0; i < iterations; i++) {
+        output = MatrixOps.outOfPlace.scalarMultiply(input, 2.0);
+        activated = MatrixOps.outOfPlace.add(output, input);
+        error = MatrixOps.outOfPlace.subtract(activated, output);
+        MatrixOps.destroy(&output);
+        MatrixOps.destroy(&activated);
+        MatrixOps.destroy(&error);
+    }
+    *seconds = now() - start;
+    *count = allocations - before;
+
+    MatrixOps.destroy(&input);
+}
+
+int main() {
+    size_t sizes[] = {10, 32, MATRIX_INLINE_SIZE / sizeof(double) + 1, 512};
+    size_t iterations = 1000000, count, i;
+    double seconds;
+
+    printf("%8s %24s %12s\n", "rows", "allocations per matrix", "ns per matrix");
+    for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        run(sizes[i], iterations, &count, &seconds);
+        printf("%8zu %24.2f %12.1f\n", sizes[i], count / (3.0 * iterations),
+            seconds * 1e9 / (3.0 * iterations));
+    }
+
+    return 0;
+}
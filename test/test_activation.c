@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include "../include/activation.h"
+#include "../include/simd.h"
+#include "../include/matrix.h"
+
+#define N 1003
+
+double cube(double x) {
+    return x * x * x;
+}
+
+void cubeArray(const double* in, double* out, size_t n) {
+    size_t i;
+    for (i = 0; i < n; i++) {
+        out[i] = -in[i];
+    }
+}
+
+int isClose(double value, double expected) {
+    if (isnan(expected)) {
+        return isnan(value);
+    }
+    if (isinf(expected)) {
+        return value == expected;
+    }
+    return fabs(value - expected) <= 1e-14 * fabs(expected) + 1e-15;
+}
+
+void test_kernels() {
+    double (*funcs[])(double) = {
+        ActivationOps.f.sigmoid, ActivationOps.f.tanh, ActivationOps.f.relu,
+        ActivationOps.f.leakyRelu, ActivationOps.f.gelu,
+        ActivationOps.f.softplus, ActivationOps.f.exp
+    };
+    ActivationKernel kernels[] = {
+        ActivationOps.array.sigmoid, ActivationOps.array.tanh,
+        ActivationOps.array.relu, ActivationOps.array.leakyRelu,
+        ActivationOps.array.gelu, ActivationOps.array.softplus,
+        ActivationOps.array.exp
+    };
+    double special[] = {0.0, -0.0, 1e-300, -1e-300, 1e-9, -1e-9, 20.0, -20.0,
+        700.0, -700.0, 709.7, -745.0, 800.0, -800.0, INFINITY, -INFINITY, NAN};
+    size_t count = sizeof(special) / sizeof(special[0]);
+    double in[N], out[N];
+    SimdLevel level;
+    size_t f, i, n;
+
+    for (i = 0; i < N; i++) {
+        in[i] = (i < count) ? special[i] : 40.0 * rand() / RAND_MAX - 20.0;
+    }
+
+    for (level = SIMD_SCALAR; level <= SimdOps.detectedLevel(); level++) {
+        assert(SimdOps.setLevel(level) == 0);
+
+        for (f = 0; f < 7; f++) {
+            assert(ActivationOps.kernelOf(funcs[f]) == kernels[f]);
+
+            // Every tail length
+            for (n = N - 4; n <= N; n++) {
+                kernels[f](in, out, n);
+                for (i = 0; i < n; i++) {
+                    assert(isClose(out[i], funcs[f](in[i])));
+                }
+            }
+
+            // In place
+            for (i = 0; i < N; i++) {
+                out[i] = in[i];
+            }
+            kernels[f](out, out, N);
+            for (i = 0; i < N; i++) {
+                assert(isClose(out[i], funcs[f](in[i])));
+            }
+        }
+    }
+
+    SimdOps.setLevel(SimdOps.detectedLevel());
+}
+
+void test_derivatives() {
+    double (*funcs[])(double) = {
+        ActivationOps.f.sigmoid, ActivationOps.f.tanh, ActivationOps.f.gelu,
+        ActivationOps.f.softplus, ActivationOps.f.exp
+    };
+    double (*derivs[])(double) = {
+        ActivationOps.derivative.sigmoid, ActivationOps.derivative.tanh,
+        ActivationOps.derivative.gelu, ActivationOps.derivative.softplus,
+        ActivationOps.derivative.exp
+    };
+    double x, h = 1e-6, numeric;
+    size_t f;
+
+    for (f = 0; f < 5; f++) {
+        for (x = -3.0; x <= 3.0; x += 0.37) {
+            numeric = (funcs[f](x + h) - funcs[f](x - h)) / (2 * h);
+            assert(fabs(numeric - derivs[f](x)) < 1e-7);
+        }
+    }
+
+    assert(ActivationOps.derivative.relu(2.0) == 1.0);
+    assert(ActivationOps.derivative.relu(-2.0) == 0.0);
+    assert(ActivationOps.derivative.leakyRelu(-2.0) == ACTIVATION_LEAKY_SLOPE);
+}
+
+void test_registry() {
+    double in[5] = {1, 2, 3, 4, 5}, out[5];
+    float inF[300], outF[300];
+    size_t i;
+
+    // No kernel, called once per element
+    assert(ActivationOps.kernelOf(cube) == NULL);
+    ActivationOps.apply(cube, in, out, 5);
+    assert(out[4] == 125.0);
+
+    // The registered kernel is used instead, recognizable by its result
+    assert(ActivationOps.addKernel(cube, cubeArray) == 0);
+    assert(ActivationOps.kernelOf(cube) == cubeArray);
+    ActivationOps.apply(cube, in, out, 5);
+    assert(out[4] == -5.0);
+
+    Matrix matrix = MatrixOps.createPadded(3, 5, 8);
+    MatrixOps.fill(matrix, 2.0);
+    assert(MatrixOps.applyToAllUnary(matrix, cube) == 0);
+    MatrixOps.get(matrix, 2, 4, &out[0]);
+    assert(out[0] == -2.0);
+    MatrixOps.destroy(&matrix);
+
+    // Longer than a widening block
+    for (i = 0; i < 300; i++) {
+        inF[i] = (float)i;
+    }
+    ActivationOps.applyF(cube, inF, outF, 300);
+    assert(outF[299] == -299.0f);
+
+    assert(ActivationOps.addKernel(cube, NULL) == 0);
+    assert(ActivationOps.kernelOf(cube) == NULL);
+
+    // Built-ins keep their kernels
+    assert(ActivationOps.addKernel(ActivationOps.f.exp, cubeArray) == -1);
+    assert(ActivationOps.addKernel(NULL, cubeArray) == -1);
+}
+
+void test_matrix() {
+    Matrix matrix = MatrixOps.create(7, 9);
+    Matrix result;
+    MatrixF matrixF;
+    double value, expected;
+    float valueF;
+    size_t i, j;
+
+    MatrixOps.randomize(matrix, -5.0, 5.0);
+    result = MatrixOps.outOfPlace.applyToAllUnary(matrix, ActivationOps.f.gelu);
+    matrixF = MatrixFOps.convert(matrix);
+    assert(MatrixFOps.applyToAllUnary(matrixF, ActivationOps.f.sigmoid) == 0);
+
+    for (i = 0; i < 7; i++) {
+        for (j = 0; j < 9; j++) {
+            MatrixOps.get(matrix, i, j, &value);
+            expected = ActivationOps.f.gelu(value);
+            MatrixOps.get(result, i, j, &value);
+            assert(isClose(value, expected));
+
+            MatrixOps.get(matrix, i, j, &value);
+            MatrixFOps.get(matrixF, i, j, &valueF);
+            assert(fabs(valueF - ActivationOps.f.sigmoid((float)value)) < 1e-7);
+        }
+    }
+
+    MatrixOps.destroy(&matrix);
+    MatrixOps.destroy(&result);
+    MatrixFOps.destroy(&matrixF);
+}
+
+int main() {
+    srand(11);
+    test_kernels();
+    test_derivatives();
+    test_registry();
+    test_matrix();
+
+    printf("All tests passed!\n");
+    return 0;
+}
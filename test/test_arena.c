@@ -0,0 +1,86 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <assert.h>
+#include "../include/arena.h"
+#include "../include/matrix.h"
+
+void test_alloc_reset() {
+    Arena arena = ArenaOps.create(1024);
+    ArenaMark start, middle;
+    char* first, * second, * large;
+
+    assert(arena != NULL);
+    assert(ArenaOps.used(arena) == 0);
+
+    start = ArenaOps.mark(arena);
+    first = ArenaOps.alloc(arena, 10);
+    second = ArenaOps.alloc(arena, 100);
+    assert(first != NULL && second != NULL);
+    assert((uintptr_t)first % ARENA_ALIGNMENT == 0);
+    assert((uintptr_t)second % ARENA_ALIGNMENT == 0);
+    assert(second == first + ARENA_ALIGNMENT);
+    assert(ArenaOps.used(arena) == 3 * ARENA_ALIGNMENT);
+
+    // Larger than a block, gets its own
+    middle = ArenaOps.mark(arena);
+    large = ArenaOps.alloc(arena, 5000);
+    assert(large != NULL);
+    large[4999] = 1;
+
+    // Resetting to a mark hands the same memory out again
+    ArenaOps.reset(arena, middle);
+    assert(ArenaOps.used(arena) == 3 * ARENA_ALIGNMENT);
+    assert(ArenaOps.alloc(arena, 5000) == large);
+
+    ArenaOps.reset(arena, start);
+    assert(ArenaOps.alloc(arena, 10) == first);
+
+    ArenaOps.clear(arena);
+    assert(ArenaOps.alloc(arena, 1) == first);
+
+    ArenaOps.destroy(&arena);
+    assert(arena == NULL);
+}
+
+void test_matrix_scope() {
+    Arena arena = ArenaOps.create(0);
+    Matrix persistent = MatrixOps.create(4, 4);
+    Matrix product, view;
+    ArenaMark start;
+    double value;
+    int pass;
+
+    MatrixOps.fill(persistent, 1.0);
+    assert(ArenaOps.use(arena) == NULL);
+    assert(ArenaOps.current() == arena);
+    start = ArenaOps.mark(arena);
+
+    for (pass = 0; pass < 3; pass++) {
+        product = MatrixOps.multiply(persistent, persistent);
+        view = MatrixOps.view(product, 1, 1, 2, 2);
+        assert(product != NULL && view != NULL);
+        MatrixOps.get(view, 0, 0, &value);
+        assert(value == 4.0);
+
+        // Destroying is allowed and frees nothing
+        MatrixOps.destroy(&view);
+        assert(ArenaOps.used(arena) > 0);
+
+        ArenaOps.reset(arena, start);
+        assert(ArenaOps.used(arena) == 0);
+    }
+
+    assert(ArenaOps.use(NULL) == arena);
+    assert(ArenaOps.current() == NULL);
+
+    MatrixOps.destroy(&persistent);
+    ArenaOps.destroy(&arena);
+}
+
+int main() {
+    test_alloc_reset();
+    test_matrix_scope();
+
+    printf("All tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include "../include/expression.h"
+
+double square(double x) {
+    return x * x;
+}
+
+void test_softmax() {
+    // Longer than a block, and padded rows that can't be walked flat
+    size_t shapes[][2] = {{1, 3}, {1000, 1}, {37, 41}};
+    size_t s, i, j, row, col;
+    double value, expected, total;
+
+    for (s = 0; s < 3; s++) {
+        row = shapes[s][0];
+        col = shapes[s][1];
+        Matrix input = MatrixOps.createPadded(row, col, col + 3);
+        Matrix output = MatrixOps.create(row, col);
+        MatrixOps.randomize(input, -2.0, 2.0);
+
+        Expression expr = ExpressionOps.create(input);
+        assert(expr != NULL);
+        assert(ExpressionOps.unary(expr, exp) == 0);
+        assert(ExpressionOps.normalize(expr) == 0);
+        assert(ExpressionOps.evaluate(expr, output) == 0);
+
+        total = 0;
+        for (i = 0; i < row; i++) {
+            for (j = 0; j < col; j++) {
+                MatrixOps.get(input, i, j, &value);
+                total += exp(value);
+            }
+        }
+        for (i = 0; i < row; i++) {
+            for (j = 0; j < col; j++) {
+                MatrixOps.get(input, i, j, &value);
+                expected = exp(value) / total;
+                MatrixOps.get(output, i, j, &value);
+                assert(fabs(value - expected) <= 1e-12 * expected);
+            }
+        }
+
+        // Summing doesn't store anything and sees the same values
+        assert(ExpressionOps.sum(expr, &total) == 0);
+        assert(fabs(total - 1.0) < 1e-12);
+
+        // In place
+        assert(ExpressionOps.evaluate(expr, input) == 0);
+        MatrixOps.get(input, row - 1, col - 1, &value);
+        MatrixOps.get(output, row - 1, col - 1, &expected);
+        assert(value == expected);
+
+        ExpressionOps.destroy(&expr);
+        MatrixOps.destroy(&input);
+        MatrixOps.destroy(&output);
+    }
+}
+
+void test_chain() {
+    Matrix a = MatrixOps.create(3, 700);
+    Matrix b = MatrixOps.create(3, 700);
+    Matrix c = MatrixOps.create(3, 700);
+    Matrix other = MatrixOps.create(2, 2);
+    double x, y, value, total;
+    size_t i, j;
+
+    MatrixOps.randomize(a, -1.0, 1.0);
+    MatrixOps.randomize(b, -1.0, 1.0);
+
+    // ((a * b)^2 + 1) * 3
+    Expression expr = ExpressionOps.create(a);
+    assert(ExpressionOps.elementWise(expr, b, MatrixOps.fBinary.mul) == 0);
+    assert(ExpressionOps.unary(expr, square) == 0);
+    assert(ExpressionOps.binary(expr, MatrixOps.fBinary.add, 1.0) == 0);
+    assert(ExpressionOps.scale(expr, 3.0) == 0);
+    assert(ExpressionOps.evaluate(expr, c) == 0);
+
+    total = 0;
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 700; j++) {
+            MatrixOps.get(a, i, j, &x);
+            MatrixOps.get(b, i, j, &y);
+            MatrixOps.get(c, i, j, &value);
+            assert(value == ((x * y) * (x * y) + 1.0) * 3.0);
+            total += value;
+        }
+    }
+
+    assert(ExpressionOps.sum(expr, &value) == 0);
+    assert(fabs(value - total) < 1e-9 * total);
+
+    // Operands and destinations must match the source
+    assert(ExpressionOps.elementWise(expr, other, MatrixOps.fBinary.mul) == -1);
+    assert(ExpressionOps.evaluate(expr, other) == -1);
+    assert(ExpressionOps.setSource(expr, other) == 0);
+    assert(ExpressionOps.evaluate(expr, other) == -1);
+
+    ExpressionOps.destroy(&expr);
+    assert(expr == NULL);
+    MatrixOps.destroy(&a);
+    MatrixOps.destroy(&b);
+    MatrixOps.destroy(&c);
+    MatrixOps.destroy(&other);
+}
+
+int main() {
+    srand(3);
+    test_softmax();
+    test_chain();
+
+    printf("All tests passed!\n");
+    return 0;
+}
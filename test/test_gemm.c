@@ -0,0 +1,732 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include "../include/matrix.h"
+#include "../include/gemm.h"
+#include "../include/thread_pool.h"
+#include "../include/simd.h"
+
+// Checks every element against the reference within the documented bound
+// 2 * k * DBL_EPSILON * (|A| * |B|).
+void assert_close(const double* c, const double* ref, const double* bound,
+    size_t m, size_t n, size_t k) {
+    for (size_t i = 0; i < m * n; i++) {
+        assert(fabs(c[i] - ref[i]) <= 2.0 * k * DBL_EPSILON * bound[i] + DBL_MIN);
+    }
+}
+
+void fill_random(double* data, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        data[i] = (double)rand() / RAND_MAX * 2.0 - 1.0;
+    }
+}
+
+void abs_copy(double* to, const double* from, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        to[i] = fabs(from[i]);
+    }
+}
+
+void check_shape(size_t m, size_t n, size_t k) {
+    Matrix a = MatrixOps.create(m, k);
+    Matrix b = MatrixOps.create(k, n);
+    double* da = malloc(m * k * sizeof(double));
+    double* db = malloc(k * n * sizeof(double));
+    double* absA = malloc(m * k * sizeof(double));
+    double* absB = malloc(k * n * sizeof(double));
+    double* ref = malloc(m * n * sizeof(double));
+    double* bound = malloc(m * n * sizeof(double));
+    double* got = malloc(m * n * sizeof(double));
+    size_t i, j;
+
+    fill_random(da, m * k);
+    fill_random(db, k * n);
+    for (i = 0; i < m; i++)
+        for (j = 0; j < k; j++)
+            MatrixOps.set(a, i, j, da[i * k + j]);
+    for (i = 0; i < k; i++)
+        for (j = 0; j < n; j++)
+            MatrixOps.set(b, i, j, db[i * n + j]);
+
+    Matrix c = MatrixOps.multiply(a, b);
+    assert(c != NULL);
+    assert(MatrixOps.getRow(c) == m);
+    assert(MatrixOps.getCol(c) == n);
+    for (i = 0; i < m; i++)
+        for (j = 0; j < n; j++)
+            MatrixOps.get(c, i, j, &got[i * n + j]);
+
+    abs_copy(absA, da, m * k);
+    abs_copy(absB, db, k * n);
+    GemmOps.dgemmReference(0, 0, m, n, k, 1.0, da, k, db, n, 0.0, ref, n);
+    GemmOps.dgemmReference(0, 0, m, n, k, 1.0, absA, k, absB, n, 0.0, bound, n);
+    assert_close(got, ref, bound, m, n, k);
+
+    MatrixOps.destroy(&a);
+    MatrixOps.destroy(&b);
+    MatrixOps.destroy(&c);
+    free(da);
+    free(db);
+    free(absA);
+    free(absB);
+    free(ref);
+    free(bound);
+    free(got);
+}
+
+void test_odd_shapes() {
+    // Shapes chosen to leave partial register tiles and partial
+    // MC/KC blocks, including k larger than GEMM_KC.
+    check_shape(1, 1, 1);
+    check_shape(1, 17, 3);
+    check_shape(7, 1, 13);
+    check_shape(5, 9, 11);
+    check_shape(13, 31, 7);
+    check_shape(97, 101, 259);
+    check_shape(GEMM_MC + 1, GEMM_NR * 3 + 5, GEMM_KC + 3);
+    check_shape(211, 3, 517);
+}
+
+void test_alpha_beta_ld() {
+    // 5x6 = 5x7 * 7x6 embedded in wider arrays, C = 0.5 * A * B + 2 * C
+    enum { M = 5, N = 6, K = 7, LDA = 9, LDB = 11, LDC = 10 };
+    double a[M * LDA], b[K * LDB], c[M * LDC], ref[M * LDC];
+    double absA[M * LDA], absB[K * LDB], bound[M * LDC];
+    size_t i;
+
+    fill_random(a, M * LDA);
+    fill_random(b, K * LDB);
+    fill_random(c, M * LDC);
+    for (i = 0; i < M * LDC; i++) ref[i] = c[i];
+    abs_copy(absA, a, M * LDA);
+    abs_copy(absB, b, K * LDB);
+    for (i = 0; i < M * LDC; i++) bound[i] = 4.0;
+
+    assert(GemmOps.dgemm(0, 0, M, N, K, 0.5, a, LDA, b, LDB, 2.0, c, LDC) == 0);
+    GemmOps.dgemmReference(0, 0, M, N, K, 0.5, a, LDA, b, LDB, 2.0, ref, LDC);
+    GemmOps.dgemmReference(0, 0, M, N, K, 1.0, absA, LDA, absB, LDB, 1.0, bound, LDC);
+
+    for (i = 0; i < M; i++) {
+        for (size_t j = 0; j < LDC; j++) {
+            assert(fabs(c[i * LDC + j] - ref[i * LDC + j])
+                <= 2.0 * K * DBL_EPSILON * bound[i * LDC + j]);
+        }
+    }
+}
+
+void check_transposed(int transA, int transB, size_t m, size_t n, size_t k) {
+    // A is stored m x k or k x m, B is stored k x n or n x k, both tightly
+    size_t lda = transA ? m : k, ldb = transB ? k : n;
+    double* a = malloc(m * k * sizeof(double));
+    double* b = malloc(k * n * sizeof(double));
+    double* absA = malloc(m * k * sizeof(double));
+    double* absB = malloc(k * n * sizeof(double));
+    double* c = malloc(m * n * sizeof(double));
+    double* ref = malloc(m * n * sizeof(double));
+    double* bound = malloc(m * n * sizeof(double));
+
+    fill_random(a, m * k);
+    fill_random(b, k * n);
+    abs_copy(absA, a, m * k);
+    abs_copy(absB, b, k * n);
+
+    assert(GemmOps.dgemm(transA, transB, m, n, k, 1.0, a, lda, b, ldb,
+        0.0, c, n) == 0);
+    GemmOps.dgemmReference(transA, transB, m, n, k, 1.0, a, lda, b, ldb,
+        0.0, ref, n);
+    GemmOps.dgemmReference(transA, transB, m, n, k, 1.0, absA, lda, absB, ldb,
+        0.0, bound, n);
+    assert_close(c, ref, bound, m, n, k);
+
+    free(a);
+    free(b);
+    free(absA);
+    free(absB);
+    free(c);
+    free(ref);
+    free(bound);
+}
+
+void test_transposed() {
+    int transA, transB;
+
+    for (transA = 0; transA < 2; transA++) {
+        for (transB = 0; transB < 2; transB++) {
+            check_transposed(transA, transB, 1, 1, 1);
+            check_transposed(transA, transB, 13, 31, 7);
+            check_transposed(transA, transB, GEMM_MC + 1, GEMM_NR * 3 + 5, GEMM_KC + 3);
+        }
+    }
+}
+
+void test_multiply_transposed() {
+    // a is 3x2, a^T * a is 2x2 and a * a^T is 3x3
+    Matrix a = MatrixOps.create(3, 2);
+    double value;
+    size_t i;
+
+    for (i = 0; i < 6; i++) MatrixOps.set(a, i / 2, i % 2, (double)(i + 1));
+
+    Matrix ata = MatrixOps.multiplyTransposed(a, 1, a, 0);
+    assert(ata != NULL);
+    assert(MatrixOps.getRow(ata) == 2 && MatrixOps.getCol(ata) == 2);
+    MatrixOps.get(ata, 0, 0, &value); assert(value == 35);
+    MatrixOps.get(ata, 0, 1, &value); assert(value == 44);
+    MatrixOps.get(ata, 1, 1, &value); assert(value == 56);
+
+    Matrix aat = MatrixOps.multiplyTransposed(a, 0, a, 1);
+    assert(aat != NULL);
+    assert(MatrixOps.getRow(aat) == 3 && MatrixOps.getCol(aat) == 3);
+    MatrixOps.get(aat, 0, 2, &value); assert(value == 17);
+    MatrixOps.get(aat, 2, 2, &value); assert(value == 61);
+
+    // Shared dimension must match after transposition
+    assert(MatrixOps.multiplyTransposed(a, 0, a, 0) == NULL);
+    assert(MatrixOps.into.multiplyTransposed(ata, a, 0, a, 1) == -1);
+
+    MatrixOps.destroy(&a);
+    MatrixOps.destroy(&ata);
+    MatrixOps.destroy(&aat);
+}
+
+void test_sgemm() {
+    // Shapes around the 6x16 float tile, both operands transposed or not
+    static const size_t shapes[][3] = {{1, 1, 1}, {6, 16, 8}, {13, 37, 300}, {100, 50, 70}};
+    size_t s, i, m, n, k;
+    int t;
+    float* a, * b, * c, * ref;
+    double bound;
+
+    for (s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+        m = shapes[s][0];
+        n = shapes[s][1];
+        k = shapes[s][2];
+        a = malloc(m * k * sizeof(float));
+        b = malloc(k * n * sizeof(float));
+        c = malloc(m * n * sizeof(float));
+        ref = malloc(m * n * sizeof(float));
+
+        // Values in [-1, 1], so |A| * |B| <= k
+        for (i = 0; i < m * k; i++) a[i] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+        for (i = 0; i < k * n; i++) b[i] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+        bound = 2.0 * k * k * FLT_EPSILON;
+
+        for (t = 0; t < 4; t++) {
+            assert(GemmOps.sgemm(t & 1, t >> 1, m, n, k, 1.0, a, (t & 1) ? m : k,
+                b, (t >> 1) ? k : n, 0.0, c, n) == 0);
+            GemmOps.sgemmReference(t & 1, t >> 1, m, n, k, 1.0, a, (t & 1) ? m : k,
+                b, (t >> 1) ? k : n, 0.0, ref, n);
+            for (i = 0; i < m * n; i++) assert(fabs(c[i] - ref[i]) <= bound);
+        }
+
+        free(a);
+        free(b);
+        free(c);
+        free(ref);
+    }
+}
+
+void test_parallel() {
+    // Above GEMM_PARALLEL_THRESHOLD, including shapes too thin for a square grid
+    static const size_t shapes[][3] = {{200, 150, 100}, {7, 2000, 300}, {1000, 9, 300}};
+    static const size_t threads[] = {2, 3, 5, 8};
+    size_t s, i, h, m, n, k, ldc;
+    int t;
+    double* a, * b, * init, * c, * serial;
+    float* af, * bf, * cf, * serialf;
+
+    for (s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+        m = shapes[s][0];
+        n = shapes[s][1];
+        k = shapes[s][2];
+        ldc = n + 3;
+        a = malloc(m * k * sizeof(double));
+        b = malloc(k * n * sizeof(double));
+        init = malloc(m * ldc * sizeof(double));
+        c = malloc(m * ldc * sizeof(double));
+        serial = malloc(m * ldc * sizeof(double));
+        fill_random(a, m * k);
+        fill_random(b, k * n);
+        fill_random(init, m * ldc);
+
+        for (t = 0; t < 4; t++) {
+            for (i = 0; i < m * ldc; i++) serial[i] = init[i];
+            assert(ThreadPoolOps.setThreadCount(1) == 0);
+            assert(GemmOps.dgemm(t & 1, t >> 1, m, n, k, 1.5, a, (t & 1) ? m : k,
+                b, (t >> 1) ? k : n, 0.5, serial, ldc) == 0);
+
+            // Blocks of whole register tiles, so the same bits
+            for (h = 0; h < sizeof(threads) / sizeof(threads[0]); h++) {
+                for (i = 0; i < m * ldc; i++) c[i] = init[i];
+                assert(ThreadPoolOps.setThreadCount(threads[h]) == 0);
+                assert(GemmOps.dgemm(t & 1, t >> 1, m, n, k, 1.5, a, (t & 1) ? m : k,
+                    b, (t >> 1) ? k : n, 0.5, c, ldc) == 0);
+                for (i = 0; i < m * ldc; i++) assert(c[i] == serial[i]);
+            }
+        }
+
+        free(a);
+        free(b);
+        free(init);
+        free(c);
+        free(serial);
+    }
+
+    m = 300;
+    n = 200;
+    k = 100;
+    af = malloc(m * k * sizeof(float));
+    bf = malloc(k * n * sizeof(float));
+    cf = malloc(m * n * sizeof(float));
+    serialf = malloc(m * n * sizeof(float));
+    for (i = 0; i < m * k; i++) af[i] = (float)rand() / RAND_MAX;
+    for (i = 0; i < k * n; i++) bf[i] = (float)rand() / RAND_MAX;
+
+    assert(ThreadPoolOps.setThreadCount(1) == 0);
+    assert(GemmOps.sgemm(0, 0, m, n, k, 1.0, af, k, bf, n, 0.0, serialf, n) == 0);
+    assert(ThreadPoolOps.setThreadCount(6) == 0);
+    assert(GemmOps.sgemm(0, 0, m, n, k, 1.0, af, k, bf, n, 0.0, cf, n) == 0);
+    for (i = 0; i < m * n; i++) assert(cf[i] == serialf[i]);
+
+    free(af);
+    free(bf);
+    free(cf);
+    free(serialf);
+    ThreadPoolOps.setThreadCount(0);
+}
+
+void check_gemv(int trans, size_t m, size_t n, size_t incx, size_t incy) {
+    size_t lx = trans ? m : n, ly = trans ? n : m, i;
+    double* a = malloc(m * (n + 1) * sizeof(double));
+    double* x = malloc(lx * incx * sizeof(double));
+    double* y = malloc(ly * incy * sizeof(double));
+    double* xc = malloc(lx * sizeof(double));
+    double* ref = malloc(ly * sizeof(double));
+    double* absA = malloc(m * (n + 1) * sizeof(double));
+    double* absX = malloc(lx * sizeof(double));
+    double* bound = malloc(ly * sizeof(double));
+
+    fill_random(a, m * (n + 1));
+    fill_random(x, lx * incx);
+    fill_random(y, ly * incy);
+    for (i = 0; i < lx; i++) xc[i] = x[i * incx];
+
+    // ref = 2 * op(A) * x + 0.5 * y, |y| <= 1 adds to the bound
+    GemmOps.dgemmReference(trans, 0, ly, 1, lx, 2.0, a, n + 1, xc, 1, 0.0, ref, 1);
+    abs_copy(absA, a, m * (n + 1));
+    abs_copy(absX, xc, lx);
+    GemmOps.dgemmReference(trans, 0, ly, 1, lx, 2.0, absA, n + 1, absX, 1, 0.0, bound, 1);
+    for (i = 0; i < ly; i++) {
+        ref[i] += 0.5 * y[i * incy];
+        bound[i] += 1.0;
+    }
+
+    assert(GemmOps.dgemv(trans, m, n, 2.0, a, n + 1, x, incx, 0.5, y, incy) == 0);
+    for (i = 0; i < ly; i++) {
+        assert(fabs(y[i * incy] - ref[i]) <= 2.0 * (lx + 2) * DBL_EPSILON * bound[i]);
+    }
+
+    free(a);
+    free(x);
+    free(y);
+    free(xc);
+    free(ref);
+    free(absA);
+    free(absX);
+    free(bound);
+}
+
+void test_gemv() {
+    static const size_t shapes[][2] = {{1, 1}, {3, 5}, {17, 33}, {64, 7}, {5, 300}};
+    size_t s, i;
+    int trans;
+    SimdLevel level;
+
+    for (level = SIMD_SCALAR; level <= SimdOps.detectedLevel(); level++) {
+        SimdOps.setLevel(level);
+        for (s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+            for (trans = 0; trans < 2; trans++) {
+                check_gemv(trans, shapes[s][0], shapes[s][1], 1, 1);
+                check_gemv(trans, shapes[s][0], shapes[s][1], 3, 2);
+            }
+        }
+    }
+    SimdOps.setLevel(SimdOps.detectedLevel());
+
+    // multiply dispatches vectors on either side to the GEMV kernel
+    check_shape(37, 1, 53);
+    check_shape(1, 41, 29);
+    check_shape(1, 1, 100);
+
+    // Single precision, against the double kernel
+    float af[12 * 20], xf[20], yf[12];
+    double ad[12 * 20], xd[20], yd[12];
+    for (i = 0; i < 12 * 20; i++) ad[i] = af[i] = (float)rand() / RAND_MAX;
+    for (i = 0; i < 20; i++) xd[i] = xf[i] = (float)rand() / RAND_MAX;
+    assert(GemmOps.sgemv(0, 12, 20, 1.0, af, 20, xf, 1, 0.0, yf, 1) == 0);
+    assert(GemmOps.dgemv(0, 12, 20, 1.0, ad, 20, xd, 1, 0.0, yd, 1) == 0);
+    for (i = 0; i < 12; i++) assert(fabs(yf[i] - yd[i]) <= 20 * FLT_EPSILON * 20);
+    assert(GemmOps.sgemv(1, 20, 12, 1.0, af, 12, xf, 1, 0.0, yf, 1) == 0);
+    assert(GemmOps.dgemv(1, 20, 12, 1.0, ad, 12, xd, 1, 0.0, yd, 1) == 0);
+    for (i = 0; i < 12; i++) assert(fabs(yf[i] - yd[i]) <= 20 * FLT_EPSILON * 20);
+
+    assert(GemmOps.dgemv(0, 3, 3, 1.0, NULL, 3, xd, 1, 0.0, yd, 1) == -1);
+}
+
+void test_gemv_parallel() {
+    // Above GEMV_PARALLEL_THRESHOLD
+    size_t m = 700, n = 500, i, t;
+    double* a = malloc(m * n * sizeof(double));
+    double* x = malloc(m * sizeof(double));
+    double* serial = malloc(m * sizeof(double));
+    double* y = malloc(m * sizeof(double));
+
+    fill_random(a, m * n);
+    fill_random(x, m);
+    for (t = 0; t < 2; t++) {
+        assert(ThreadPoolOps.setThreadCount(1) == 0);
+        assert(GemmOps.dgemv((int)t, m, n, 1.0, a, n, x, 1, 0.0, serial, 1) == 0);
+        assert(ThreadPoolOps.setThreadCount(5) == 0);
+        assert(GemmOps.dgemv((int)t, m, n, 1.0, a, n, x, 1, 0.0, y, 1) == 0);
+        for (i = 0; i < (t ? n : m); i++) assert(y[i] == serial[i]);
+    }
+
+    ThreadPoolOps.setThreadCount(0);
+    free(a);
+    free(x);
+    free(serial);
+    free(y);
+}
+
+void check_ger(size_t m, size_t n, size_t incx, size_t incy) {
+    size_t i, j, lda = n + 3;
+    double* a = malloc(m * lda * sizeof(double));
+    double* ref = malloc(m * lda * sizeof(double));
+    double* x = malloc(m * incx * sizeof(double));
+    double* y = malloc(n * incy * sizeof(double));
+
+    fill_random(a, m * lda);
+    fill_random(x, m * incx);
+    fill_random(y, n * incy);
+    for (i = 0; i < m * lda; i++) ref[i] = a[i];
+    for (i = 0; i < m; i++) {
+        for (j = 0; j < n; j++) {
+            ref[i * lda + j] += (-1.5 * x[i * incx]) * y[j * incy];
+        }
+    }
+
+    assert(GemmOps.dger(m, n, -1.5, x, incx, y, incy, a, lda) == 0);
+    for (i = 0; i < m; i++) {
+        for (j = 0; j < lda; j++) {
+            // Padding between the rows is left alone
+            assert(fabs(a[i * lda + j] - ref[i * lda + j]) <= 4 * DBL_EPSILON);
+        }
+    }
+
+    free(a);
+    free(ref);
+    free(x);
+    free(y);
+}
+
+void test_ger() {
+    static const size_t shapes[][2] = {{1, 1}, {3, 5}, {17, 33}, {64, 7}, {5, 300}};
+    size_t s, i;
+    SimdLevel level;
+
+    for (level = SIMD_SCALAR; level <= SimdOps.detectedLevel(); level++) {
+        SimdOps.setLevel(level);
+        for (s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+            check_ger(shapes[s][0], shapes[s][1], 1, 1);
+            check_ger(shapes[s][0], shapes[s][1], 2, 3);
+        }
+    }
+    SimdOps.setLevel(SimdOps.detectedLevel());
+
+    // Single precision, against the double kernel
+    float af[6 * 19], xf[6], yf[19];
+    double ad[6 * 19], xd[6], yd[19];
+    for (i = 0; i < 6 * 19; i++) ad[i] = af[i] = (float)rand() / RAND_MAX;
+    for (i = 0; i < 6; i++) xd[i] = xf[i] = (float)rand() / RAND_MAX;
+    for (i = 0; i < 19; i++) yd[i] = yf[i] = (float)rand() / RAND_MAX;
+    assert(GemmOps.sger(6, 19, 0.5, xf, 1, yf, 1, af, 19) == 0);
+    assert(GemmOps.dger(6, 19, 0.5, xd, 1, yd, 1, ad, 19) == 0);
+    for (i = 0; i < 6 * 19; i++) assert(fabs(af[i] - ad[i]) <= 4 * FLT_EPSILON);
+
+    assert(GemmOps.dger(3, 3, 1.0, xd, 1, NULL, 1, ad, 3) == -1);
+
+    // Above GEMV_PARALLEL_THRESHOLD, split by rows
+    size_t m = 600, n = 500;
+    double* a = malloc(m * n * sizeof(double));
+    double* serial = malloc(m * n * sizeof(double));
+    double* x = malloc(m * sizeof(double));
+    double* y = malloc(n * sizeof(double));
+    fill_random(a, m * n);
+    fill_random(x, m);
+    fill_random(y, n);
+    for (i = 0; i < m * n; i++) serial[i] = a[i];
+
+    assert(ThreadPoolOps.setThreadCount(1) == 0);
+    assert(GemmOps.dger(m, n, 1.0, x, 1, y, 1, serial, n) == 0);
+    assert(ThreadPoolOps.setThreadCount(5) == 0);
+    assert(GemmOps.dger(m, n, 1.0, x, 1, y, 1, a, n) == 0);
+    for (i = 0; i < m * n; i++) assert(a[i] == serial[i]);
+
+    ThreadPoolOps.setThreadCount(0);
+    free(a);
+    free(serial);
+    free(x);
+    free(y);
+}
+
+// Checks Strassen-Winograd against the naive product with the normwise bound
+// from gemm.h, |A| and |B| being at most 1
+void check_strassen(int transA, int transB, size_t m, size_t n, size_t k,
+    size_t threshold) {
+    size_t i, levels = 0, leaf = (m > n) ? m : n, ldc = n + 3;
+    double* a = malloc(m * k * sizeof(double));
+    double* b = malloc(k * n * sizeof(double));
+    double* c = malloc(m * ldc * sizeof(double));
+    double* ref = malloc(m * n * sizeof(double));
+    double bound;
+
+    fill_random(a, m * k);
+    fill_random(b, k * n);
+    fill_random(c, m * ldc);
+
+    leaf = (leaf > k) ? leaf : k;
+    for (i = 1; m / i >= threshold && n / i >= threshold && k / i >= threshold; i *= 2) {
+        levels++;
+        leaf = (leaf + 1) / 2;
+    }
+    assert(levels > 0);
+    bound = pow(18.0, (double)levels) * (leaf * leaf + 6.0 * leaf) * DBL_EPSILON;
+
+    GemmOps.setStrassenThreshold(threshold);
+    assert(GemmOps.dgemm(transA, transB, m, n, k, -0.5, a, transA ? m : k,
+        b, transB ? k : n, 0.0, c, ldc) == 0);
+    GemmOps.setStrassenThreshold(GEMM_STRASSEN_THRESHOLD);
+
+    GemmOps.dgemmReference(transA, transB, m, n, k, -0.5, a, transA ? m : k,
+        b, transB ? k : n, 0.0, ref, n);
+    for (i = 0; i < m * n; i++) {
+        assert(fabs(c[(i / n) * ldc + i % n] - ref[i]) <= 0.5 * bound);
+    }
+
+    free(a);
+    free(b);
+    free(c);
+    free(ref);
+}
+
+void test_strassen() {
+    int transA, transB;
+
+    // Odd sizes at every level, then two levels
+    check_strassen(0, 0, 33, 35, 37, 16);
+    check_strassen(0, 0, 64, 64, 64, 16);
+    check_strassen(0, 0, 97, 130, 71, 20);
+    for (transA = 0; transA < 2; transA++) {
+        for (transB = 0; transB < 2; transB++) {
+            check_strassen(transA, transB, 41, 30, 52, 12);
+        }
+    }
+
+    // Two levels with 64 x 64 leaves stay within the classical bound
+    // n^2 * DBL_EPSILON times the factor documented in gemm.h
+    size_t n = 256, leaf = 64;
+    double* sa = malloc(n * n * sizeof(double));
+    double* sb = malloc(n * n * sizeof(double));
+    double* sc = malloc(n * n * sizeof(double));
+    double* sref = malloc(n * n * sizeof(double));
+    double factor = 20.25 * (1.0 + 6.0 / leaf) - 6.0 / n;
+    fill_random(sa, n * n);
+    fill_random(sb, n * n);
+    GemmOps.setStrassenThreshold(2 * leaf);
+    assert(GemmOps.dgemm(0, 0, n, n, n, 1.0, sa, n, sb, n, 0.0, sc, n) == 0);
+    GemmOps.dgemmReference(0, 0, n, n, n, 1.0, sa, n, sb, n, 0.0, sref, n);
+    for (size_t e = 0; e < n * n; e++) {
+        // The reference's own error is within one classical bound
+        assert(fabs(sc[e] - sref[e]) <= (factor + 1.0) * n * n * DBL_EPSILON);
+    }
+    free(sa);
+    free(sb);
+    free(sc);
+    free(sref);
+
+    // Below the threshold, or reading C, the product stays classical
+    double a[20 * 20], b[20 * 20], c[20 * 20], classic[20 * 20];
+    size_t i;
+    fill_random(a, 400);
+    fill_random(b, 400);
+    GemmOps.setStrassenThreshold(0);
+    assert(GemmOps.dgemm(0, 0, 20, 20, 20, 1.0, a, 20, b, 20, 0.0, classic, 20) == 0);
+    GemmOps.setStrassenThreshold(8);
+    for (i = 0; i < 400; i++) c[i] = 0;
+    assert(GemmOps.dgemm(0, 0, 20, 20, 20, 1.0, a, 20, b, 20, 1.0, c, 20) == 0);
+    for (i = 0; i < 400; i++) assert(c[i] == classic[i]);
+    assert(GemmOps.dgemm(0, 0, 20, 20, 20, 1.0, a, 20, b, 20, 0.0, c, 20) == 0);
+    for (i = 0; i < 400; i++) assert(fabs(c[i] - classic[i]) <= 1e-12);
+
+    // Single precision
+    float af[40 * 40], bf[40 * 40], cf[40 * 40];
+    double cd[40 * 40];
+    double ad[40 * 40], bd[40 * 40];
+    for (i = 0; i < 1600; i++) ad[i] = af[i] = (float)rand() / RAND_MAX;
+    for (i = 0; i < 1600; i++) bd[i] = bf[i] = (float)rand() / RAND_MAX;
+    assert(GemmOps.sgemm(0, 0, 40, 40, 40, 1.0, af, 40, bf, 40, 0.0, cf, 40) == 0);
+    GemmOps.dgemmReference(0, 0, 40, 40, 40, 1.0, ad, 40, bd, 40, 0.0, cd, 40);
+    for (i = 0; i < 1600; i++) assert(fabs(cf[i] - cd[i]) <= 18.0 * 40 * 40 * FLT_EPSILON);
+    GemmOps.setStrassenThreshold(GEMM_STRASSEN_THRESHOLD);
+}
+
+void test_backends() {
+    // The same checks run with every backend built in, native always is
+    GemmBackend backend;
+    double a[3 * 4], x[4], y[3];
+    size_t i;
+    int trans;
+
+    for (backend = GEMM_BACKEND_NATIVE; backend <= GEMM_BACKEND_CBLAS; backend++) {
+        if (GemmOps.setBackend(backend) == -1) {
+            assert(backend != GEMM_BACKEND_NATIVE);
+            continue;
+        }
+        assert(GemmOps.getBackend() == backend);
+
+        test_odd_shapes();
+        test_alpha_beta_ld();
+        test_transposed();
+        test_multiply_transposed();
+        test_sgemm();
+        for (trans = 0; trans < 2; trans++) {
+            check_gemv(trans, 17, 33, 1, 1);
+            check_gemv(trans, 5, 300, 3, 2);
+        }
+        check_ger(17, 33, 1, 1);
+        check_ger(64, 7, 2, 3);
+
+        // y isn't read when beta is 0
+        fill_random(a, 12);
+        fill_random(x, 4);
+        for (i = 0; i < 3; i++) y[i] = NAN;
+        assert(GemmOps.dgemv(0, 3, 4, 1.0, a, 4, x, 1, 0.0, y, 1) == 0);
+        for (i = 0; i < 3; i++) assert(!isnan(y[i]));
+    }
+
+    assert(GemmOps.setBackend(GEMM_BACKEND_NATIVE) == 0);
+}
+
+#define SMALL_SIZE(K) K,
+
+void test_small() {
+    // Each size of GEMM_SMALL_SIZES, up to and past GEMM_SMALL_MAX rows
+    static const size_t sizes[] = {GEMM_SMALL_SIZES(SMALL_SIZE)};
+    enum { LD = GEMM_SMALL_MAX + 3, M = (GEMM_SMALL_MAX < 9) ? GEMM_SMALL_MAX : 9 };
+    double* a = malloc(GEMM_SMALL_MAX * LD * sizeof(double));
+    double* b = malloc(GEMM_SMALL_MAX * LD * sizeof(double));
+    double* c = malloc(GEMM_SMALL_MAX * LD * sizeof(double));
+    double* ref = malloc(GEMM_SMALL_MAX * LD * sizeof(double));
+    double* absA = malloc(GEMM_SMALL_MAX * LD * sizeof(double));
+    double* absB = malloc(GEMM_SMALL_MAX * LD * sizeof(double));
+    double* bound = malloc(GEMM_SMALL_MAX * LD * sizeof(double));
+    float* af = malloc(M * LD * sizeof(float));
+    float* bf = malloc(GEMM_SMALL_MAX * LD * sizeof(float));
+    float* cf = malloc(M * LD * sizeof(float));
+    float* reff = malloc(M * LD * sizeof(float));
+    SimdLevel level;
+    size_t s, k, i, j;
+
+    for (level = SIMD_SCALAR; level <= SimdOps.detectedLevel(); level++) {
+        SimdOps.setLevel(level);
+        for (s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+            k = sizes[s];
+            check_shape(1, 1, k);
+            check_shape(7, 1, k);
+            check_shape(GEMM_SMALL_MAX + 1, 1, k);
+            check_shape(1, k, 3);
+            check_shape(GEMM_SMALL_MAX, k, k);
+
+            // Every row summed as the generic matrix-vector kernel sums it
+            fill_random(a, GEMM_SMALL_MAX * k);
+            fill_random(b, k);
+            assert(GemmOps.dgemm(0, 0, GEMM_SMALL_MAX, 1, k, 1.0, a, k, b, 1,
+                0.0, c, 1) == 0);
+            assert(GemmOps.dgemv(0, GEMM_SMALL_MAX, k, 1.0, a, k, b, 1, 0.0,
+                ref, 1) == 0);
+            for (i = 0; i < GEMM_SMALL_MAX; i++) assert(c[i] == ref[i]);
+
+            // Padded operands with alpha and beta, C = 0.5 * A * B + 2 * C
+            fill_random(a, M * LD);
+            fill_random(b, k * LD);
+            fill_random(c, M * LD);
+            for (i = 0; i < M * LD; i++) ref[i] = c[i];
+            for (i = 0; i < M * LD; i++) bound[i] = 4.0;
+            assert(GemmOps.dgemm(0, 0, M, k, k, 0.5, a, LD, b, LD, 2.0, c, LD) == 0);
+            GemmOps.dgemmReference(0, 0, M, k, k, 0.5, a, LD, b, LD, 2.0, ref, LD);
+            abs_copy(absA, a, M * LD);
+            abs_copy(absB, b, k * LD);
+            GemmOps.dgemmReference(0, 0, M, k, k, 1.0, absA, LD, absB, LD, 1.0,
+                bound, LD);
+            for (i = 0; i < M * LD; i++) {
+                assert(fabs(c[i] - ref[i]) <= 2.0 * k * DBL_EPSILON * bound[i]);
+            }
+
+            // With beta 0, C is not read
+            for (i = 0; i < M; i++) {
+                for (j = 0; j < k; j++) c[i * LD + j] = NAN;
+            }
+            assert(GemmOps.dgemm(0, 0, M, 1, k, 1.0, a, LD, b, 1, 0.0, c, LD) == 0);
+            assert(GemmOps.dgemm(0, 0, M, k, 3, 1.0, a, LD, b, LD, 0.0, c + 1,
+                LD) == 0);
+            for (i = 0; i < M; i++) {
+                for (j = 0; j < k; j++) assert(!isnan(c[i * LD + j]));
+            }
+
+            for (i = 0; i < M * LD; i++) af[i] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+            for (i = 0; i < k * LD; i++) bf[i] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+            assert(GemmOps.sgemm(0, 0, M, k, k, 1.0, af, LD, bf, LD, 0.0, cf, LD) == 0);
+            GemmOps.sgemmReference(0, 0, M, k, k, 1.0, af, LD, bf, LD, 0.0, reff, LD);
+            for (i = 0; i < M; i++) {
+                for (j = 0; j < k; j++) {
+                    assert(fabs(cf[i * LD + j] - reff[i * LD + j])
+                        <= 2.0 * k * k * FLT_EPSILON);
+                }
+            }
+        }
+    }
+    SimdOps.setLevel(SimdOps.detectedLevel());
+
+    free(a);
+    free(b);
+    free(c);
+    free(ref);
+    free(absA);
+    free(absB);
+    free(bound);
+    free(af);
+    free(bf);
+    free(cf);
+    free(reff);
+}
+
+int main() {
+    srand(42);
+    test_odd_shapes();
+    test_alpha_beta_ld();
+    test_transposed();
+    test_multiply_transposed();
+    test_sgemm();
+    test_small();
+    test_parallel();
+    test_gemv();
+    test_gemv_parallel();
+    test_ger();
+    test_strassen();
+    test_backends();
+
+    printf("All tests passed!\n");
+    return 0;
+}
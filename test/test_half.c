@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include "../include/half.h"
+#include "../include/matrix.h"
+#include "../include/thread_pool.h"
+#include "../include/simd.h"
+
+Matrix random_matrix(size_t row, size_t col) {
+    Matrix matrix = MatrixOps.create(row, col);
+
+    MatrixOps.randomize(matrix, -2.0, 2.0);
+    return matrix;
+}
+
+void test_encoding() {
+    HalfFormat format;
+    uint16_t h, next, mask;
+    double value, above, midpoint;
+
+    // Known fp16 values
+    assert(HalfOps.decode(0x3C00, HALF_FP16) == 1.0);
+    assert(HalfOps.decode(0xC000, HALF_FP16) == -2.0);
+    assert(HalfOps.decode(0x7BFF, HALF_FP16) == 65504.0);
+    assert(HalfOps.decode(0x0001, HALF_FP16) == ldexp(1.0, -24));
+    assert(HalfOps.decode(0x7C00, HALF_FP16) == INFINITY);
+    assert(HalfOps.decode(0x3F80, HALF_BF16) == 1.0);
+    assert(HalfOps.encode(1e6, HALF_FP16) == 0x7C00);
+    assert(HalfOps.encode(-1e6, HALF_FP16) == 0xFC00);
+    assert(HalfOps.encode(65519.0, HALF_FP16) == 0x7BFF);
+    assert(HalfOps.encode(65520.0, HALF_FP16) == 0x7C00);
+    assert(HalfOps.encode(1e6, HALF_BF16) != 0x7F80);
+    assert(isnan(HalfOps.decode(HalfOps.encode(NAN, HALF_BF16), HALF_BF16)));
+
+    // Every finite encoding reads back exactly, and values between two
+    // neighbours round to the nearest one, ties to the even one
+    for (format = HALF_FP16; format <= HALF_BF16; format++) {
+        mask = (format == HALF_FP16) ? 0x7C00 : 0x7F80;
+        for (h = 0; h < 0x8000; h++) {
+            if ((h & mask) == mask) {
+                continue;
+            }
+            value = HalfOps.decode(h, format);
+            assert(HalfOps.encode(value, format) == h);
+            assert(HalfOps.encode(-value, format) == (h | 0x8000));
+
+            next = h + 1;
+            if ((next & mask) == mask) {
+                continue;
+            }
+            above = HalfOps.decode(next, format);
+            midpoint = value + (above - value) / 2;
+            assert(HalfOps.encode(midpoint, format)
+                == ((h & 1) ? next : h));
+            assert(HalfOps.encode(nextafter(midpoint, 0), format) == h);
+            assert(HalfOps.encode(nextafter(midpoint, INFINITY), format)
+                == next);
+        }
+    }
+}
+
+void test_conversion() {
+    Matrix matrix = random_matrix(9, 37), back;
+    HalfFormat format;
+    Half half;
+    double value, expected;
+    size_t i, j;
+
+    for (format = HALF_FP16; format <= HALF_BF16; format++) {
+        half = HalfOps.fromMatrix(matrix, format);
+        assert(half != NULL && HalfOps.getFormat(half) == format);
+        assert(HalfOps.getRow(half) == 9 && HalfOps.getCol(half) == 37);
+
+        // Relative error at most half an ulp of the format
+        back = HalfOps.toMatrix(half);
+        for (i = 0; i < 9; i++) {
+            for (j = 0; j < 37; j++) {
+                MatrixOps.get(matrix, i, j, &expected);
+                MatrixOps.get(back, i, j, &value);
+                assert(fabs(value - expected) <= fabs(expected)
+                    * ((format == HALF_FP16) ? 0x1p-11 : 0x1p-8));
+                HalfOps.get(half, i, j, &expected);
+                assert(value == expected);
+            }
+        }
+        MatrixOps.destroy(&back);
+        HalfOps.destroy(&half);
+    }
+
+    assert(HalfOps.create(0, 1, HALF_FP16) == NULL);
+    assert(HalfOps.create(1, 1, (HalfFormat)5) == NULL);
+    assert(HalfOps.fromMatrix(NULL, HALF_BF16) == NULL);
+    half = HalfOps.create(3, 3, HALF_FP16);
+    assert(HalfOps.get(half, 0, 3, &value) == -1);
+    assert(HalfOps.into.fromMatrix(half, matrix) == -1);
+    HalfOps.destroy(&half);
+    assert(half == NULL);
+    MatrixOps.destroy(&matrix);
+}
+
+// The product equals the double product of the widened matrix up to the
+// summation order
+void check_multiply(HalfFormat format, size_t m, size_t k, size_t n) {
+    Matrix a = random_matrix(m, k), b = random_matrix(k, n);
+    Half half = HalfOps.fromMatrix(a, format);
+    Matrix widened = HalfOps.toMatrix(half);
+    Matrix expected = MatrixOps.multiply(widened, b);
+    Matrix result = HalfOps.multiply(half, b);
+    double value1, value2;
+    size_t i, j;
+
+    assert(result != NULL);
+    for (i = 0; i < m; i++) {
+        for (j = 0; j < n; j++) {
+            MatrixOps.get(result, i, j, &value1);
+            MatrixOps.get(expected, i, j, &value2);
+            assert(fabs(value1 - value2) <= 2.0 * k * DBL_EPSILON * 4.0 * k);
+        }
+    }
+
+    HalfOps.destroy(&half);
+    MatrixOps.destroy(&a);
+    MatrixOps.destroy(&b);
+    MatrixOps.destroy(&widened);
+    MatrixOps.destroy(&expected);
+    MatrixOps.destroy(&result);
+}
+
+void test_multiply() {
+    SimdLevel level;
+    HalfFormat format;
+    Matrix a, b, dst;
+    Half half;
+
+    for (level = SIMD_SCALAR; level <= SimdOps.detectedLevel(); level++) {
+        SimdOps.setLevel(level);
+        for (format = HALF_FP16; format <= HALF_BF16; format++) {
+            check_multiply(format, 1, 1, 1);
+            check_multiply(format, 7, 29, 1);
+            check_multiply(format, 64, 100, 1);
+            check_multiply(format, 70, 33, 5);
+        }
+    }
+    SimdOps.setLevel(SimdOps.detectedLevel());
+
+    // Into a padded destination, and the dimension and alias checks
+    a = random_matrix(6, 6);
+    b = random_matrix(6, 5);
+    dst = MatrixOps.createPadded(6, 5, 16);
+    half = HalfOps.fromMatrix(a, HALF_FP16);
+    assert(HalfOps.into.multiply(dst, half, b) == 0);
+    assert(HalfOps.into.multiply(dst, half, a) == -1);
+    assert(HalfOps.into.multiply(a, half, a) == -1);
+    assert(HalfOps.multiply(NULL, b) == NULL);
+
+    HalfOps.destroy(&half);
+    MatrixOps.destroy(&a);
+    MatrixOps.destroy(&b);
+    MatrixOps.destroy(&dst);
+
+    // A copy of the matrix shares its data until written, but isn't an alias
+    a = random_matrix(40, 40);
+    b = random_matrix(40, 40);
+    half = HalfOps.fromMatrix(a, HALF_BF16);
+    dst = MatrixOps.copy(b);
+    assert(HalfOps.into.multiply(dst, half, b) == 0);
+    assert(MatrixOps.getDataConst(dst) != MatrixOps.getDataConst(b));
+
+    HalfOps.destroy(&half);
+    MatrixOps.destroy(&a);
+    MatrixOps.destroy(&b);
+    MatrixOps.destroy(&dst);
+}
+
+void test_parallel() {
+    // Above HALF_PARALLEL_THRESHOLD
+    Matrix a = random_matrix(601, 500), x = random_matrix(500, 1);
+    Half half = HalfOps.fromMatrix(a, HALF_BF16);
+    Matrix serial, result;
+    size_t i;
+
+    assert(ThreadPoolOps.setThreadCount(1) == 0);
+    serial = HalfOps.multiply(half, x);
+    assert(ThreadPoolOps.setThreadCount(5) == 0);
+    result = HalfOps.multiply(half, x);
+    for (i = 0; i < 601; i++) {
+        assert(MatrixOps.getData(serial)[i * MatrixOps.getLd(serial)]
+            == MatrixOps.getData(result)[i * MatrixOps.getLd(result)]);
+    }
+
+    ThreadPoolOps.setThreadCount(0);
+    HalfOps.destroy(&half);
+    MatrixOps.destroy(&a);
+    MatrixOps.destroy(&x);
+    MatrixOps.destroy(&serial);
+    MatrixOps.destroy(&result);
+}
+
+int main() {
+    test_encoding();
+    test_conversion();
+    test_multiply();
+    test_parallel();
+
+    printf("All tests passed!\n");
+    return 0;
+}
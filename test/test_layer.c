@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <assert.h>
+#include <math.h>
+#include "../include/layer.h"
+#include "../include/activation.h"
+#include "../include/random.h"
+#include "../include/arena.h"
+
+void test_float() {
+    Layer layer = LayerOps.create(24, 16, ActivationOps.f.sigmoid,
+        ActivationOps.derivative.sigmoid);
+    Layer layerF = LayerOps.createWithPrecision(24, 16,
+        ActivationOps.f.sigmoid, ActivationOps.derivative.sigmoid,
+        MATRIX_FLOAT);
+    Matrix input = MatrixOps.create(24, 1), output = MatrixOps.create(16, 1);
+    MatrixF inputF, outputF = MatrixFOps.create(16, 1);
+    double value;
+    float valueF;
+    size_t i;
+
+    assert(layer != NULL && layerF != NULL);
+    assert(LayerOps.getPrecision(layerF) == MATRIX_FLOAT);
+    assert(LayerOps.getWeights(layerF) == NULL);
+    assert(LayerOps.getWeightsF(layer) == NULL);
+    assert(MatrixFOps.getRow(LayerOps.getWeightsF(layerF)) == 16);
+
+    // Same weights and input, rounded to float
+    assert(LayerOps.setWeights(layerF, LayerOps.getWeights(layer)) == 0);
+    assert(RandomOps.matrix.uniform(input, 5, 0, -1.0, 1.0) == 0);
+    inputF = MatrixFOps.convert(input);
+    assert(inputF != NULL);
+
+    assert(LayerOps.feedForward(layer, input, output) == 0);
+    assert(LayerOps.feedForwardF(layerF, inputF, outputF) == 0);
+    for (i = 0; i < 16; i++) {
+        MatrixOps.get(output, i, 0, &value);
+        MatrixFOps.get(outputF, i, 0, &valueF);
+        assert(fabs(value - valueF) < 1e-5);
+    }
+
+    // Each precision has its own entry point, and float layers don't train
+    assert(LayerOps.feedForward(layerF, input, output) == -1);
+    assert(LayerOps.feedForwardF(layer, inputF, outputF) == -1);
+    assert(LayerOps.calculateActivationDeriv(layerF, input) == NULL);
+
+    LayerOps.destroy(&layer);
+    LayerOps.destroy(&layerF);
+    MatrixOps.destroy(&input);
+    MatrixOps.destroy(&output);
+    MatrixFOps.destroy(&inputF);
+    MatrixFOps.destroy(&outputF);
+}
+
+void test_quantized() {
+    Layer layer = LayerOps.create(24, 16, ActivationOps.f.sigmoid,
+        ActivationOps.derivative.sigmoid);
+    Layer layerQ = LayerOps.createWithPrecision(24, 16,
+        ActivationOps.f.sigmoid, ActivationOps.derivative.sigmoid,
+        MATRIX_INT8);
+    Matrix input = MatrixOps.create(24, 1), output = MatrixOps.create(16, 1);
+    Matrix outputQ = MatrixOps.create(16, 1), expected = MatrixOps.create(16, 1);
+    double value, valueQ;
+    size_t i;
+
+    assert(layer != NULL && layerQ != NULL);
+    assert(LayerOps.getWeights(layerQ) == NULL);
+    assert(LayerOps.getWeightsQ(layer) == NULL);
+    assert(LayerOps.setWeights(layerQ, LayerOps.getWeights(layer)) == 0);
+    assert(RandomOps.matrix.uniform(input, 6, 0, -1.0, 1.0) == 0);
+
+    // The product runs on the int8 weights, then the activation
+    assert(LayerOps.feedForward(layerQ, input, outputQ) == 0);
+    assert(QuantizedOps.into.multiply(expected, LayerOps.getWeightsQ(layerQ),
+        input) == 0);
+    assert(MatrixOps.applyToAllUnary(expected, ActivationOps.f.sigmoid) == 0);
+    assert(LayerOps.feedForward(layer, input, output) == 0);
+    for (i = 0; i < 16; i++) {
+        MatrixOps.get(outputQ, i, 0, &valueQ);
+        MatrixOps.get(expected, i, 0, &value);
+        assert(valueQ == value);
+        MatrixOps.get(output, i, 0, &value);
+        assert(fabs(value - valueQ) < 0.02);
+    }
+
+    // Quantizing the double layer gives the same layer
+    assert(LayerOps.quantize(layer) == 0);
+    assert(LayerOps.getPrecision(layer) == MATRIX_INT8);
+    assert(LayerOps.getWeights(layer) == NULL);
+    assert(LayerOps.feedForward(layer, input, output) == 0);
+    for (i = 0; i < 16; i++) {
+        MatrixOps.get(outputQ, i, 0, &valueQ);
+        MatrixOps.get(output, i, 0, &value);
+        assert(valueQ == value);
+    }
+    assert(LayerOps.calculateActivationDeriv(layer, input) == NULL);
+
+    LayerOps.destroy(&layer);
+    LayerOps.destroy(&layerQ);
+    MatrixOps.destroy(&input);
+    MatrixOps.destroy(&output);
+    MatrixOps.destroy(&outputQ);
+    MatrixOps.destroy(&expected);
+}
+
+static double weight_variance(const Matrix weights) {
+    size_t i, j, row = MatrixOps.getRow(weights), col = MatrixOps.getCol(weights);
+    double value, sum = 0.0, squares = 0.0, mean;
+
+    for (i = 0; i < row; i++) {
+        for (j = 0; j < col; j++) {
+            MatrixOps.get(weights, i, j, &value);
+            sum += value;
+            squares += value * value;
+        }
+    }
+    mean = sum / (row * col);
+
+    return squares / (row * col) - mean * mean;
+}
+
+void test_initialize() {
+    // He for the rectifiers, Xavier otherwise
+    Layer xavier = LayerOps.create(400, 300, ActivationOps.f.tanh,
+        ActivationOps.derivative.tanh);
+    Layer he = LayerOps.create(400, 300, ActivationOps.f.relu,
+        ActivationOps.derivative.relu);
+    Layer layerF = LayerOps.createWithPrecision(400, 300,
+        ActivationOps.f.tanh, ActivationOps.derivative.tanh, MATRIX_FLOAT);
+    double variance, value;
+    float valueF;
+    size_t i, j;
+
+    variance = weight_variance(LayerOps.getWeights(xavier));
+    assert(fabs(variance / (2.0 / (400 + 300)) - 1.0) < 0.03);
+    variance = weight_variance(LayerOps.getWeights(he));
+    assert(fabs(variance / (2.0 / 400) - 1.0) < 0.03);
+
+    // The same seed and stream give the same weights at either precision
+    assert(LayerOps.initialize(xavier, LAYER_INIT_HE, 7, 3) == 0);
+    assert(LayerOps.initialize(layerF, LAYER_INIT_HE, 7, 3) == 0);
+    variance = weight_variance(LayerOps.getWeights(xavier));
+    assert(fabs(variance / (2.0 / 400) - 1.0) < 0.03);
+    for (i = 0; i < 300; i++) {
+        for (j = 0; j < 400; j++) {
+            MatrixOps.get(LayerOps.getWeights(xavier), i, j, &value);
+            MatrixFOps.get(LayerOps.getWeightsF(layerF), i, j, &valueF);
+            assert(valueF == (float)value);
+        }
+    }
+    assert(LayerOps.initialize(he, 2, 7, 3) == -1);
+
+    LayerOps.destroy(&xavier);
+    LayerOps.destroy(&he);
+    LayerOps.destroy(&layerF);
+}
+
+// The per-datapoint work of gradientDescentStep, its temporaries taken from
+// arena when not NULL and dropped after each datapoint
+static void accumulate(Layer layer, Matrix* inputs, size_t count,
+    Matrix gradient, Matrix jacobianSum, Arena arena) {
+    Arena previous = ArenaOps.use(arena);
+    ArenaMark start = arena ? ArenaOps.mark(arena) : (ArenaMark){0};
+    Matrix deriv, jacobian;
+    size_t k;
+
+    for (k = 0; k < count; k++) {
+        deriv = LayerOps.calculateActivationDeriv(layer, inputs[k]);
+        jacobian = LayerOps.jacobian(layer, inputs[k]);
+        assert(deriv != NULL && jacobian != NULL);
+        assert(MatrixOps.rankOneUpdate(gradient, 1.0, deriv, inputs[k]) == 0);
+        assert(MatrixOps.add(jacobianSum, jacobian) == 0);
+        MatrixOps.destroy(&deriv);
+        MatrixOps.destroy(&jacobian);
+
+        if (arena) {
+            assert(ArenaOps.used(arena) > 0);
+            ArenaOps.reset(arena, start);
+            assert(ArenaOps.used(arena) == 0);
+        }
+    }
+
+    assert(ArenaOps.use(previous) == arena);
+}
+
+void test_training_step() {
+    Layer layer = LayerOps.create(30, 20, ActivationOps.f.tanh,
+        ActivationOps.derivative.tanh);
+    Arena arena = ArenaOps.create(0);
+    Matrix inputs[4], gradients[2], jacobians[2], before;
+    double value, expected, g;
+    size_t i, j, k;
+
+    for (k = 0; k < 4; k++) {
+        inputs[k] = MatrixOps.create(30, 1);
+        assert(RandomOps.matrix.uniform(inputs[k], 9, k, -1.0, 1.0) == 0);
+    }
+    for (k = 0; k < 2; k++) {
+        gradients[k] = MatrixOps.create(20, 30);
+        jacobians[k] = MatrixOps.create(20, 30);
+        MatrixOps.fill(gradients[k], 0.0);
+        MatrixOps.fill(jacobians[k], 0.0);
+    }
+
+    // Heap results accumulated through arena temporaries match the heap run
+    accumulate(layer, inputs, 4, gradients[0], jacobians[0], NULL);
+    accumulate(layer, inputs, 4, gradients[1], jacobians[1], arena);
+    for (i = 0; i < 20; i++) {
+        for (j = 0; j < 30; j++) {
+            MatrixOps.get(gradients[0], i, j, &expected);
+            MatrixOps.get(gradients[1], i, j, &value);
+            assert(value == expected);
+            MatrixOps.get(jacobians[0], i, j, &expected);
+            MatrixOps.get(jacobians[1], i, j, &value);
+            assert(value == expected);
+        }
+    }
+
+    // W -= learningRate * gradient, the gradient left as it was
+    before = MatrixOps.copy(LayerOps.getWeights(layer));
+    assert(LayerOps.updateWeights(layer, gradients[1], 0.5) == 0);
+    for (i = 0; i < 20; i++) {
+        for (j = 0; j < 30; j++) {
+            MatrixOps.get(before, i, j, &expected);
+            MatrixOps.get(gradients[1], i, j, &g);
+            MatrixOps.get(LayerOps.getWeights(layer), i, j, &value);
+            assert(fabs(value - (expected - 0.5 * g)) < 1e-15);
+            MatrixOps.get(gradients[0], i, j, &expected);
+            assert(g == expected);
+        }
+    }
+
+    for (k = 0; k < 4; k++) MatrixOps.destroy(&inputs[k]);
+    for (k = 0; k < 2; k++) {
+        MatrixOps.destroy(&gradients[k]);
+        MatrixOps.destroy(&jacobians[k]);
+    }
+    MatrixOps.destroy(&before);
+    LayerOps.destroy(&layer);
+    ArenaOps.destroy(&arena);
+}
+
+int main() {
+    test_float();
+    test_quantized();
+    test_initialize();
+    test_training_step();
+
+    printf("All tests passed!\n");
+    return 0;
+}
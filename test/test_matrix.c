@@ -1,6 +1,10 @@
 #include <stdio.h>
+#include <stdint.h>
 #include <assert.h>
+#include <float.h>
+#include <math.h>
 #include "../include/matrix.h"
+#include "../include/thread_pool.h"
 
 void test_create_destroy() {
     Matrix matrix = MatrixOps.create(3, 3);
@@ -219,6 +223,85 @@ void test_multiply() {
     MatrixOps.destroy(&result);
 }
 
+void test_rank_one_update() {
+    Matrix matrix = MatrixOps.createPadded(3, 2, 5);
+    Matrix u = MatrixOps.create(3, 1);
+    Matrix v = MatrixOps.create(1, 2);
+    Matrix column = MatrixOps.create(2, 1);
+    Matrix wrong = MatrixOps.create(2, 2);
+    double value;
+    size_t i, j;
+
+    MatrixOps.fill(matrix, 1.0);
+    for (i = 0; i < 3; i++) MatrixOps.set(u, i, 0, i + 1.0);
+    for (j = 0; j < 2; j++) MatrixOps.set(v, 0, j, j + 3.0);
+
+    // matrix += 2 * u * v^T, with v as a row then as a column
+    assert(MatrixOps.rankOneUpdate(matrix, 2.0, u, v) == 0);
+    MatrixOps.into.transpose(column, v);
+    assert(MatrixOps.rankOneUpdate(matrix, 2.0, u, column) == 0);
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 2; j++) {
+            MatrixOps.get(matrix, i, j, &value);
+            assert(value == 1.0 + 4.0 * (i + 1) * (j + 3));
+        }
+    }
+
+    assert(MatrixOps.rankOneUpdate(matrix, 1.0, v, u) == -1);
+    assert(MatrixOps.rankOneUpdate(matrix, 1.0, u, wrong) == -1);
+    assert(MatrixOps.rankOneUpdate(NULL, 1.0, u, v) == -1);
+
+    MatrixOps.destroy(&matrix);
+    MatrixOps.destroy(&u);
+    MatrixOps.destroy(&v);
+    MatrixOps.destroy(&column);
+    MatrixOps.destroy(&wrong);
+}
+
+void test_gradient_accumulation() {
+    // A 256x784 weight gradient accumulated over three datapoints, the row
+    // vector derivative times the column vector input of each
+    Matrix gradient = MatrixOps.create(256, 784);
+    Matrix expected = MatrixOps.create(256, 784);
+    Matrix outer = MatrixOps.create(256, 784);
+    Matrix deriv = MatrixOps.create(1, 256), input = MatrixOps.create(784, 1);
+    double value, d, x;
+    size_t i, j, k;
+
+    MatrixOps.fill(gradient, 0.0);
+    MatrixOps.fill(expected, 0.0);
+    for (k = 0; k < 3; k++) {
+        MatrixOps.randomize(deriv, -1.0, 1.0);
+        MatrixOps.randomize(input, -1.0, 1.0);
+        assert(MatrixOps.rankOneUpdate(gradient, 1.0, deriv, input) == 0);
+
+        // The outer product built element by element, then added
+        for (i = 0; i < 256; i++) {
+            MatrixOps.get(deriv, 0, i, &d);
+            for (j = 0; j < 784; j++) {
+                MatrixOps.get(input, j, 0, &x);
+                MatrixOps.set(outer, i, j, d * x);
+            }
+        }
+        assert(MatrixOps.add(expected, outer) == 0);
+    }
+
+    // Fused multiply-adds round once where the loop rounds twice
+    for (i = 0; i < 256; i++) {
+        for (j = 0; j < 784; j++) {
+            MatrixOps.get(gradient, i, j, &value);
+            MatrixOps.get(expected, i, j, &d);
+            assert(fabs(value - d) <= 4 * DBL_EPSILON * 3.0);
+        }
+    }
+
+    MatrixOps.destroy(&gradient);
+    MatrixOps.destroy(&expected);
+    MatrixOps.destroy(&outer);
+    MatrixOps.destroy(&deriv);
+    MatrixOps.destroy(&input);
+}
+
 
 void test_transpose() {
     //Thank you test_transpose() for the help.
@@ -250,6 +333,721 @@ void test_transpose() {
     MatrixOps.destroy(&result);
 }
 
+void test_transpose_in_place() {
+    Matrix matrix = MatrixOps.create(3, 3);
+    Matrix rect = MatrixOps.create(2, 3);
+    double value;
+    size_t i;
+
+    for (i = 0; i < 9; i++) MatrixOps.set(matrix, i / 3, i % 3, (double)i);
+
+    assert(MatrixOps.transposeInPlace(matrix) == 0);
+    for (i = 0; i < 9; i++) {
+        MatrixOps.get(matrix, i % 3, i / 3, &value);
+        assert(value == (double)i);
+    }
+
+    // Same through into.transpose with the matrix as its own destination
+    assert(MatrixOps.into.transpose(matrix, matrix) == 0);
+    MatrixOps.get(matrix, 0, 1, &value);
+    assert(value == 1.0);
+
+    assert(MatrixOps.transposeInPlace(rect) == -1);
+
+    // Views at the same origin are only in place when square
+    Matrix base = MatrixOps.create(6, 6);
+    for (i = 0; i < 36; i++) MatrixOps.set(base, i / 6, i % 6, i / 6 * 10.0 + i % 6);
+    Matrix src = MatrixOps.view(base, 0, 0, 2, 3);
+    Matrix dst = MatrixOps.view(base, 0, 0, 3, 2);
+    assert(MatrixOps.into.transpose(dst, src) == -1);
+    for (i = 0; i < 36; i++) {
+        MatrixOps.get(base, i / 6, i % 6, &value);
+        assert(value == i / 6 * 10.0 + i % 6);
+    }
+
+    MatrixOps.destroy(&src);
+    MatrixOps.destroy(&dst);
+    MatrixOps.destroy(&base);
+    MatrixOps.destroy(&matrix);
+    MatrixOps.destroy(&rect);
+}
+
+void test_padded() {
+    // 512 columns get a padded stride, createPadded sets one explicitly
+    Matrix wide = MatrixOps.create(3, 512);
+    Matrix padded = MatrixOps.createPadded(3, 512, 600);
+    Matrix result;
+    double value, total;
+    size_t i, j;
+
+    assert(MatrixOps.createPadded(3, 4, 3) == NULL);
+
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 512; j++) {
+            MatrixOps.set(wide, i, j, (double)(i * 512 + j));
+        }
+    }
+    assert(MatrixOps.assignValues(padded, wide) == 0);
+    assert(MatrixOps.add(padded, wide) == 0);
+    MatrixOps.get(padded, 2, 511, &value);
+    assert(value == 2.0 * (2 * 512 + 511));
+
+    assert(MatrixOps.fill(wide, 1.0) == 0);
+    assert(MatrixOps.sum(wide, &total) == 0);
+    assert(total == 3 * 512);
+
+    result = MatrixOps.transpose(padded);
+    assert(result != NULL);
+    MatrixOps.get(result, 511, 2, &value);
+    assert(value == 2.0 * (2 * 512 + 511));
+
+    MatrixOps.destroy(&wide);
+    MatrixOps.destroy(&padded);
+    MatrixOps.destroy(&result);
+}
+
+void test_into() {
+    Matrix matrix1 = MatrixOps.create(2, 3);
+    Matrix matrix2 = MatrixOps.create(3, 2);
+    Matrix product = MatrixOps.create(2, 2);
+    Matrix transposed = MatrixOps.create(3, 2);
+    Matrix sum = MatrixOps.create(3, 2);
+    double value;
+
+    MatrixOps.set(matrix1, 0, 0, 1.0);
+    MatrixOps.set(matrix1, 0, 1, 2.0);
+    MatrixOps.set(matrix1, 0, 2, 3.0);
+    MatrixOps.set(matrix1, 1, 0, 4.0);
+    MatrixOps.set(matrix1, 1, 1, 5.0);
+    MatrixOps.set(matrix1, 1, 2, 6.0);
+
+    MatrixOps.set(matrix2, 0, 0, 7.0);
+    MatrixOps.set(matrix2, 0, 1, 8.0);
+    MatrixOps.set(matrix2, 1, 0, 9.0);
+    MatrixOps.set(matrix2, 1, 1, 10.0);
+    MatrixOps.set(matrix2, 2, 0, 11.0);
+    MatrixOps.set(matrix2, 2, 1, 12.0);
+
+    assert(MatrixOps.into.multiply(product, matrix1, matrix2) == 0);
+    MatrixOps.get(product, 0, 0, &value);
+    assert(value == 58.0);
+    MatrixOps.get(product, 1, 1, &value);
+    assert(value == 154.0);
+
+    assert(MatrixOps.into.transpose(transposed, matrix1) == 0);
+    MatrixOps.get(transposed, 2, 1, &value);
+    assert(value == 6.0);
+    MatrixOps.get(transposed, 1, 0, &value);
+    assert(value == 2.0);
+
+    assert(MatrixOps.into.add(sum, transposed, matrix2) == 0);
+    MatrixOps.get(sum, 2, 0, &value);
+    assert(value == 14.0);
+
+    // The destination may be an operand of element-wise operations
+    assert(MatrixOps.into.elementWise(sum, sum, matrix2, MatrixOps.fBinary.mul) == 0);
+    MatrixOps.get(sum, 2, 0, &value);
+    assert(value == 154.0);
+
+    assert(MatrixOps.into.applyToAllBinary(sum, matrix2, MatrixOps.fBinary.add, 1.0) == 0);
+    MatrixOps.get(sum, 0, 1, &value);
+    assert(value == 9.0);
+
+    // Wrong shapes and aliasing products are rejected
+    assert(MatrixOps.into.multiply(sum, matrix1, matrix2) == -1);
+    assert(MatrixOps.into.transpose(product, matrix1) == -1);
+    assert(MatrixOps.into.add(product, matrix1, matrix1) == -1);
+    assert(MatrixOps.into.multiply(product, product, product) == -1);
+
+    MatrixOps.destroy(&matrix1);
+    MatrixOps.destroy(&matrix2);
+    MatrixOps.destroy(&product);
+    MatrixOps.destroy(&transposed);
+    MatrixOps.destroy(&sum);
+}
+
+void test_view() {
+    Matrix matrix = MatrixOps.create(4, 5);
+    double value;
+    size_t i, j;
+
+    for (i = 0; i < 4; i++)
+        for (j = 0; j < 5; j++)
+            MatrixOps.set(matrix, i, j, i * 10.0 + j);
+
+    Matrix view = MatrixOps.view(matrix, 1, 1, 2, 3);
+    assert(view != NULL);
+    assert(MatrixOps.getRow(view) == 2);
+    assert(MatrixOps.getCol(view) == 3);
+    MatrixOps.get(view, 0, 0, &value);
+    assert(value == 11.0);
+    MatrixOps.get(view, 1, 2, &value);
+    assert(value == 23.0);
+
+    MatrixOps.sum(view, &value);
+    assert(value == 11 + 12 + 13 + 21 + 22 + 23);
+
+    // Writes go through to the parent and stay inside the block
+    MatrixOps.scalarMultiply(view, -1.0);
+    MatrixOps.get(matrix, 1, 1, &value);
+    assert(value == -11.0);
+    MatrixOps.get(matrix, 1, 4, &value);
+    assert(value == 14.0);
+    MatrixOps.get(matrix, 3, 1, &value);
+    assert(value == 31.0);
+
+    // A strided view as a product operand matches a contiguous copy
+    Matrix block = MatrixOps.copySubMatrix(matrix, 1, 2, 1, 3);
+    Matrix other = MatrixOps.view(matrix, 0, 2, 3, 2);
+    Matrix fromView = MatrixOps.multiply(view, other);
+    Matrix otherCopy = MatrixOps.copy(other);
+    Matrix fromCopy = MatrixOps.multiply(block, otherCopy);
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < 2; j++) {
+            double expected;
+            MatrixOps.get(fromView, i, j, &value);
+            MatrixOps.get(fromCopy, i, j, &expected);
+            assert(value == expected);
+        }
+    }
+
+    // Products can't be written over their own operands
+    assert(MatrixOps.into.multiply(other, view, block) == -1);
+    assert(MatrixOps.overlaps(other, view) == 1);
+    assert(MatrixOps.overlaps(block, matrix) == 0);
+
+    assert(MatrixOps.moveView(view, 2, 2) == 0);
+    MatrixOps.get(view, 1, 2, &value);
+    assert(value == 34.0);
+    assert(MatrixOps.moveView(view, 3, 0) == -1);
+    assert(MatrixOps.view(matrix, 2, 0, 3, 1) == NULL);
+
+    MatrixOps.destroy(&view);
+    MatrixOps.destroy(&other);
+    MatrixOps.destroy(&block);
+    MatrixOps.destroy(&otherCopy);
+    MatrixOps.destroy(&fromView);
+    MatrixOps.destroy(&fromCopy);
+    MatrixOps.destroy(&matrix);
+}
+
+void test_append() {
+    Matrix matrix = MatrixOps.create(2, 2);
+    Matrix row = MatrixOps.create(1, 2);
+    Matrix col = MatrixOps.create(2, 1);
+    double value;
+
+    MatrixOps.fill(matrix, 1.0);
+    MatrixOps.fill(row, 2.0);
+    MatrixOps.fill(col, 3.0);
+
+    Matrix rows = MatrixOps.appendRow(matrix, row);
+    assert(MatrixOps.getRow(rows) == 3);
+    MatrixOps.get(rows, 1, 1, &value);
+    assert(value == 1.0);
+    MatrixOps.get(rows, 2, 0, &value);
+    assert(value == 2.0);
+
+    Matrix cols = MatrixOps.appendCol(matrix, col);
+    assert(MatrixOps.getCol(cols) == 3);
+    MatrixOps.get(cols, 1, 1, &value);
+    assert(value == 1.0);
+    MatrixOps.get(cols, 1, 2, &value);
+    assert(value == 3.0);
+
+    MatrixOps.destroy(&matrix);
+    MatrixOps.destroy(&row);
+    MatrixOps.destroy(&col);
+    MatrixOps.destroy(&rows);
+    MatrixOps.destroy(&cols);
+}
+
+void test_float() {
+    MatrixF matrix1 = MatrixFOps.create(2, 3);
+    MatrixF matrix2 = MatrixFOps.create(3, 2);
+    Matrix wide = MatrixOps.create(2, 2);
+    MatrixF product;
+    float value;
+    double wideValue;
+    size_t i;
+
+    for (i = 0; i < 6; i++) {
+        MatrixFOps.set(matrix1, i / 3, i % 3, (float)(i + 1));
+        MatrixFOps.set(matrix2, i / 2, i % 2, (float)(i + 7));
+    }
+
+    product = MatrixFOps.multiply(matrix1, matrix2);
+    assert(product != NULL);
+    MatrixFOps.get(product, 0, 0, &value);
+    assert(value == 58.0f);
+    MatrixFOps.get(product, 1, 1, &value);
+    assert(value == 154.0f);
+
+    // Callbacks take doubles at both precisions
+    assert(MatrixFOps.applyToAllBinary(product, MatrixFOps.fBinary.mul, 0.5) == 0);
+    assert(MatrixOps.into.convert(wide, product) == 0);
+    MatrixOps.get(wide, 1, 0, &wideValue);
+    assert(wideValue == 69.5);
+
+    MatrixOps.set(wide, 0, 0, 0.1);
+    assert(MatrixFOps.into.convert(product, wide) == 0);
+    MatrixFOps.get(product, 0, 0, &value);
+    assert(value == 0.1f);
+
+    assert(MatrixFOps.into.convert(matrix1, wide) == -1);
+
+    MatrixFOps.destroy(&matrix1);
+    MatrixFOps.destroy(&matrix2);
+    MatrixFOps.destroy(&product);
+    MatrixOps.destroy(&wide);
+}
+
+void test_inline() {
+    // Column vectors on both sides of MATRIX_INLINE_SIZE, read through a view
+    size_t rows[] = {1, 7, MATRIX_INLINE_SIZE / sizeof(double),
+        MATRIX_INLINE_SIZE / sizeof(double) + 1, 100};
+    Matrix matrix, view;
+    MatrixF matrixF;
+    double total;
+    size_t i;
+
+    for (i = 0; i < sizeof(rows) / sizeof(rows[0]); i++) {
+        matrix = MatrixOps.create(rows[i], 1);
+        matrixF = MatrixFOps.create(rows[i], 1);
+        assert(matrix != NULL && matrixF != NULL);
+        assert((uintptr_t)MatrixOps.getData(matrix) % MATRIX_ALIGNMENT == 0);
+        assert((uintptr_t)MatrixFOps.getData(matrixF) % MATRIX_ALIGNMENT == 0);
+
+        assert(MatrixOps.fill(matrix, 2.0) == 0);
+        view = MatrixOps.view(matrix, 0, 0, rows[i], 1);
+        assert(MatrixOps.sum(view, &total) == 0);
+        assert(total == 2.0 * rows[i]);
+        MatrixOps.destroy(&view);
+
+        assert(MatrixFOps.fill(matrixF, 0.5) == 0);
+        assert(MatrixFOps.sum(matrixF, &total) == 0);
+        assert(total == 0.5 * rows[i]);
+
+        MatrixOps.destroy(&matrix);
+        MatrixFOps.destroy(&matrixF);
+    }
+}
+
+void test_copy_on_write() {
+    // Too big to be inline, so copies share the data until a write
+    Matrix matrix = MatrixOps.create(40, 40), copy, other, view, inner;
+    double value;
+
+    MatrixOps.fill(matrix, 1.0);
+    copy = MatrixOps.copy(matrix);
+    assert(copy != NULL);
+    assert(MatrixOps.getDataConst(copy) == MatrixOps.getDataConst(matrix));
+    assert(MatrixOps.overlaps(copy, matrix) == 1);
+    assert(MatrixOps.set(matrix, 0, 0, 5.0) == 0);
+    assert(MatrixOps.getDataConst(copy) != MatrixOps.getDataConst(matrix));
+    assert(MatrixOps.overlaps(copy, matrix) == 0);
+    MatrixOps.get(copy, 0, 0, &value);
+    assert(value == 1.0);
+    assert(MatrixOps.scalarMultiply(copy, 3.0) == 0);
+    MatrixOps.get(matrix, 1, 1, &value);
+    assert(value == 1.0);
+    MatrixOps.get(copy, 1, 1, &value);
+    assert(value == 3.0);
+
+    // Written by an operation taking both as operands
+    other = MatrixOps.copy(matrix);
+    assert(MatrixOps.add(other, matrix) == 0);
+    MatrixOps.get(other, 0, 0, &value);
+    assert(value == 10.0);
+    MatrixOps.get(matrix, 0, 0, &value);
+    assert(value == 5.0);
+    assert(MatrixOps.replace(&other, copy) == 0);
+    assert(MatrixOps.getData(other)[1] == 3.0);
+    MatrixOps.get(copy, 0, 1, &value);
+    assert(value == 3.0);
+
+    // A rejected destination keeps sharing
+    MatrixOps.destroy(&other);
+    other = MatrixOps.copy(copy);
+    view = MatrixOps.create(2, 2);
+    assert(MatrixOps.into.add(other, view, view) == -1);
+    assert(MatrixOps.into.transpose(other, view) == -1);
+    assert(MatrixOps.getDataConst(other) == MatrixOps.getDataConst(copy));
+    MatrixOps.destroy(&view);
+    view = MatrixOps.create(40, 41);
+    inner = MatrixOps.copy(view);
+    assert(MatrixOps.transposeInPlace(inner) == -1);
+    assert(MatrixOps.getDataConst(inner) == MatrixOps.getDataConst(view));
+    MatrixOps.destroy(&inner);
+    MatrixOps.destroy(&view);
+
+    // A copy as the destination of its source's transpose gets its own data
+    MatrixOps.set(copy, 0, 1, 7.0);
+    MatrixOps.destroy(&other);
+    other = MatrixOps.copy(copy);
+    assert(MatrixOps.into.transpose(other, copy) == 0);
+    MatrixOps.get(other, 1, 0, &value);
+    assert(value == 7.0);
+    MatrixOps.get(copy, 1, 0, &value);
+    assert(value == 3.0);
+    MatrixOps.get(copy, 0, 1, &value);
+    assert(value == 7.0);
+    MatrixOps.set(copy, 0, 1, 3.0);
+
+    // A view reaches its matrix even once that was shared, and a viewed
+    // matrix is copied right away
+    MatrixOps.destroy(&other);
+    other = MatrixOps.copy(copy);
+    view = MatrixOps.view(copy, 0, 0, 2, 2);
+    assert(MatrixOps.fill(view, 2.0) == 0);
+    MatrixOps.get(copy, 1, 1, &value);
+    assert(value == 2.0);
+    MatrixOps.get(other, 1, 1, &value);
+    assert(value == 3.0);
+    MatrixOps.destroy(&other);
+    other = MatrixOps.copy(copy);
+    assert(MatrixOps.fill(view, 4.0) == 0);
+    MatrixOps.get(other, 1, 1, &value);
+    assert(value == 2.0);
+
+    // Shared again once its last view, one of a view included, is gone
+    inner = MatrixOps.view(view, 0, 0, 1, 1);
+    MatrixOps.destroy(&inner);
+    MatrixOps.destroy(&other);
+    other = MatrixOps.copy(copy);
+    assert(MatrixOps.getDataConst(other) != MatrixOps.getDataConst(copy));
+    MatrixOps.destroy(&view);
+    MatrixOps.destroy(&other);
+    other = MatrixOps.copy(copy);
+    assert(MatrixOps.getDataConst(other) == MatrixOps.getDataConst(copy));
+
+    MatrixOps.destroy(&matrix);
+    MatrixOps.destroy(&copy);
+    MatrixOps.destroy(&other);
+}
+
+// Creates and destroys views of the matrix, from every thread of the pool
+int view_task(void* arg, size_t index) {
+    Matrix view;
+    size_t i;
+
+    for (i = 0; i < 2000; i++) {
+        view = MatrixOps.view(arg, index % 4, 0, 2, 2);
+        if (view == NULL) return -1;
+        MatrixOps.destroy(&view);
+    }
+    return 0;
+}
+
+void test_views_threads() {
+    Matrix matrix = MatrixOps.create(40, 40), copy;
+
+    // Every view is counted once gone, so the matrix is shared again
+    assert(ThreadPoolOps.setThreadCount(4) == 0);
+    assert(ThreadPoolOps.run(view_task, matrix, 16) == 0);
+    ThreadPoolOps.setThreadCount(0);
+    copy = MatrixOps.copy(matrix);
+    assert(MatrixOps.getDataConst(copy) == MatrixOps.getDataConst(matrix));
+
+    MatrixOps.destroy(&copy);
+    MatrixOps.destroy(&matrix);
+}
+
+void test_broadcast() {
+    Matrix matrix = MatrixOps.createPadded(5, 7, 9);
+    Matrix row = MatrixOps.create(1, 7), col = MatrixOps.create(5, 1);
+    Matrix first;
+    double value;
+    size_t i, j;
+
+    for (i = 0; i < 5; i++) {
+        MatrixOps.set(col, i, 0, i + 1.0);
+        for (j = 0; j < 7; j++) {
+            MatrixOps.set(matrix, i, j, i * 10.0 + j);
+            MatrixOps.set(row, 0, j, j * 0.5);
+        }
+    }
+
+    // Each row gets the row vector, each column the column vector
+    assert(MatrixOps.broadcast.add(matrix, row) == 0);
+    assert(MatrixOps.broadcast.scale(matrix, col) == 0);
+    assert(MatrixOps.broadcast.scale(matrix, row) == 0);
+    assert(MatrixOps.broadcast.add(matrix, col) == 0);
+    for (i = 0; i < 5; i++) {
+        for (j = 0; j < 7; j++) {
+            MatrixOps.get(matrix, i, j, &value);
+            assert(value == (i * 10.0 + j + j * 0.5) * (i + 1.0) * (j * 0.5)
+                + (i + 1.0));
+        }
+    }
+
+    // Shapes and aliasing
+    assert(MatrixOps.broadcast.add(matrix, matrix) == -1);
+    assert(MatrixOps.broadcast.scale(col, row) == -1);
+    first = MatrixOps.view(matrix, 0, 0, 1, 7);
+    assert(MatrixOps.broadcast.add(matrix, first) == -1);
+
+    MatrixOps.destroy(&first);
+    MatrixOps.destroy(&matrix);
+    MatrixOps.destroy(&row);
+    MatrixOps.destroy(&col);
+}
+
+void test_reduce() {
+    Matrix matrix = MatrixOps.createPadded(6, 37, 40);
+    Matrix rows = MatrixOps.create(6, 1), cols = MatrixOps.create(1, 37);
+    MatrixF matrixF = MatrixFOps.create(6, 37), colsF = MatrixFOps.create(1, 37);
+    size_t indices[37], i, j, best;
+    double value, sum, max;
+    float valueF;
+
+    for (i = 0; i < 6; i++) {
+        for (j = 0; j < 37; j++) {
+            MatrixOps.set(matrix, i, j, (double)((i * 37 + j) * 7919 % 101) - 50);
+            MatrixFOps.set(matrixF, i, j, (float)(i + j));
+        }
+    }
+
+    // Ties keep the first index, NaNs are skipped unless alone
+    MatrixOps.set(matrix, 2, 5, 99.0);
+    MatrixOps.set(matrix, 2, 30, 99.0);
+    MatrixOps.set(matrix, 4, 5, 99.0);
+    MatrixOps.set(matrix, 3, 0, NAN);
+    for (i = 0; i < 6; i++) {
+        MatrixOps.set(matrix, i, 36, NAN);
+    }
+
+    assert(MatrixOps.reduce.max(rows, matrix) == 0);
+    assert(MatrixOps.reduce.argmax(indices, matrix, MATRIX_EACH_ROW) == 0);
+    for (i = 0; i < 6; i++) {
+        max = -INFINITY;
+        best = 0;
+        for (j = 0; j < 37; j++) {
+            MatrixOps.get(matrix, i, j, &value);
+            if (value > max) {
+                max = value;
+                best = j;
+            }
+        }
+        MatrixOps.get(rows, i, 0, &value);
+        assert(value == max && indices[i] == best);
+    }
+    assert(indices[2] == 5);
+
+    assert(MatrixOps.reduce.max(cols, matrix) == 0);
+    assert(MatrixOps.reduce.argmax(indices, matrix, MATRIX_EACH_COL) == 0);
+    for (j = 0; j < 36; j++) {
+        max = -INFINITY;
+        best = 0;
+        for (i = 0; i < 6; i++) {
+            MatrixOps.get(matrix, i, j, &value);
+            if (value > max) {
+                max = value;
+                best = i;
+            }
+        }
+        MatrixOps.get(cols, 0, j, &value);
+        assert(value == max && indices[j] == best);
+    }
+    MatrixOps.get(cols, 0, 36, &value);
+    assert(isnan(value) && indices[36] == 0 && indices[5] == 2);
+
+    // Sums and means, small integers are exact in any order
+    MatrixOps.set(matrix, 3, 0, 1.0);
+    for (i = 0; i < 6; i++) {
+        MatrixOps.set(matrix, i, 36, 2.0);
+    }
+    assert(MatrixOps.reduce.sum(rows, matrix) == 0);
+    for (i = 0; i < 6; i++) {
+        sum = 0;
+        for (j = 0; j < 37; j++) {
+            MatrixOps.get(matrix, i, j, &value);
+            sum += value;
+        }
+        MatrixOps.get(rows, i, 0, &value);
+        assert(value == sum);
+    }
+    assert(MatrixOps.reduce.mean(cols, matrix) == 0);
+    for (j = 0; j < 37; j++) {
+        sum = 0;
+        for (i = 0; i < 6; i++) {
+            MatrixOps.get(matrix, i, j, &value);
+            sum += value;
+        }
+        MatrixOps.get(cols, 0, j, &value);
+        assert(fabs(value - sum / 6) <= 1e-14 * fabs(sum));
+    }
+
+    assert(MatrixFOps.reduce.sum(colsF, matrixF) == 0);
+    for (j = 0; j < 37; j++) {
+        MatrixFOps.get(colsF, 0, j, &valueF);
+        assert(valueF == 6.0f * j + 15.0f);
+    }
+
+    assert(MatrixOps.reduce.sum(cols, rows) == -1);
+    assert(MatrixOps.reduce.argmax(NULL, matrix, MATRIX_EACH_ROW) == -1);
+    assert(MatrixOps.reduce.argmax(indices, matrix, (MatrixAxis)2) == -1);
+
+    MatrixOps.destroy(&matrix);
+    MatrixOps.destroy(&rows);
+    MatrixOps.destroy(&cols);
+    MatrixFOps.destroy(&matrixF);
+    MatrixFOps.destroy(&colsF);
+}
+
+void test_reduce_parallel() {
+    // Above MATRIX_PARALLEL_THRESHOLD, split by rows and by column blocks
+    Matrix matrix = MatrixOps.create(700, 403), bias = MatrixOps.create(1, 403);
+    Matrix rows[2], cols[2];
+    size_t indices[2][700], i, t;
+
+    MatrixOps.randomize(matrix, -1.0, 1.0);
+    MatrixOps.randomize(bias, -1.0, 1.0);
+    for (t = 0; t < 2; t++) {
+        assert(ThreadPoolOps.setThreadCount(t ? 4 : 1) == 0);
+        rows[t] = MatrixOps.create(700, 1);
+        cols[t] = MatrixOps.create(1, 403);
+        assert(MatrixOps.reduce.sum(rows[t], matrix) == 0);
+        assert(MatrixOps.reduce.mean(cols[t], matrix) == 0);
+        assert(MatrixOps.reduce.argmax(indices[t], matrix, MATRIX_EACH_COL) == 0);
+    }
+
+    for (i = 0; i < 700; i++) {
+        assert(MatrixOps.getData(rows[0])[i] == MatrixOps.getData(rows[1])[i]);
+    }
+    for (i = 0; i < 403; i++) {
+        assert(MatrixOps.getData(cols[0])[i] == MatrixOps.getData(cols[1])[i]);
+        assert(indices[0][i] == indices[1][i]);
+    }
+    assert(MatrixOps.broadcast.add(matrix, bias) == 0);
+
+    ThreadPoolOps.setThreadCount(0);
+    for (t = 0; t < 2; t++) {
+        MatrixOps.destroy(&rows[t]);
+        MatrixOps.destroy(&cols[t]);
+    }
+    MatrixOps.destroy(&matrix);
+    MatrixOps.destroy(&bias);
+}
+
+void test_reduce_columns() {
+    // Around whole blocks of REDUCE_PAIRWISE_BLOCK rows, exact for integers
+    static const size_t heights[] = {1, 255, 256, 257, 1000, 3 * 256 + 5};
+    Matrix matrix, cols;
+    MatrixF tall, colsF;
+    double value, sum;
+    float valueF;
+    size_t h, i, j;
+
+    for (h = 0; h < sizeof(heights) / sizeof(heights[0]); h++) {
+        matrix = MatrixOps.create(heights[h], 3);
+        cols = MatrixOps.create(1, 3);
+        for (i = 0; i < heights[h]; i++) {
+            for (j = 0; j < 3; j++) {
+                MatrixOps.set(matrix, i, j, (double)((i * 7 + j) % 13) - 6);
+            }
+        }
+        assert(MatrixOps.reduce.sum(cols, matrix) == 0);
+        for (j = 0; j < 3; j++) {
+            sum = 0;
+            for (i = 0; i < heights[h]; i++) {
+                MatrixOps.get(matrix, i, j, &value);
+                sum += value;
+            }
+            MatrixOps.get(cols, 0, j, &value);
+            assert(value == sum);
+        }
+        MatrixOps.destroy(&matrix);
+        MatrixOps.destroy(&cols);
+    }
+
+    // A running float sum of 0.1f would be off in the fourth digit
+    tall = MatrixFOps.create(100000, 3);
+    colsF = MatrixFOps.create(1, 3);
+    MatrixFOps.fill(tall, 0.1);
+    assert(MatrixFOps.reduce.sum(colsF, tall) == 0);
+    for (j = 0; j < 3; j++) {
+        MatrixFOps.get(colsF, 0, j, &valueF);
+        assert(fabs(valueF - 100000 * (double)0.1f) <= 10000 * FLT_EPSILON);
+    }
+    MatrixFOps.destroy(&tall);
+    MatrixFOps.destroy(&colsF);
+}
+
+void fill_indices(Matrix matrix) {
+    size_t i, j;
+
+    for (i = 0; i < MatrixOps.getRow(matrix); i++) {
+        for (j = 0; j < MatrixOps.getCol(matrix); j++) {
+            MatrixOps.set(matrix, i, j, i * 10.0 + j);
+        }
+    }
+}
+
+void test_into_overlap() {
+    // dst one row and one column on from the operands, then beside them
+    Matrix base = MatrixOps.create(6, 9);
+    Matrix src = MatrixOps.view(base, 0, 0, 5, 8);
+    Matrix dst = MatrixOps.view(base, 1, 1, 5, 8);
+    Matrix left = MatrixOps.view(base, 0, 0, 6, 4);
+    Matrix right = MatrixOps.view(base, 0, 4, 6, 4);
+    double value;
+    size_t i, j, k;
+    int err = 0;
+
+    for (k = 0; k < 4; k++) {
+        fill_indices(base);
+        switch (k) {
+        case 0:
+            err = MatrixOps.into.copy(dst, src);
+            break;
+        case 1:
+            err = MatrixOps.into.add(dst, src, src);
+            break;
+        case 2:
+            err = MatrixOps.into.scalarMultiply(dst, src, 2.0);
+            break;
+        case 3:
+            err = MatrixOps.into.elementWise(dst, src, src, MatrixOps.fBinary.add);
+            break;
+        }
+        assert(err == 0);
+        for (i = 0; i < 5; i++) {
+            for (j = 0; j < 8; j++) {
+                MatrixOps.get(dst, i, j, &value);
+                assert(value == (k ? 2.0 : 1.0) * (i * 10.0 + j));
+            }
+        }
+    }
+
+    fill_indices(base);
+    assert(MatrixOps.into.subtract(right, left, right) == 0);
+    for (i = 0; i < 6; i++) {
+        for (j = 0; j < 4; j++) {
+            MatrixOps.get(left, i, j, &value);
+            assert(value == i * 10.0 + j);
+            MatrixOps.get(right, i, j, &value);
+            assert(value == -4.0);
+        }
+    }
+
+    assert(MatrixOps.overlaps(dst, src) == 1);
+    assert(MatrixOps.overlaps(left, base) == 1);
+
+    // The products read every operand element after writing some of dst
+    MatrixOps.destroy(&src);
+    MatrixOps.destroy(&dst);
+    src = MatrixOps.view(base, 0, 0, 4, 4);
+    dst = MatrixOps.view(base, 1, 1, 4, 4);
+    assert(MatrixOps.into.multiply(dst, src, src) == -1);
+
+    MatrixOps.destroy(&src);
+    MatrixOps.destroy(&dst);
+    MatrixOps.destroy(&left);
+    MatrixOps.destroy(&right);
+    MatrixOps.destroy(&base);
+}
+
 int main() {
     test_create_destroy();
     test_set_get();
@@ -260,7 +1058,23 @@ int main() {
     test_applyToAllBinary();
     test_elementWise();
     test_multiply();
+    test_rank_one_update();
+    test_gradient_accumulation();
+    test_broadcast();
+    test_reduce();
+    test_reduce_parallel();
+    test_reduce_columns();
     test_transpose();
+    test_transpose_in_place();
+    test_padded();
+    test_inline();
+    test_copy_on_write();
+    test_views_threads();
+    test_into();
+    test_into_overlap();
+    test_view();
+    test_append();
+    test_float();
 
     printf("All tests passed!\n");
     return 0;
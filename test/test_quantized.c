@@ -0,0 +1,234 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include "../include/quantized.h"
+#include "../include/matrix.h"
+#include "../include/thread_pool.h"
+#include "../include/simd.h"
+
+Matrix random_matrix(size_t row, size_t col, double min, double max) {
+    Matrix matrix = MatrixOps.create(row, col);
+
+    MatrixOps.randomize(matrix, min, max);
+    return matrix;
+}
+
+void fill_int8(int8_t* x, size_t n) {
+    size_t i;
+
+    for (i = 0; i < n; i++) {
+        x[i] = (int8_t)(rand() % 255 - 127);
+    }
+}
+
+void test_quantize() {
+    Matrix matrix = random_matrix(17, 45, -2.0, 3.0), back;
+    Matrix zeros = MatrixOps.create(3, 5);
+    Quantized quantized = QuantizedOps.quantize(matrix);
+    double value, expected, scale;
+    size_t i, j;
+
+    assert(quantized != NULL);
+    assert(QuantizedOps.getRow(quantized) == 17);
+    assert(QuantizedOps.getCol(quantized) == 45);
+    assert(QuantizedOps.getLd(quantized) >= 45);
+
+    // Every element is off by at most half a step of its row
+    back = QuantizedOps.dequantize(quantized);
+    for (i = 0; i < 17; i++) {
+        scale = QuantizedOps.getScale(quantized, i);
+        assert(scale > 0 && scale <= 5.0 / 254 * (1 + 1e-12));
+        assert(abs(QuantizedOps.getZeroPoint(quantized, i)) <= 127);
+        for (j = 0; j < 45; j++) {
+            MatrixOps.get(matrix, i, j, &expected);
+            MatrixOps.get(back, i, j, &value);
+            assert(fabs(value - expected) <= 0.5 * scale * (1 + 1e-12));
+            QuantizedOps.get(quantized, i, j, &expected);
+            assert(value == expected);
+        }
+    }
+
+    // 0 is exact, and an all zero row stays zero
+    MatrixOps.set(zeros, 1, 2, 0.75);
+    MatrixOps.set(zeros, 1, 3, -0.25);
+    assert(QuantizedOps.into.quantize(quantized, zeros) == -1);
+    QuantizedOps.destroy(&quantized);
+    quantized = QuantizedOps.quantize(zeros);
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < 5; j++) {
+            QuantizedOps.get(quantized, i, j, &value);
+            MatrixOps.get(zeros, i, j, &expected);
+            assert((expected == 0) ? value == 0
+                : fabs(value - expected) <= 0.5 / 254);
+        }
+    }
+
+    assert(QuantizedOps.get(quantized, 3, 0, &value) == -1);
+    assert(QuantizedOps.quantize(NULL) == NULL);
+    assert(QuantizedOps.create(0, 3) == NULL);
+    MatrixOps.set(zeros, 0, 0, INFINITY);
+    assert(QuantizedOps.into.quantize(quantized, zeros) == -1);
+
+    QuantizedOps.destroy(&quantized);
+    assert(quantized == NULL);
+    MatrixOps.destroy(&matrix);
+    MatrixOps.destroy(&back);
+    MatrixOps.destroy(&zeros);
+}
+
+void check_gemm(size_t m, size_t n, size_t k) {
+    size_t lda = k + 3, ldb = k + 1, ldc = n + 2, i, j, p;
+    int8_t* a = malloc(m * lda);
+    int8_t* b = malloc(n * ldb);
+    int32_t* c = malloc(m * ldc * sizeof(int32_t));
+    int32_t expected;
+
+    fill_int8(a, m * lda);
+    fill_int8(b, n * ldb);
+
+    // The extremes, which would saturate int16 pairs with -128
+    if (k >= 2) {
+        a[0] = a[1] = -127;
+        b[0] = b[1] = -127;
+    }
+
+    assert(QuantizedOps.gemm(m, n, k, a, lda, b, ldb, c, ldc) == 0);
+    for (i = 0; i < m; i++) {
+        for (j = 0; j < n; j++) {
+            expected = 0;
+            for (p = 0; p < k; p++) {
+                expected += (int32_t)a[i * lda + p] * b[j * ldb + p];
+            }
+            assert(c[i * ldc + j] == expected);
+        }
+    }
+
+    free(a);
+    free(b);
+    free(c);
+}
+
+void test_gemm() {
+    SimdLevel level;
+
+    for (level = SIMD_SCALAR; level <= SimdOps.detectedLevel(); level++) {
+        SimdOps.setLevel(level);
+        check_gemm(1, 1, 1);
+        check_gemm(7, 1, 100);
+        check_gemm(1, 9, 64);
+        check_gemm(13, 6, 33);
+        check_gemm(5, 3, 31);
+        check_gemm(40, 40, 777);
+    }
+    SimdOps.setLevel(SimdOps.detectedLevel());
+
+    assert(QuantizedOps.gemm(1, 1, 4, NULL, 4, NULL, 4, NULL, 1) == -1);
+}
+
+void check_multiply(size_t m, size_t k, size_t n) {
+    Matrix a = random_matrix(m, k, -1.0, 1.0);
+    Matrix b = random_matrix(k, n, -1.0, 1.0);
+    Matrix expected = MatrixOps.multiply(a, b);
+    Quantized quantized = QuantizedOps.quantize(a);
+    Matrix result = QuantizedOps.multiply(quantized, b);
+    double value1, value2, bound;
+    size_t i, j;
+
+    // Both operands are off by at most half a step of 2 / 254
+    bound = k * (2.0 / 254 + 0.25 * (2.0 / 254) * (2.0 / 254));
+    assert(result != NULL);
+    for (i = 0; i < m; i++) {
+        for (j = 0; j < n; j++) {
+            MatrixOps.get(result, i, j, &value1);
+            MatrixOps.get(expected, i, j, &value2);
+            assert(fabs(value1 - value2) <= bound);
+        }
+    }
+
+    QuantizedOps.destroy(&quantized);
+    MatrixOps.destroy(&a);
+    MatrixOps.destroy(&b);
+    MatrixOps.destroy(&expected);
+    MatrixOps.destroy(&result);
+}
+
+void test_multiply() {
+    Matrix a, b, dst;
+    Quantized quantized;
+
+    check_multiply(1, 1, 1);
+    check_multiply(64, 100, 1);
+    check_multiply(30, 50, 7);
+
+    // Into a padded destination, and the dimension checks
+    a = random_matrix(8, 6, -1.0, 1.0);
+    b = random_matrix(6, 5, -1.0, 1.0);
+    dst = MatrixOps.createPadded(8, 5, 16);
+    quantized = QuantizedOps.quantize(a);
+    assert(QuantizedOps.into.multiply(dst, quantized, b) == 0);
+    assert(QuantizedOps.into.multiply(dst, quantized, a) == -1);
+    assert(QuantizedOps.multiply(quantized, a) == NULL);
+
+    QuantizedOps.destroy(&quantized);
+    MatrixOps.destroy(&a);
+    MatrixOps.destroy(&b);
+    MatrixOps.destroy(&dst);
+}
+
+void assert_same(const Matrix matrix1, const Matrix matrix2) {
+    size_t i;
+
+    for (i = 0; i < MatrixOps.getRow(matrix1); i++) {
+        assert(memcmp(MatrixOps.getData(matrix1) + i * MatrixOps.getLd(matrix1),
+            MatrixOps.getData(matrix2) + i * MatrixOps.getLd(matrix2),
+            MatrixOps.getCol(matrix1) * sizeof(double)) == 0);
+    }
+}
+
+void test_parallel() {
+    // Above QUANTIZED_PARALLEL_THRESHOLD, split along rows then columns
+    Matrix a = random_matrix(300, 400, -1.0, 1.0);
+    Matrix b = random_matrix(400, 3, -1.0, 1.0);
+    Matrix c = random_matrix(3, 400, -1.0, 1.0);
+    Matrix d = random_matrix(400, 300, -1.0, 1.0);
+    Quantized wide = QuantizedOps.quantize(a);
+    Quantized narrow = QuantizedOps.quantize(c);
+    Matrix serial, result;
+
+    assert(ThreadPoolOps.setThreadCount(1) == 0);
+    serial = QuantizedOps.multiply(wide, b);
+    assert(ThreadPoolOps.setThreadCount(5) == 0);
+    result = QuantizedOps.multiply(wide, b);
+    assert_same(serial, result);
+    MatrixOps.destroy(&serial);
+    MatrixOps.destroy(&result);
+
+    assert(ThreadPoolOps.setThreadCount(1) == 0);
+    serial = QuantizedOps.multiply(narrow, d);
+    assert(ThreadPoolOps.setThreadCount(5) == 0);
+    result = QuantizedOps.multiply(narrow, d);
+    assert_same(serial, result);
+    MatrixOps.destroy(&serial);
+    MatrixOps.destroy(&result);
+
+    ThreadPoolOps.setThreadCount(0);
+    QuantizedOps.destroy(&wide);
+    QuantizedOps.destroy(&narrow);
+    MatrixOps.destroy(&a);
+    MatrixOps.destroy(&b);
+    MatrixOps.destroy(&c);
+    MatrixOps.destroy(&d);
+}
+
+int main() {
+    srand(19);
+    test_quantize();
+    test_gemm();
+    test_multiply();
+    test_parallel();
+
+    printf("All tests passed!\n");
+    return 0;
+}
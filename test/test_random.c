@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include "../include/random.h"
+#include "../include/matrix.h"
+#include "../include/thread_pool.h"
+#include "../include/simd.h"
+
+void test_block() {
+    // Known answers of Philox4x32-10 from Random123
+    uint32_t counters[3][4] = {
+        {0, 0, 0, 0},
+        {0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF},
+        {0x243F6A88, 0x85A308D3, 0x13198A2E, 0x03707344}
+    };
+    uint32_t keys[3][2] = {
+        {0, 0},
+        {0xFFFFFFFF, 0xFFFFFFFF},
+        {0xA4093822, 0x299F31D0}
+    };
+    uint32_t expected[3][4] = {
+        {0x6627E8D5, 0xE169C58D, 0xBC57AC4C, 0x9B00DBD8},
+        {0x408F276D, 0x41C83B0E, 0xA20BC7C6, 0x6D5451FD},
+        {0xD16CFE09, 0x94FDCCEB, 0x5001E420, 0x24126EA1}
+    };
+    uint32_t out[4];
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        RandomOps.block(counters[i], keys[i], out);
+        assert(memcmp(out, expected[i], sizeof(out)) == 0);
+    }
+}
+
+void test_uniform() {
+    size_t n = 10001, i;
+    double* x = malloc(n * sizeof(double));
+    double* part = malloc(n * sizeof(double));
+    double mean = 0, variance = 0;
+
+    assert(RandomOps.uniform(1, 2, 0, x, n, -3.0, 5.0) == 0);
+    for (i = 0; i < n; i++) {
+        assert(x[i] >= -3.0 && x[i] < 5.0);
+        mean += x[i];
+    }
+    mean /= n;
+    for (i = 0; i < n; i++) {
+        variance += (x[i] - mean) * (x[i] - mean);
+    }
+    variance /= n - 1;
+
+    // Mean 1 and variance 64 / 12, within about 4 standard errors
+    assert(fabs(mean - 1.0) < 0.1);
+    assert(fabs(variance - 64.0 / 12.0) < 0.3);
+
+    // Any offset, odd or even, continues the same stream
+    assert(RandomOps.uniform(1, 2, 7, part, 100, -3.0, 5.0) == 0);
+    assert(memcmp(part, x + 7, 100 * sizeof(double)) == 0);
+    assert(RandomOps.uniform(1, 2, 4000, part, 3, -3.0, 5.0) == 0);
+    assert(memcmp(part, x + 4000, 3 * sizeof(double)) == 0);
+
+    // Another stream or seed gives other values
+    assert(RandomOps.uniform(1, 3, 0, part, n, -3.0, 5.0) == 0);
+    assert(memcmp(part, x, n * sizeof(double)) != 0);
+    assert(RandomOps.uniform(2, 2, 0, part, n, -3.0, 5.0) == 0);
+    assert(memcmp(part, x, n * sizeof(double)) != 0);
+
+    assert(RandomOps.uniform(1, 2, 0, NULL, n, 0.0, 1.0) == -1);
+    assert(RandomOps.uniform(1, 2, 0, x, 0, 0.0, 1.0) == 0);
+
+    free(x);
+    free(part);
+}
+
+void test_normal() {
+    size_t n = 20001, i;
+    double* x = malloc(n * sizeof(double));
+    float* f = malloc(n * sizeof(float));
+    double mean = 0, variance = 0;
+
+    assert(RandomOps.normal(5, 0, 0, x, n, 2.0, 3.0) == 0);
+    for (i = 0; i < n; i++) {
+        assert(isfinite(x[i]));
+        mean += x[i];
+    }
+    mean /= n;
+    for (i = 0; i < n; i++) {
+        variance += (x[i] - mean) * (x[i] - mean);
+    }
+    variance /= n - 1;
+    assert(fabs(mean - 2.0) < 0.1);
+    assert(fabs(variance - 9.0) < 0.4);
+
+    // Single precision gives the same values rounded
+    assert(RandomOps.normalF(5, 0, 0, f, n, 2.0, 3.0) == 0);
+    for (i = 0; i < n; i++) {
+        assert(f[i] == (float)x[i]);
+    }
+
+    assert(RandomOps.normal(5, 0, 0, x, n, 0.0, -1.0) == -1);
+
+    free(x);
+    free(f);
+}
+
+void test_reproducible() {
+    // Several chunks, with a partial last one
+    size_t n = 3 * RANDOM_CHUNK + 123;
+    double* serial = malloc(n * sizeof(double));
+    double* x = malloc(n * sizeof(double));
+    SimdLevel level;
+
+    assert(ThreadPoolOps.setThreadCount(1) == 0);
+    SimdOps.setLevel(SIMD_SCALAR);
+    assert(RandomOps.normal(9, 4, 1, serial, n, 0.0, 1.0) == 0);
+
+    assert(ThreadPoolOps.setThreadCount(5) == 0);
+    for (level = SIMD_SCALAR; level <= SimdOps.detectedLevel(); level++) {
+        SimdOps.setLevel(level);
+        assert(RandomOps.normal(9, 4, 1, x, n, 0.0, 1.0) == 0);
+        assert(memcmp(x, serial, n * sizeof(double)) == 0);
+    }
+
+    ThreadPoolOps.setThreadCount(0);
+    SimdOps.setLevel(SimdOps.detectedLevel());
+    free(serial);
+    free(x);
+}
+
+int same_values(const Matrix matrix1, const Matrix matrix2) {
+    size_t i, j;
+    double value1, value2;
+
+    for (i = 0; i < MatrixOps.getRow(matrix1); i++) {
+        for (j = 0; j < MatrixOps.getCol(matrix1); j++) {
+            MatrixOps.get(matrix1, i, j, &value1);
+            MatrixOps.get(matrix2, i, j, &value2);
+            if (value1 != value2) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+void test_matrix() {
+    Matrix matrix = MatrixOps.create(37, 29);
+    Matrix padded = MatrixOps.createPadded(37, 29, 40);
+    double* x = malloc(37 * 29 * sizeof(double));
+    double value;
+    size_t i, j;
+
+    // Element (i, j) is element i * col + j of the stream, whatever the padding
+    assert(RandomOps.uniform(3, 8, 0, x, 37 * 29, -1.0, 1.0) == 0);
+    assert(RandomOps.matrix.uniform(matrix, 3, 8, -1.0, 1.0) == 0);
+    assert(RandomOps.matrix.uniform(padded, 3, 8, -1.0, 1.0) == 0);
+    for (i = 0; i < 37; i++) {
+        for (j = 0; j < 29; j++) {
+            MatrixOps.get(matrix, i, j, &value);
+            assert(value == x[i * 29 + j]);
+            MatrixOps.get(padded, i, j, &value);
+            assert(value == x[i * 29 + j]);
+        }
+    }
+    assert(RandomOps.matrix.uniform(NULL, 3, 8, -1.0, 1.0) == -1);
+
+    // randomize takes a new stream every call, from the start after setSeed
+    RandomOps.setSeed(11);
+    assert(MatrixOps.randomize(matrix, -1.0, 1.0) == 0);
+    assert(MatrixOps.randomize(padded, -1.0, 1.0) == 0);
+    assert(!same_values(matrix, padded));
+    RandomOps.setSeed(11);
+    assert(MatrixOps.randomize(padded, -1.0, 1.0) == 0);
+    assert(same_values(matrix, padded));
+    assert(RandomOps.seed() == 11);
+
+    MatrixOps.destroy(&matrix);
+    MatrixOps.destroy(&padded);
+    free(x);
+}
+
+int main() {
+    test_block();
+    test_uniform();
+    test_normal();
+    test_reproducible();
+    test_matrix();
+
+    printf("All tests passed!\n");
+    return 0;
+}
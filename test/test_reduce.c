@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include "../include/reduce.h"
+#include "../include/simd.h"
+#include "../include/thread_pool.h"
+
+// Longer than a few chunks, not a multiple of anything
+#define N (3 * REDUCE_CHUNK + 1237)
+
+void test_accuracy() {
+    static const ReduceMode modes[] = {REDUCE_FAST, REDUCE_PAIRWISE, REDUCE_KAHAN};
+    double* x = malloc(N * sizeof(double));
+    double* y = malloc(N * sizeof(double));
+    double result, exact;
+    size_t i, m;
+
+    // 1 + many tiny values: lost entirely by a naive sum
+    x[0] = 1.0;
+    for (i = 1; i < N; i++) x[i] = DBL_EPSILON / 4;
+    exact = 1.0 + (N - 1) * (DBL_EPSILON / 4);
+    assert(ReduceOps.sum(x, N, REDUCE_KAHAN, &result) == 0);
+    assert(result == exact);
+
+    // Cancelling products, exact with the Kahan dot product
+    for (i = 0; i < N; i++) {
+        x[i] = (i % 2) ? 1e16 : 1.0;
+        y[i] = (i % 4 < 2) ? 1.0 : -1.0;
+    }
+    assert(ReduceOps.dot(x, y, N, REDUCE_KAHAN, &result) == 0);
+    exact = 0;
+    for (i = N - N % 4; i < N; i++) exact += (i % 4 < 2) ? x[i] : -x[i];
+    assert(result == exact);
+
+    // Every mode within its bound on a plain sum
+    for (i = 0; i < N; i++) x[i] = (double)rand() / RAND_MAX;
+    ReduceOps.sum(x, N, REDUCE_KAHAN, &exact);
+    for (m = 0; m < 3; m++) {
+        assert(ReduceOps.sum(x, N, modes[m], &result) == 0);
+        assert(fabs(result - exact) <= N * DBL_EPSILON * exact);
+        assert(ReduceOps.dot(x, x, N, modes[m], &result) == 0);
+        assert(ReduceOps.sum(x, 0, modes[m], &result) == 0 && result == 0);
+    }
+
+    assert(ReduceOps.sum(NULL, N, REDUCE_FAST, &result) == -1);
+    assert(ReduceOps.sum(x, N, (ReduceMode)7, &result) == -1);
+
+    free(x);
+    free(y);
+}
+
+void test_deterministic() {
+    static const size_t threads[] = {2, 3, 8};
+    double* x = malloc(N * sizeof(double));
+    double serial[3], result;
+    size_t h, i;
+    ReduceMode mode;
+
+    for (i = 0; i < N; i++) x[i] = (double)rand() / RAND_MAX - 0.5;
+
+    assert(ThreadPoolOps.setThreadCount(1) == 0);
+    for (mode = REDUCE_FAST; mode <= REDUCE_KAHAN; mode++) {
+        ReduceOps.sum(x, N, mode, &serial[mode]);
+    }
+
+    for (h = 0; h < sizeof(threads) / sizeof(threads[0]); h++) {
+        assert(ThreadPoolOps.setThreadCount(threads[h]) == 0);
+        for (mode = REDUCE_FAST; mode <= REDUCE_KAHAN; mode++) {
+            ReduceOps.sum(x, N, mode, &result);
+            assert(result == serial[mode]);
+        }
+    }
+
+    ThreadPoolOps.setThreadCount(0);
+    free(x);
+}
+
+void test_norm() {
+    double x[5] = {3e200, 4e200, 0, 0, 0}, y[3] = {3e-200, -4e-200, 0};
+    double z[3] = {0, 0, 0}, result;
+
+    assert(ReduceOps.norm(x, 5, REDUCE_FAST, &result) == 0);
+    assert(fabs(result - 5e200) <= 4 * DBL_EPSILON * 5e200);
+    assert(ReduceOps.norm(y, 3, REDUCE_PAIRWISE, &result) == 0);
+    assert(fabs(result - 5e-200) <= 4 * DBL_EPSILON * 5e-200);
+    assert(ReduceOps.norm(z, 3, REDUCE_KAHAN, &result) == 0 && result == 0);
+
+    x[2] = INFINITY;
+    assert(ReduceOps.norm(x, 5, REDUCE_FAST, &result) == 0 && isinf(result));
+}
+
+void test_max() {
+    double x[37], result;
+    size_t i, index;
+    SimdLevel level;
+
+    for (level = SIMD_SCALAR; level <= SimdOps.detectedLevel(); level++) {
+        SimdOps.setLevel(level);
+        for (i = 0; i < 37; i++) x[i] = -(double)i;
+
+        // First occurrence, in the vector part and in the tail
+        x[20] = 5;
+        x[22] = 5;
+        x[3] = NAN;
+        assert(ReduceOps.argmax(x, 37, &index) == 0 && index == 20);
+        assert(ReduceOps.max(x, 37, &result) == 0 && result == 5);
+        x[36] = 6;
+        assert(ReduceOps.argmax(x, 37, &index) == 0 && index == 36);
+
+        for (i = 0; i < 37; i++) x[i] = NAN;
+        assert(ReduceOps.max(x, 37, &result) == 0 && isnan(result));
+        x[30] = -INFINITY;
+        assert(ReduceOps.argmax(x, 37, &index) == 0 && index == 30);
+    }
+
+    SimdOps.setLevel(SimdOps.detectedLevel());
+    assert(ReduceOps.max(x, 0, &result) == -1);
+}
+
+void test_matrix() {
+    Matrix padded = MatrixOps.createPadded(5, 7, 11);
+    Matrix flat = MatrixOps.create(5, 7);
+    double value, expected, total = 0, squares = 0;
+    size_t i, j, row, col;
+
+    MatrixOps.randomize(padded, -1.0, 1.0);
+    MatrixOps.set(padded, 3, 2, 2.0);
+    MatrixOps.assignValues(flat, padded);
+    for (i = 0; i < 5; i++) {
+        for (j = 0; j < 7; j++) {
+            MatrixOps.get(padded, i, j, &value);
+            total += value;
+            squares += value * value;
+        }
+    }
+
+    assert(ReduceOps.matrix.sum(padded, REDUCE_KAHAN, &value) == 0);
+    assert(fabs(value - total) < 1e-14);
+    assert(MatrixOps.sum(padded, &value) == 0);
+    assert(fabs(value - total) < 1e-14);
+    assert(ReduceOps.matrix.dot(padded, flat, REDUCE_PAIRWISE, &value) == 0);
+    assert(fabs(value - squares) < 1e-14);
+    assert(ReduceOps.matrix.norm(padded, REDUCE_FAST, &value) == 0);
+    assert(ReduceOps.matrix.norm(flat, REDUCE_FAST, &expected) == 0);
+    assert(fabs(value - sqrt(squares)) < 1e-14 && fabs(expected - value) < 1e-14);
+    assert(ReduceOps.matrix.max(padded, &value) == 0 && value == 2.0);
+    assert(ReduceOps.matrix.argmax(padded, &row, &col) == 0);
+    assert(row == 3 && col == 2);
+    assert(ReduceOps.matrix.argmax(flat, &row, &col) == 0);
+    assert(row == 3 && col == 2);
+
+    MatrixOps.destroy(&padded);
+    MatrixOps.destroy(&flat);
+}
+
+int main() {
+    srand(13);
+    test_accuracy();
+    test_deterministic();
+    test_norm();
+    test_max();
+    test_matrix();
+
+    printf("All tests passed!\n");
+    return 0;
+}
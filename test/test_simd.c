@@ -0,0 +1,255 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <math.h>
+#include "../include/simd.h"
+
+#define N 1037
+
+void fill_random(double* data, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        data[i] = (double)rand() / RAND_MAX * 2.0 - 1.0;
+    }
+}
+
+void test_elementwise(SimdLevel level) {
+    double x[N], y[N], z[N], w[N];
+    size_t i, n;
+
+    assert(SimdOps.setLevel(level) == 0);
+    assert(SimdOps.level() == level);
+
+    // Every length up to a few vectors, to cover all tails
+    for (n = 0; n < 40; n++) {
+        fill_random(x, n);
+        fill_random(y, n);
+        for (i = 0; i < n; i++) w[i] = x[i];
+
+        SimdOps.add(w, y, n);
+        for (i = 0; i < n; i++) assert(w[i] == x[i] + y[i]);
+
+        SimdOps.subtract(w, y, n);
+        SimdOps.subtractTo(z, x, y, n);
+        for (i = 0; i < n; i++) assert(z[i] == x[i] - y[i]);
+
+        SimdOps.addTo(z, x, y, n);
+        for (i = 0; i < n; i++) assert(z[i] == x[i] + y[i]);
+
+        SimdOps.scaleTo(z, x, 3.0, n);
+        for (i = 0; i < n; i++) assert(z[i] == x[i] * 3.0);
+
+        SimdOps.scale(z, 0.5, n);
+        for (i = 0; i < n; i++) assert(z[i] == x[i] * 3.0 * 0.5);
+
+        SimdOps.fill(z, 7.0, n);
+        for (i = 0; i < n; i++) assert(z[i] == 7.0);
+
+        SimdOps.copy(z, x, n);
+        for (i = 0; i < n; i++) assert(z[i] == x[i]);
+
+        SimdOps.multiply(z, y, n);
+        for (i = 0; i < n; i++) assert(z[i] == x[i] * y[i]);
+
+        SimdOps.shift(z, 0.25, n);
+        for (i = 0; i < n; i++) assert(z[i] == x[i] * y[i] + 0.25);
+
+        SimdOps.copy(z, x, n);
+        SimdOps.maximum(z, y, n);
+        for (i = 0; i < n; i++) assert(z[i] == fmax(x[i], y[i]));
+    }
+}
+
+void test_max(SimdLevel level) {
+    double x[N], y[N], expected;
+    size_t i, n;
+
+    assert(SimdOps.setLevel(level) == 0);
+
+    for (n = 1; n < 40; n++) {
+        fill_random(x, n);
+        expected = x[0];
+        for (i = 1; i < n; i++) expected = fmax(expected, x[i]);
+        assert(SimdOps.max(x, n) == expected);
+
+        // NaNs are skipped wherever they are, unless there is nothing else
+        x[n / 2] = NAN;
+        x[n - 1] = NAN;
+        expected = -INFINITY;
+        for (i = 0; i < n; i++) expected = fmax(expected, x[i]);
+        if (n == 1) {
+            assert(isnan(SimdOps.max(x, n)));
+        }
+        else {
+            assert(SimdOps.max(x, n) == expected);
+        }
+        for (i = 0; i < n; i++) x[i] = NAN;
+        assert(isnan(SimdOps.max(x, n)));
+        x[n - 1] = -INFINITY;
+        assert(SimdOps.max(x, n) == -INFINITY);
+    }
+
+    // NaNs of y keep x, NaNs of x stay
+    x[0] = 1.0;
+    x[1] = NAN;
+    y[0] = NAN;
+    y[1] = 2.0;
+    SimdOps.maximum(x, y, 2);
+    assert(x[0] == 1.0 && isnan(x[1]));
+}
+
+void test_sum(SimdLevel level) {
+    double x[N], serial = 0.0, bound = 0.0;
+
+    assert(SimdOps.setLevel(level) == 0);
+
+    fill_random(x, N);
+    for (size_t i = 0; i < N; i++) {
+        serial += x[i];
+        bound += fabs(x[i]);
+    }
+
+    assert(fabs(SimdOps.sum(x, N) - serial) <= N * 1e-16 * bound);
+    assert(SimdOps.sum(x, 0) == 0.0);
+    assert(SimdOps.sum(x, 1) == x[0]);
+}
+
+void test_streaming(SimdLevel level) {
+    // Larger than SIMD_STREAM_THRESHOLD and deliberately misaligned by one
+    size_t n = SIMD_STREAM_THRESHOLD / sizeof(double) + 13;
+    double* src = malloc((n + 1) * sizeof(double));
+    double* dst = malloc((n + 1) * sizeof(double));
+    size_t i;
+
+    assert(SimdOps.setLevel(level) == 0);
+
+    SimdOps.fill(dst + 1, 2.5, n);
+    for (i = 0; i < n; i++) assert(dst[i + 1] == 2.5);
+
+    for (i = 0; i < n; i++) src[i + 1] = (double)i;
+    SimdOps.copy(dst + 1, src + 1, n);
+    for (i = 0; i < n; i++) assert(dst[i + 1] == (double)i);
+
+    free(src);
+    free(dst);
+}
+
+void test_transpose(SimdLevel level) {
+    // Shapes around the tile and leaf sizes, plus a padded leading dimension
+    static const size_t shapes[][2] = {
+        {1, 1}, {3, 5}, {4, 4}, {7, 33}, {32, 32}, {33, 65}, {100, 37}, {129, 129}
+    };
+    size_t s, i, j, rows, cols, ld;
+    double* src, * dst;
+
+    assert(SimdOps.setLevel(level) == 0);
+
+    for (s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+        rows = shapes[s][0];
+        cols = shapes[s][1];
+        ld = rows + 3;
+        src = malloc(rows * cols * sizeof(double));
+        dst = malloc(cols * ld * sizeof(double));
+        fill_random(src, rows * cols);
+
+        SimdOps.transpose(dst, ld, src, cols, rows, cols);
+        for (i = 0; i < rows; i++)
+            for (j = 0; j < cols; j++)
+                assert(dst[j * ld + i] == src[i * cols + j]);
+
+        free(src);
+        free(dst);
+    }
+
+    // In place, every size up to past two recursion levels
+    for (size_t n = 0; n < 70; n++) {
+        ld = n + 1;
+        src = malloc(n * ld * sizeof(double) + 1);
+        dst = malloc(n * ld * sizeof(double) + 1);
+        fill_random(src, n * ld);
+        for (i = 0; i < n * ld; i++) dst[i] = src[i];
+
+        SimdOps.transposeSquare(dst, ld, n);
+        for (i = 0; i < n; i++) {
+            for (j = 0; j < n; j++) assert(dst[j * ld + i] == src[i * ld + j]);
+            // Padding is left alone
+            assert(dst[i * ld + n] == src[i * ld + n]);
+        }
+
+        free(src);
+        free(dst);
+    }
+}
+
+void test_float(SimdLevel level) {
+    float x[N], y[N], z[N], t[N * 3];
+    double serial = 0.0, bound = 0.0;
+    size_t i, j, n;
+
+    assert(SimdOps.setLevel(level) == 0);
+
+    for (i = 0; i < N; i++) {
+        x[i] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+        y[i] = (float)rand() / RAND_MAX * 2.0f - 1.0f;
+    }
+
+    for (n = 0; n < 40; n++) {
+        SimdOps.f32.addTo(z, x, y, n);
+        for (i = 0; i < n; i++) assert(z[i] == x[i] + y[i]);
+
+        SimdOps.f32.subtract(z, y, n);
+        for (i = 0; i < n; i++) assert(z[i] == (x[i] + y[i]) - y[i]);
+
+        SimdOps.f32.scaleTo(z, x, 3.0, n);
+        for (i = 0; i < n; i++) assert(z[i] == x[i] * 3.0f);
+
+        SimdOps.f32.fill(z, 7.0, n);
+        for (i = 0; i < n; i++) assert(z[i] == 7.0f);
+
+        SimdOps.f32.multiply(z, x, n);
+        SimdOps.f32.shift(z, -1.0, n);
+        for (i = 0; i < n; i++) assert(z[i] == 7.0f * x[i] - 1.0f);
+
+        SimdOps.f32.maximum(z, y, n);
+        for (i = 0; i < n; i++) assert(z[i] == fmaxf(7.0f * x[i] - 1.0f, y[i]));
+    }
+
+    y[N / 3] = 5.0f;
+    y[N / 2] = NAN;
+    assert(SimdOps.f32.max(y, N) == 5.0);
+
+    for (i = 0; i < N; i++) {
+        serial += x[i];
+        bound += fabs(x[i]);
+    }
+    assert(fabs(SimdOps.f32.sum(x, N) - serial) <= N * 1e-7 * bound);
+
+    // 37 x 3 into a 3 x 37 block
+    SimdOps.f32.transpose(t, 37, x, 3, 37, 3);
+    for (i = 0; i < 37; i++)
+        for (j = 0; j < 3; j++)
+            assert(t[j * 37 + i] == x[i * 3 + j]);
+}
+
+int main() {
+    SimdLevel level, detected = SimdOps.detectedLevel();
+
+    srand(7);
+    assert(SimdOps.level() == detected);
+
+    for (level = SIMD_SCALAR; level <= detected; level++) {
+        test_elementwise(level);
+        test_sum(level);
+        test_max(level);
+        test_streaming(level);
+        test_transpose(level);
+        test_float(level);
+    }
+
+    if (detected < SIMD_AVX512) {
+        assert(SimdOps.setLevel(SIMD_AVX512) == -1);
+    }
+    SimdOps.setLevel(detected);
+
+    printf("All tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,245 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include "../include/sparse.h"
+#include "../include/matrix.h"
+#include "../include/thread_pool.h"
+#include "../include/simd.h"
+
+// A dense matrix with about density of its elements nonzero
+Matrix random_sparse_dense(size_t row, size_t col, double density) {
+    Matrix matrix = MatrixOps.create(row, col);
+    double* data = MatrixOps.getData(matrix);
+    size_t ld = MatrixOps.getLd(matrix), i, j;
+
+    for (i = 0; i < row; i++) {
+        for (j = 0; j < col; j++) {
+            data[i * ld + j] = ((double)rand() / RAND_MAX < density)
+                ? 2.0 * rand() / RAND_MAX - 1.0 : 0.0;
+        }
+    }
+    return matrix;
+}
+
+void assert_close(const Matrix matrix1, const Matrix matrix2, double tolerance) {
+    size_t i, j;
+    double value1, value2;
+
+    assert(MatrixOps.isSameShape(matrix1, matrix2));
+    for (i = 0; i < MatrixOps.getRow(matrix1); i++) {
+        for (j = 0; j < MatrixOps.getCol(matrix1); j++) {
+            MatrixOps.get(matrix1, i, j, &value1);
+            MatrixOps.get(matrix2, i, j, &value2);
+            assert(fabs(value1 - value2) <= tolerance);
+        }
+    }
+}
+
+void test_conversion() {
+    Matrix dense = random_sparse_dense(13, 21, 0.2), back;
+    Sparse csr = SparseOps.fromDense(dense, SPARSE_CSR, 0);
+    Sparse csc = SparseOps.fromDense(dense, SPARSE_CSC, 0);
+    Sparse converted;
+    size_t i, j, nnz = 0;
+    double value, expected;
+
+    assert(csr != NULL && csc != NULL);
+    for (i = 0; i < 13; i++) {
+        for (j = 0; j < 21; j++) {
+            MatrixOps.get(dense, i, j, &expected);
+            nnz += (expected != 0);
+            assert(SparseOps.get(csr, i, j, &value) == 0 && value == expected);
+            assert(SparseOps.get(csc, i, j, &value) == 0 && value == expected);
+        }
+    }
+    assert(SparseOps.nonZeros(csr) == nnz && SparseOps.nonZeros(csc) == nnz);
+    assert(SparseOps.getRow(csr) == 13 && SparseOps.getCol(csc) == 21);
+
+    back = SparseOps.toDense(csc);
+    assert_close(back, dense, 0);
+    MatrixOps.destroy(&back);
+
+    // CSR to CSC and back gives the same elements
+    converted = SparseOps.convert(csr, SPARSE_CSC);
+    assert(SparseOps.getFormat(converted) == SPARSE_CSC);
+    back = SparseOps.toDense(converted);
+    assert_close(back, dense, 0);
+    MatrixOps.destroy(&back);
+    SparseOps.destroy(&converted);
+
+    converted = SparseOps.convert(csc, SPARSE_CSR);
+    back = SparseOps.toDense(converted);
+    assert_close(back, dense, 0);
+    MatrixOps.destroy(&back);
+    SparseOps.destroy(&converted);
+
+    // A threshold prunes the small elements
+    SparseOps.destroy(&csr);
+    csr = SparseOps.fromDense(dense, SPARSE_CSR, 0.5);
+    for (i = 0; i < 13; i++) {
+        for (j = 0; j < 21; j++) {
+            MatrixOps.get(dense, i, j, &expected);
+            SparseOps.get(csr, i, j, &value);
+            assert(value == ((fabs(expected) > 0.5) ? expected : 0));
+        }
+    }
+
+    assert(SparseOps.get(csr, 13, 0, &value) == -1);
+    SparseOps.destroy(&csr);
+    SparseOps.destroy(&csc);
+    assert(csr == NULL);
+    MatrixOps.destroy(&dense);
+}
+
+void test_triplets() {
+    size_t rows[] = {2, 0, 1, 2, 0, 2};
+    size_t cols[] = {3, 1, 0, 0, 1, 3};
+    double values[] = {1.0, 2.0, 3.0, 4.0, 5.0, 6.0};
+    SparseFormat format;
+    Sparse sparse;
+    double value;
+
+    for (format = SPARSE_CSR; format <= SPARSE_CSC; format++) {
+        sparse = SparseOps.fromTriplets(3, 4, 6, rows, cols, values, format);
+        assert(sparse != NULL);
+
+        // Duplicates are added
+        assert(SparseOps.nonZeros(sparse) == 4);
+        SparseOps.get(sparse, 0, 1, &value);
+        assert(value == 7.0);
+        SparseOps.get(sparse, 2, 3, &value);
+        assert(value == 7.0);
+        SparseOps.get(sparse, 1, 0, &value);
+        assert(value == 3.0);
+        SparseOps.get(sparse, 2, 0, &value);
+        assert(value == 4.0);
+        SparseOps.get(sparse, 1, 1, &value);
+        assert(value == 0.0);
+        SparseOps.destroy(&sparse);
+    }
+
+    rows[0] = 3;
+    assert(SparseOps.fromTriplets(3, 4, 6, rows, cols, values, SPARSE_CSR) == NULL);
+
+    // No triplets give an all zero matrix
+    sparse = SparseOps.fromTriplets(2, 2, 0, NULL, NULL, NULL, SPARSE_CSC);
+    assert(sparse != NULL && SparseOps.nonZeros(sparse) == 0);
+    SparseOps.destroy(&sparse);
+}
+
+void check_products(size_t m, size_t k, size_t n) {
+    Matrix a = random_sparse_dense(m, k, 0.1);
+    Matrix b = random_sparse_dense(k, n, 1.0);
+    Matrix d = random_sparse_dense(n, m, 1.0);
+    Matrix expected, result;
+    SparseFormat format;
+    Sparse sparse;
+
+    for (format = SPARSE_CSR; format <= SPARSE_CSC; format++) {
+        sparse = SparseOps.fromDense(a, format, 0);
+
+        // sparse x dense
+        expected = MatrixOps.multiply(a, b);
+        result = SparseOps.multiply(sparse, b);
+        assert(result != NULL);
+        assert_close(result, expected, 2.0 * k * DBL_EPSILON * k);
+        MatrixOps.destroy(&expected);
+        MatrixOps.destroy(&result);
+
+        // dense x sparse
+        expected = MatrixOps.multiply(d, a);
+        result = SparseOps.multiplyDense(d, sparse);
+        assert(result != NULL);
+        assert_close(result, expected, 2.0 * m * DBL_EPSILON * m);
+        MatrixOps.destroy(&expected);
+        MatrixOps.destroy(&result);
+
+        SparseOps.destroy(&sparse);
+    }
+
+    MatrixOps.destroy(&a);
+    MatrixOps.destroy(&b);
+    MatrixOps.destroy(&d);
+}
+
+void test_multiply() {
+    SimdLevel level;
+
+    for (level = SIMD_SCALAR; level <= SimdOps.detectedLevel(); level++) {
+        SimdOps.setLevel(level);
+        check_products(1, 1, 1);
+        check_products(30, 50, 1);
+        check_products(30, 50, 7);
+        check_products(64, 33, 45);
+    }
+    SimdOps.setLevel(SimdOps.detectedLevel());
+
+    // Into a padded destination, and the dimension and alias checks
+    Matrix a = random_sparse_dense(8, 6, 0.3);
+    Matrix b = random_sparse_dense(6, 5, 1.0);
+    Matrix dst = MatrixOps.createPadded(8, 5, 16);
+    Matrix expected = MatrixOps.multiply(a, b);
+    Sparse sparse = SparseOps.fromDense(a, SPARSE_CSC, 0);
+
+    assert(SparseOps.into.multiply(dst, sparse, b) == 0);
+    assert_close(dst, expected, 1e-14);
+    assert(SparseOps.into.multiply(dst, sparse, a) == -1);
+    assert(SparseOps.multiplyDense(b, sparse) == NULL);
+    assert(SparseOps.into.multiply(b, sparse, b) == -1);
+
+    SparseOps.destroy(&sparse);
+    MatrixOps.destroy(&a);
+    MatrixOps.destroy(&b);
+    MatrixOps.destroy(&dst);
+    MatrixOps.destroy(&expected);
+}
+
+void test_parallel() {
+    // Above SPARSE_PARALLEL_THRESHOLD with 10% nonzeros
+    Matrix a = random_sparse_dense(300, 400, 0.1);
+    Matrix b = random_sparse_dense(400, 100, 1.0);
+    Matrix d = random_sparse_dense(100, 300, 1.0);
+    Matrix serial, result;
+    SparseFormat format;
+    Sparse sparse;
+
+    for (format = SPARSE_CSR; format <= SPARSE_CSC; format++) {
+        sparse = SparseOps.fromDense(a, format, 0);
+
+        assert(ThreadPoolOps.setThreadCount(1) == 0);
+        serial = SparseOps.multiply(sparse, b);
+        assert(ThreadPoolOps.setThreadCount(5) == 0);
+        result = SparseOps.multiply(sparse, b);
+        assert_close(result, serial, 0);
+        MatrixOps.destroy(&serial);
+        MatrixOps.destroy(&result);
+
+        assert(ThreadPoolOps.setThreadCount(1) == 0);
+        serial = SparseOps.multiplyDense(d, sparse);
+        assert(ThreadPoolOps.setThreadCount(5) == 0);
+        result = SparseOps.multiplyDense(d, sparse);
+        assert_close(result, serial, 0);
+        MatrixOps.destroy(&serial);
+        MatrixOps.destroy(&result);
+
+        SparseOps.destroy(&sparse);
+    }
+
+    ThreadPoolOps.setThreadCount(0);
+    MatrixOps.destroy(&a);
+    MatrixOps.destroy(&b);
+    MatrixOps.destroy(&d);
+}
+
+int main() {
+    srand(42);
+    test_conversion();
+    test_triplets();
+    test_multiply();
+    test_parallel();
+
+    printf("All tests passed!\n");
+    return 0;
+}
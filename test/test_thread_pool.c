@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "../include/thread_pool.h"
+
+#define COUNT 1000
+
+int counts[COUNT];
+
+// Counts in arg, or in counts when arg is NULL
+int mark(void* arg, size_t index) {
+    int* target = arg ? arg : counts;
+    target[index]++;
+    return 0;
+}
+
+int failOdd(void* arg, size_t index) {
+    (void)arg;
+    return (index % 2) ? -1 : 0;
+}
+
+// A batch started from a task runs on the thread of that task
+int nested(void* arg, size_t index) {
+    int (*rows)[40] = arg;
+    return ThreadPoolOps.run(mark, rows[index], 10 * (index + 1));
+}
+
+void test_run() {
+    static const size_t threads[] = {1, 2, 4, 7};
+    int rows[4][40] = {{0}};
+    size_t h, i, j;
+
+    for (h = 0; h < sizeof(threads) / sizeof(threads[0]); h++) {
+        assert(ThreadPoolOps.setThreadCount(threads[h]) == 0);
+        assert(ThreadPoolOps.threadCount() == threads[h]);
+
+        // Every task runs exactly once, batch after batch
+        for (i = 0; i < COUNT; i++) counts[i] = 0;
+        assert(ThreadPoolOps.run(mark, NULL, COUNT) == 0);
+        assert(ThreadPoolOps.run(mark, NULL, COUNT) == 0);
+        for (i = 0; i < COUNT; i++) assert(counts[i] == 2);
+
+        assert(ThreadPoolOps.run(failOdd, NULL, 5) == -1);
+        assert(ThreadPoolOps.run(failOdd, NULL, 1) == 0);
+        assert(ThreadPoolOps.run(mark, NULL, 0) == 0);
+
+        assert(ThreadPoolOps.run(nested, rows, 4) == 0);
+        for (i = 0; i < 4; i++) {
+            for (j = 0; j < 40; j++) {
+                assert(rows[i][j] == (j < 10 * (i + 1)) * (int)(h + 1));
+            }
+        }
+    }
+
+    assert(ThreadPoolOps.run(NULL, NULL, 3) == -1);
+    assert(ThreadPoolOps.setThreadCount(THREAD_POOL_MAX_THREADS + 1) == -1);
+
+    // Workers come back after a shutdown
+    ThreadPoolOps.shutdown();
+    for (i = 0; i < COUNT; i++) counts[i] = 0;
+    assert(ThreadPoolOps.run(mark, NULL, COUNT) == 0);
+    assert(counts[COUNT - 1] == 1);
+    ThreadPoolOps.shutdown();
+}
+
+void test_default() {
+    setenv(THREAD_POOL_ENV, "3", 1);
+    assert(ThreadPoolOps.setThreadCount(0) == 0);
+    assert(ThreadPoolOps.threadCount() == 3);
+
+    // Falls back to the processor count
+    setenv(THREAD_POOL_ENV, "many", 1);
+    assert(ThreadPoolOps.setThreadCount(0) == 0);
+    assert(ThreadPoolOps.threadCount() >= 1);
+    unsetenv(THREAD_POOL_ENV);
+}
+
+void test_partition() {
+    size_t length, unit, parts, index, start, size, next;
+
+    // Pieces are contiguous, cover the length, and start on whole units
+    for (length = 1; length <= 40; length++) {
+        for (unit = 1; unit <= 8; unit++) {
+            for (parts = 1; parts <= (length + unit - 1) / unit; parts++) {
+                next = 0;
+                for (index = 0; index < parts; index++) {
+                    ThreadPoolOps.partition(length, unit, parts, index, &start, &size);
+                    assert(start == next && start % unit == 0 && size > 0);
+                    next = start + size;
+                }
+                assert(next == length);
+            }
+        }
+    }
+}
+
+int main() {
+    test_run();
+    test_default();
+    test_partition();
+
+    printf("All tests passed!\n");
+    return 0;
+}